@@ -39,6 +39,7 @@ extern "C"
 #include "BeDVI.h"
 #include "DVI-View.h"
 #include "FontList.h"
+#include "FontMaker.h"
 #include "log.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -63,7 +64,8 @@ ViewApplication::ViewApplication():
   OpenPanel(NULL),
   SleepPointerNestCnt(0),
   NoDocLoaded(true),
-  MeasureWinOpen(false)
+  MeasureWinOpen(false),
+  SaveTextIndex(true)
 {
   app_info   AppInfo;
   BEntry     AppFileEntry;
@@ -130,13 +132,21 @@ ViewApplication::ViewApplication():
     if (PREFGetData(PrefData, "dpi",          &p, &Size, &Type) >= B_OK && Type == B_INT32_TYPE)
       PixelsPerInch          = *(int32 *)p;
     if (PREFGetData(PrefData, "shrink",       &p, &Size, &Type) >= B_OK && Type == B_INT16_TYPE)
-      Settings.ShrinkFactor  = *(int16 *)p;
+      Settings.Shrink        = *(int16 *)p * DrawSettings::ShrinkOne;         // written by older versions
+    if (PREFGetData(PrefData, "shrink",       &p, &Size, &Type) >= B_OK && Type == B_FLOAT_TYPE)
+      Settings.Shrink        = (int32)(*(float *)p * DrawSettings::ShrinkOne + 0.5);
     if (PREFGetData(PrefData, "antialiasing", &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
       Settings.AntiAliasing  = *(bool *)p;
     if (PREFGetData(PrefData, "borderline",   &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
       Settings.BorderLine    = *(bool *)p;
     if (PREFGetData(PrefData, "measure",      &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
       MeasureWinOpen         = *(bool *)p;
+    if (PREFGetData(PrefData, "text index",   &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
+      SaveTextIndex          = *(bool *)p;
+    if (PREFGetData(PrefData, "native fonts", &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
+      Settings.NativeFonts   = *(bool *)p;
+    if (PREFGetData(PrefData, "outline fonts", &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
+      Settings.OutlineFonts  = *(bool *)p;
 
     PREFDisposeSet(&PrefData);
   }
@@ -163,6 +173,7 @@ ViewApplication::ViewApplication():
 ViewApplication::~ViewApplication()
 {
   PREFData PrefData;
+  float    Shrink = Settings.ShrinkFactor();
 
   delete OpenPanel;
 
@@ -181,10 +192,13 @@ ViewApplication::~ViewApplication()
       PREFSetData(PrefData, "mwin x",       &MeasureWinPos.x,                sizeof(float), B_FLOAT_TYPE);
       PREFSetData(PrefData, "mwin y",       &MeasureWinPos.y,                sizeof(float), B_FLOAT_TYPE);
       PREFSetData(PrefData, "dpi",          &Settings.DspInfo.PixelsPerInch, sizeof(int32), B_INT32_TYPE);
-      PREFSetData(PrefData, "shrink",       &Settings.ShrinkFactor,          sizeof(int16), B_INT16_TYPE);
+      PREFSetData(PrefData, "shrink",       &Shrink,                         sizeof(float), B_FLOAT_TYPE);
       PREFSetData(PrefData, "antialiasing", &Settings.AntiAliasing,          sizeof(bool),  B_BOOL_TYPE);
       PREFSetData(PrefData, "borderline",   &Settings.BorderLine,            sizeof(bool),  B_BOOL_TYPE);
       PREFSetData(PrefData, "measure",      &MeasureWinOpen,                 sizeof(bool),  B_BOOL_TYPE);
+      PREFSetData(PrefData, "text index",   &SaveTextIndex,                  sizeof(bool),  B_BOOL_TYPE);
+      PREFSetData(PrefData, "native fonts", &Settings.NativeFonts,           sizeof(bool),  B_BOOL_TYPE);
+      PREFSetData(PrefData, "outline fonts", &Settings.OutlineFonts,         sizeof(bool),  B_BOOL_TYPE);
 
       PREFSaveSet(PrefData);
       PREFDisposeSet(&PrefData);
@@ -434,6 +448,11 @@ void ViewApplication::MessageReceived(BMessage *msg)
       break;
     }
 
+    case MsgFontsReady:
+      for (int i = CountWindows(); i > 0; i--)
+        WindowAt(i - 1)->PostMessage(msg);
+      break;
+
     case MsgPoint:
       if (MeasureWin)
         MeasureWin->PostMessage(msg);
@@ -1105,6 +1124,19 @@ int ViewApplication::NumDocWindows()
   return num;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void FontsGenerated()                                                                                   //
+//                                                                                                                //
+// Called by `FontMaker' when fonts have been generated. The windows reload their documents if necessary.         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void FontsGenerated()
+{
+  be_app->PostMessage(MsgFontsReady);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // int main()                                                                                                     //
@@ -1131,10 +1163,21 @@ int main()
       exit(1);
     }
 
+    // missing fonts are generated in the background while the document is displayed
+
+    if (FontMaker::Init())
+    {
+      FontMaker::Async      = true;
+      FontMaker::FontsReady = FontsGenerated;
+    }
+    else
+      log_warn("can't create semaphore!");
+
     auto_ptr<ViewApplication> ViewApp(new ViewApplication());
 
     ViewApp->Run();
 
+    FontMaker::Shutdown();
     FreeKpseSem();
   }
   catch(const exception &e)
@@ -49,6 +49,10 @@ static const uint32 MsgMeasureWin      = 'mwin';
 static const uint32 MsgSearchWin       = 'swin';
 static const uint32 MsgSearchForwards  = 'fndf';
 static const uint32 MsgSearchBackwards = 'fndb';
+static const uint32 MsgFindAll         = 'fnda';
+static const uint32 MsgSearchHit       = 'fhit';
+static const uint32 MsgSearchDone      = 'fdon';
+static const uint32 MsgShowHit         = 'jhit';
 static const uint32 MsgNext            = 'next';
 static const uint32 MsgPrev            = 'prev';
 static const uint32 MsgFirst           = 'frst';
@@ -60,6 +64,11 @@ static const uint32 MsgPage            = 'page';
 static const uint32 MsgResChanged      = 'resc';
 static const uint32 MsgPoint           = 'pnt ';
 static const uint32 MsgRedraw          = 'rdrw';
+static const uint32 MsgShowPage        = 'shwp';
+static const uint32 MsgRendered        = 'rndr';
+static const uint32 MsgPageShown       = 'pgsh';
+static const uint32 MsgLabelsRead      = 'lbls';
+static const uint32 MsgFontsReady      = 'fnts';
 
 class ViewApplication: public BApplication
 {
@@ -97,6 +106,7 @@ class ViewApplication: public BApplication
     const MenuDef *MenuDefs;
     bool          NoDocLoaded;
     bool          MeasureWinOpen;
+    bool          SaveTextIndex;    // keep the search index of a document next to the DVI file
 
     static const int             NumMenus;
     static const int  * const    NumSubMenus;
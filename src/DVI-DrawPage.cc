@@ -42,7 +42,13 @@
 PSInterface *DrawPage::PSIface = NULL;
 
 DrawPage::DrawPage(const DrawSettings &set):
+  Document(NULL),
+  rt(NULL),
   Settings(set),
+  Mode(DrawAll),
+  Clip(),
+  Layout(NULL),
+  Incomplete(false),
   Frames(),
   SearchState(this, set.SearchString),
   CurFont(NULL),
@@ -87,7 +93,7 @@ void DrawPage::ChangeFont(ulong n)
 //                                                                                                                //
 // void DrawPage::DrawPart()                                                                                      //
 //                                                                                                                //
-// Draws a part of a document.                                                                                    //
+// Draws a part of a document. Stops early if the drawing is cancelled.                                           //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -100,7 +106,7 @@ void DrawPage::DrawPart()
 
   dp = this;
 
-  while (!dp->EndOfFile())
+  while (!dp->EndOfFile() && !Settings.Cancelled())
   {
     c = dp->ReadInt(1);
 
@@ -131,7 +137,7 @@ void DrawPage::DrawPart()
           b = dp->ReadSInt(4) * dp->DimConvert;
 
           if (a > 0 && b > 0 && !dp->ScanFrame)
-            dp->DrawRule(dp->Settings.ToPixel(b), dp->Settings.ToPixel(a));
+            dp->DrawRule(b, a);
 
           dp->Data.Horiz += dp->DrawDir * b;
           break;
@@ -141,7 +147,7 @@ void DrawPage::DrawPart()
           b = dp->ReadSInt(4) * dp->DimConvert;
 
           if (a > 0 && b > 0 && !dp->ScanFrame)
-            dp->DrawRule(dp->Settings.ToPixel(b), dp->Settings.ToPixel(a));
+            dp->DrawRule(b, a);
           break;
 
         case DVI::NOP:
@@ -166,7 +172,7 @@ void DrawPage::DrawPart()
             log_warn("stack not empty at Pop!");
             throw(runtime_error("stack not empty at EOP"));
           }
-          if (dp->PSIface)
+          if (dp->PSIface && dp->Mode != ScanLayout && dp->Mode != ScanText)
             dp->PSIface->EndPage();
           return;
 
@@ -189,8 +195,12 @@ void DrawPage::DrawPart()
           if (!dp->ScanFrame)
           {
             NewDP.Document     = dp->Document;
-            NewDP.vw           = dp->vw;
+            NewDP.rt           = dp->rt;
             NewDP.Settings     = dp->Settings;
+            NewDP.Mode         = dp->Mode;
+            NewDP.Clip         = dp->Clip;
+            NewDP.Layout       = dp->Layout;
+            NewDP.Incomplete   = dp->Incomplete;
             NewDP.Data         = dp->Data;
             NewDP.TPicConvert  = dp->TPicConvert;
             NewDP.DimConvert   = dp->DimConvert;
@@ -230,6 +240,7 @@ void DrawPage::DrawPart()
 
               OldDP->Frames      = dp->Frames;
               OldDP->SearchState = dp->SearchState;
+              OldDP->Incomplete  = dp->Incomplete;
 
               dp = OldDP;                  // this restores the old file position!!!
 
@@ -421,8 +432,11 @@ void DrawPage::SetVFChar(DrawPage *dp, wchar cmd, wchar c)
   if (!dp->ScanFrame)
   {
     NewDP.Document     = dp->Document;
-    NewDP.vw           = dp->vw;
+    NewDP.rt           = dp->rt;
     NewDP.Settings     = dp->Settings;
+    NewDP.Mode         = dp->Mode;
+    NewDP.Clip         = dp->Clip;
+    NewDP.Layout       = dp->Layout;
     NewDP.Data         = dp->Data;
     NewDP.Data.w       = 0;
     NewDP.Data.x       = 0;
@@ -442,11 +456,13 @@ void DrawPage::SetVFChar(DrawPage *dp, wchar cmd, wchar c)
     NewDP.Frames       = dp->Frames;
     NewDP.ScanFrame    = NULL;
     NewDP.SearchState  = dp->SearchState;
+    NewDP.Incomplete   = dp->Incomplete;
 
     NewDP.DrawPart();
 
     dp->Frames      = NewDP.Frames;
     dp->SearchState = NewDP.SearchState;
+    dp->Incomplete  = NewDP.Incomplete;
   }
   if (cmd == DVI::Put1 || cmd == DVI::Put2)
     dp->Data.Horiz = horiz;
@@ -471,7 +487,7 @@ void DrawPage::SetNormalChar(DrawPage *dp, wchar cmd, wchar c)
 {
   Glyph *g;
   long  horiz;
-  float x, y;
+  BRect r;
 
   if (c > dp->MaxChar)
   {
@@ -479,12 +495,23 @@ void DrawPage::SetNormalChar(DrawPage *dp, wchar cmd, wchar c)
     return;
   }
 
+  // the search only needs the order of the characters, so the glyph isn't looked at
+
+  if (dp->Mode == ScanText)
+  {
+    if (!dp->ScanFrame)
+      dp->SearchState.MatchChar(c, BRect());
+    return;
+  }
+
   g = &dp->CurFont->Glyphs[c];
 
-  if (g->UBitMap == NULL)
+  // fonts which don't provide the metrics in their index must be unpacked to position the character
+
+  if (!g->HasMetrics)
     dp->CurFont->ReadChar(dp->CurFont, c);
 
-  if (g->UBitMap == NULL)
+  if (!g->HasMetrics)
     return;
 
   horiz = dp->Data.Horiz;
@@ -494,41 +521,15 @@ void DrawPage::SetNormalChar(DrawPage *dp, wchar cmd, wchar c)
 
   if (!dp->ScanFrame)
   {
-    if (dp->Settings.ShrinkFactor == 1)
-    {
-      x = dp->Settings.PixelConv(dp->Data.Horiz) - g->Ux;
-      y = dp->Data.PixelV                        - g->Uy;
-
-      dp->vw->DrawBitmapAsync(g->UBitMap, BPoint(x, y));
-
-      if (dp->Settings.SearchString != NULL)
-      {
-//        BRect r(g->UBitMap->Bounds());
-//        r.OffsetBy(x, y);
-
-        BRect r(x, y, x + g->UWidth, y + g->UHeight);
+    if (dp->Mode == ScanLayout)
+      dp->Layout->AddChar(dp->CurFont, c, g, dp->Data.Horiz, dp->Data.Vert);
 
-        dp->SearchState.MatchChar(c, r);
-      }
-    }
-    else
+    else if (dp->Mode == DrawAll)
     {
-      g->Shrink(dp->Settings.ShrinkFactor, dp->Settings.AntiAliasing);
-
-      x = dp->Settings.PixelConv(dp->Data.Horiz) - g->Sx;
-      y = dp->Data.PixelV                        - g->Sy;
-
-      dp->vw->DrawBitmapAsync(g->SBitMap, BPoint(x, y));
+      dp->DrawChar(dp->CurFont, c, r);
 
       if (dp->Settings.SearchString != NULL)
-      {
-//        BRect r(g->SBitMap->Bounds());
-//        r.OffsetBy(x, y);
-
-        BRect r(x, y, x + g->SWidth, y + g->SHeight);
-
         dp->SearchState.MatchChar(c, r);
-      }
     }
   }
   if (cmd == DVI::Put1 || cmd == DVI::Put2)
@@ -538,25 +539,193 @@ void DrawPage::SetNormalChar(DrawPage *dp, wchar cmd, wchar c)
       dp->Data.Horiz += g->Advance;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DrawPage::DrawChar(Font *f, wchar c, BRect &r)                                                            //
+//                                                                                                                //
+// Draws a character at the current position. Characters outside of `Clip' are neither unpacked nor shrunk. In    //
+// `DrawPrepared' mode glyphs which haven't been prepared are skipped, so several threads can draw at once. A     //
+// preview draws grey boxes instead of glyphs which would have to be unpacked first, as do fonts which are still  //
+// generated in the background. With `Settings.NativeFonts' the glyphs are taken from the font loaded near the    //
+// displayed resolution.                                                                                          //
+//                                                                                                                //
+// Font  *f                             font                                                                      //
+// wchar c                              character to be drawn                                                     //
+// BRect &r                             returns the area covered by the character                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DrawPage::DrawChar(Font *f, wchar c, BRect &r)
+{
+  Glyph *g      = &f->Glyphs[c];
+  int32 Shrink  = Settings.Shrink;
+  float sf      = Settings.ShrinkFactor();
+  Font  *nf;
+  float x, y;
+
+  x = Settings.PixelConv(Data.Horiz);
+  y = Data.PixelV;
+
+  if (Clip.IsValid() && g->HasMetrics)
+  {
+    // estimate the size of the shrunken glyph
+
+    r.Set(x - g->Ux / sf - 2,
+          y - g->Uy / sf - 2,
+          x - g->Ux / sf + g->UWidth  / sf + 2,
+          y - g->Uy / sf + g->UHeight / sf + 2);
+
+    if (!r.Intersects(Clip))
+      return;
+  }
+
+  // a preview doesn't wait for a font to be loaded
+
+  nf = f->NativeFont(Document, &Settings, Mode != DrawPrepared && !Settings.Preview);
+
+  if (nf && c <= nf->MaxChar && nf->Glyphs[c].Addr != 0)
+  {
+    f      = nf;
+    g      = &f->Glyphs[c];
+    sf     = Settings.NativeSample();
+    Shrink = Settings.NativeSample() * DrawSettings::ShrinkOne;
+  }
+
+  // fonts which are generated in the background only have boxes
+
+  if (g->UBitMap == NULL && (Settings.Preview || f->Placeholder) && g->HasMetrics)
+  {
+    r.Set(x - g->Ux / sf,
+          y - g->Uy / sf,
+          x - g->Ux / sf + g->UWidth  / sf,
+          y - g->Uy / sf + g->UHeight / sf);
+
+    if (Mode != PrepareGlyphs)
+      rt->FillPlaceholder(r);
+
+    if (Settings.Preview)                         // the boxes of a missing font are final until it is generated
+      Incomplete = true;
+    return;
+  }
+
+  if (g->UBitMap == NULL && Mode != DrawPrepared)
+    f->ReadChar(f, c);
+
+  if (g->UBitMap == NULL)
+  {
+    r.Set(x, y, x, y);
+    return;
+  }
+
+  if (Shrink == DrawSettings::ShrinkOne)
+  {
+    x -= g->Ux;
+    y -= g->Uy;
+
+    if (Mode != PrepareGlyphs)
+      rt->DrawGlyph(g->UBitMap, (int32)x, (int32)y);
+
+    r.Set(x, y, x + g->UWidth, y + g->UHeight);
+  }
+  else
+  {
+    if (Mode != DrawPrepared)
+      g->Shrink(Shrink, Settings.AntiAliasing);
+
+    if (g->SBitMap == NULL)
+    {
+      r.Set(x, y, x, y);
+      return;
+    }
+
+    x -= g->Sx;
+    y -= g->Sy;
+
+    if (Mode != PrepareGlyphs)
+      rt->DrawGlyph(g->SBitMap, (int32)x, (int32)y);
+
+    r.Set(x, y, x + g->SWidth, y + g->SHeight);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // void DrawPage::DrawRule(long w, long h)                                                                        //
 //                                                                                                                //
 // Draws a rule.                                                                                                  //
 //                                                                                                                //
-// long w, h                            size of the rule                                                          //
+// long w, h                            size of the rule in unshrunk pixels << 16                                 //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void DrawPage::DrawRule(long w, long h)
 {
+  if (Mode == ScanLayout)
+  {
+    Layout->AddRule(Data.Horiz, Data.Vert, w, h, DrawDir);
+    return;
+  }
+  if (Mode != DrawAll && Mode != DrawPrepared)
+    return;
+
+  w = Settings.ToPixel(w);
+  h = Settings.ToPixel(h);
+
   BRect r(0.0, 0.0, (w > 0 ? w : 1) - 1, (h > 0 ? h : 1) - 1);
 
   r.OffsetTo((float)(Settings.PixelConv(Data.Horiz) - (DrawDir < 0 ? w - 1 : 0)),
              (float)(Data.PixelV - h + 1));
 
-  vw->SetHighColor(0, 0, 0, 255);
-  vw->FillRect(r, B_SOLID_HIGH);
+  if (!Clip.IsValid() || r.Intersects(Clip))
+    rt->FillRule(r);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DrawPage::DrawLayout(const PageLayout *l)                                                                 //
+//                                                                                                                //
+// Draws the characters and rules of a page from its layout. Runs outside of `Clip' are skipped as a whole.       //
+//                                                                                                                //
+// const PageLayout *l                  layout of the page                                                        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DrawPage::DrawLayout(const PageLayout *l)
+{
+  float sf = Settings.ShrinkFactor();
+  BRect r;
+  uint  i, j;
+
+  for (i = 0; i < l->Runs.size() && !Settings.Cancelled(); i++)
+  {
+    const LayoutRun &run = l->Runs[i];
+
+    if (Clip.IsValid())
+    {
+      r.Set(run.Bounds.left  / sf - 2, run.Bounds.top    / sf - 2,
+            run.Bounds.right / sf + 2, run.Bounds.bottom / sf + 2);
+
+      if (!r.Intersects(Clip))
+        continue;
+    }
+
+    for (j = run.First; j < run.First + run.Count; j++)
+    {
+      const LayoutItem &item = l->Items[j];
+
+      Data.Horiz  = item.Horiz;
+      Data.Vert   = item.Vert;
+      Data.PixelV = Settings.PixelConv(item.Vert);
+
+      if (item.Fnt)
+        DrawChar(item.Fnt, item.Char, r);
+      else
+      {
+        DrawDir = item.DrawDir;
+        DrawRule(item.Width, item.Height);
+      }
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -856,24 +1025,9 @@ void DrawPage::SearchStatus::DrawRects()
 {
   int i;
 
-  if (dp->Settings.AntiAliasing && dp->Settings.ShrinkFactor > 1)
-  {
-    // we are in mode B_OP_MIN
-
-    dp->vw->SetHighColor(200, 200, 0, 255);
-
-    for (i = 0; i < Length; i++)
-      dp->vw->FillRect(Rects[i], B_SOLID_HIGH);
-  }
-  else
-  {
-    // we are in mode B_OP_OVER
-
-    dp->vw->SetHighColor(200, 0, 0, 255);
-
-    for (i = 0; i < Length; i++)
-      dp->vw->StrokeLine(Rects[i].LeftBottom(), Rects[i].RightBottom(), B_SOLID_HIGH);
+  if (dp->rt == NULL)                            // nothing is drawn in `ScanText' mode
+    return;
 
-    dp->vw->SetHighColor(0, 0, 0, 255);
-  }
+  for (i = 0; i < Length; i++)
+    dp->rt->Highlight(Rects[i]);
 }
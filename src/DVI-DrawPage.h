@@ -20,6 +20,12 @@
 #ifndef DVI_H
 #include "DVI.h"
 #endif
+#ifndef RENDERTARGET_H
+#include "RenderTarget.h"
+#endif
+#ifndef PAGELAYOUT_H
+#include "PageLayout.h"
+#endif
 
 typedef void (*SetCharProc)(DrawPage *, wchar, wchar);
 
@@ -77,9 +83,23 @@ class DrawPage
     typedef stack<FrameData, deque<FrameData, allocator<FrameData> > > FrameStack;
 
   public:
+    enum DrawMode
+    {
+      DrawAll,                 // draw the whole page
+      ScanLayout,              // only record the positions of characters and rules in `Layout'
+      DrawSpecials,            // only execute \special commands
+      PrepareGlyphs,           // only unpack and shrink the glyphs of a layout
+      DrawPrepared,            // draw a layout without modifying the fonts; used by the band threads
+      ScanText                 // only pass the characters to the search; neither draws nor modifies the fonts
+    };
+
     DVI          *Document;
-    BView        *vw;          // view to draw into
+    RenderTarget *rt;          // device to draw into
     DrawSettings Settings;
+    DrawMode     Mode;
+    BRect        Clip;         // if valid, everything outside is skipped
+    PageLayout   *Layout;      // layout recorded in `ScanLayout' mode
+    bool         Incomplete;   // placeholders have been drawn in preview mode
 
     // drawing state
 
@@ -114,6 +134,7 @@ class DrawPage
     DrawPage(const DrawSettings &set);
 
     void   InitPSIface();
+    void   DrawLayout(const PageLayout *l);
 
   private:
     void   ChangeFont(ulong n);
@@ -125,6 +146,7 @@ class DrawPage
     static void SetNormalChar(DrawPage *dp, wchar cmd, wchar c);
     static void SetVFChar    (DrawPage *dp, wchar cmd, wchar c);
 
+    void   DrawChar(Font *f, wchar c, BRect &r);
     void   DrawRule(long w, long h);
 
     uint32 ReadInt (ssize_t Size);
@@ -70,14 +70,16 @@ static uint      BBoxWidth;
 static uint      BBoxHeight;
 static int       BBoxVOffset;
 
+void DrawBBox(DrawPage *dp);
+
 inline int ConvX(DrawPage *dp, int x)
 {
-  return (dp->TPicConvert * x / dp->Settings.ShrinkFactor) + dp->Settings.PixelConv(dp->Data.Horiz);
+  return (int)(dp->TPicConvert * x / dp->Settings.ShrinkFactor()) + dp->Settings.PixelConv(dp->Data.Horiz);
 }
 
 inline int ConvY(DrawPage *dp, int y)
 {
-  return (dp->TPicConvert * y / dp->Settings.ShrinkFactor) + dp->Data.PixelV;
+  return (int)(dp->TPicConvert * y / dp->Settings.ShrinkFactor()) + dp->Data.PixelV;
 }
 
 static void SetPenSize(DrawPage *dp, char *cmd)
@@ -87,7 +89,7 @@ static void SetPenSize(DrawPage *dp, char *cmd)
   if (sscanf(cmd, " %d ", &Size) != 1)
     return;
 
-  PenSize = (2 * Size * (dp->Settings.DspInfo.PixelsPerInch / dp->Settings.ShrinkFactor) + 1000) / 2000;
+  PenSize = (2 * Size * dp->Settings.PixelConv(dp->Settings.DspInfo.PixelsPerInch << 16) + 1000) / 2000;
 
   if (PenSize < 1)
     PenSize = 1;
@@ -97,27 +99,23 @@ static void SetPenSize(DrawPage *dp, char *cmd)
 
 static void FlushPath(DrawPage *dp)
 {
-  const rgb_color black = {0, 0, 0, 255};
   int i;
 
   if (PathLen)
   {
-    dp->vw->BeginLineArray(PathLen);
+    dp->rt->BeginLineArray(PathLen);
 
     for (i = 1; i < PathLen; i++)
-      dp->vw->AddLine(BPoint(ConvX(dp, Points[i].x),     ConvY(dp, Points[i].y)),
-                      BPoint(ConvX(dp, Points[i + 1].x), ConvY(dp, Points[i + 1].y)),
-                      black);
+      dp->rt->AddLine(BPoint(ConvX(dp, Points[i].x),     ConvY(dp, Points[i].y)),
+                      BPoint(ConvX(dp, Points[i + 1].x), ConvY(dp, Points[i + 1].y)));
 
-    dp->vw->EndLineArray();
+    dp->rt->EndLineArray();
   }
   PathLen = 0;
 }
 
 static void FlushDashed(DrawPage *dp, char *cmd, bool dotted)
 {
-  const rgb_color black = {0, 0, 0, 255};
-
   int    i;
   int    NumDots;
   int    lx0, ly0, lx1, ly1;
@@ -148,7 +146,7 @@ static void FlushDashed(DrawPage *dp, char *cmd, bool dotted)
     if (NumDots == 0)
       NumDots = 1;
 
-    dp->vw->BeginLineArray(NumDots + 1);
+    dp->rt->BeginLineArray(NumDots + 1);
 
     for (i = 0; i <= NumDots; i++)
     {
@@ -157,11 +155,10 @@ static void FlushDashed(DrawPage *dp, char *cmd, bool dotted)
       cx0 = lx0 + a * dx + 0.5;
       cy0 = ly0 + a * dy + 0.5;
 
-      dp->vw->AddLine(BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
-                      BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
-                      black);
+      dp->rt->AddLine(BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
+                      BPoint(ConvX(dp, cx0), ConvY(dp, cy0)));
     }
-    dp->vw->EndLineArray();
+    dp->rt->EndLineArray();
   }
   else
   {
@@ -169,12 +166,11 @@ static void FlushDashed(DrawPage *dp, char *cmd, bool dotted)
 
     NumDots = d / (2.0 * MilliPerDash) + 1.0;
 
-    dp->vw->BeginLineArray(NumDots + 1);
+    dp->rt->BeginLineArray(NumDots + 1);
 
     if (NumDots <= 1)
-      dp->vw->AddLine(BPoint(ConvX(dp, lx0), ConvY(dp, ly0)),
-                      BPoint(ConvX(dp, lx1), ConvY(dp, ly1)),
-                      black);
+      dp->rt->AddLine(BPoint(ConvX(dp, lx0), ConvY(dp, ly0)),
+                      BPoint(ConvX(dp, lx1), ConvY(dp, ly1)));
     else
     {
       SpaceSize = (d - NumDots * MilliPerDash) / (NumDots - 1);
@@ -189,20 +185,18 @@ static void FlushDashed(DrawPage *dp, char *cmd, bool dotted)
         cx1 = lx0 + b * dx + 0.5;
         cy1 = ly0 + b * dy + 0.5;
 
-        dp->vw->AddLine(BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
-                        BPoint(ConvX(dp, cx1), ConvY(dp, cy1)),
-                        black);
+        dp->rt->AddLine(BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
+                        BPoint(ConvX(dp, cx1), ConvY(dp, cy1)));
 
         b += SpaceSize / d;
       }
       cx0 = lx0 + b * dx + 0.5;
       cy0 = ly0 + b * dy + 0.5;
 
-      dp->vw->AddLine(BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
-                      BPoint(ConvX(dp, lx1), ConvY(dp, ly1)),
-                      black);
+      dp->rt->AddLine(BPoint(ConvX(dp, cx0), ConvY(dp, cy0)),
+                      BPoint(ConvX(dp, lx1), ConvY(dp, ly1)));
     }
-    dp->vw->EndLineArray();
+    dp->rt->EndLineArray();
   }
 
   PathLen = 0;
@@ -237,7 +231,7 @@ static void Arc(DrawPage *dp, char *cmd, bool invis)
   StartAngle *= 180 / PI;
   EndAngle   *= 180 / PI;
 
-  dp->vw->StrokeArc(BPoint(ConvX(dp, CenterX), ConvY(dp, CenterY)),
+  dp->rt->StrokeArc(BPoint(ConvX(dp, CenterX), ConvY(dp, CenterY)),
                     ConvX(dp, RadX) - ConvX(dp, 0),
                     ConvY(dp, RadY) - ConvY(dp, 0),
                     StartAngle,
@@ -251,8 +245,6 @@ static inline int dist(int x0, int y0, int x1, int y1)
 
 static void FlushSpline(DrawPage *dp)
 {
-  const rgb_color black = {0, 0, 0, 255};
-
   int  xp, yp;
   int  N;
   int  LastX, LastY;
@@ -272,7 +264,7 @@ static void FlushSpline(DrawPage *dp)
     Steps = (dist(Points[i].x,   Points[i].y,   Points[i+1].x, Points[i+1].y) +
 		dist(Points[i+1].x, Points[i+1].y, Points[i+2].x, Points[i+2].y)) / 80;
 
-    dp->vw->BeginLineArray(Steps);
+    dp->rt->BeginLineArray(Steps);
 
     for (j = 0; j < Steps; j++)
     {
@@ -287,14 +279,13 @@ static void FlushSpline(DrawPage *dp)
       yp = (t1 * Points[i+2].y + t2 * Points[i+1].y + t3 * Points[i].y + 50000) / 100000;
 
       if (LastValid)
-        dp->vw->AddLine(BPoint(ConvX(dp, LastX), ConvY(dp, LastY)),
-                        BPoint(ConvX(dp, xp),    ConvY(dp, yp)),
-                        black);
+        dp->rt->AddLine(BPoint(ConvX(dp, LastX), ConvY(dp, LastY)),
+                        BPoint(ConvX(dp, xp),    ConvY(dp, yp)));
       LastX     = xp;
       LastY     = yp;
       LastValid = true;
     }
-    dp->vw->EndLineArray();
+    dp->rt->EndLineArray();
   }
 
   PathLen = 0;
@@ -408,6 +399,23 @@ static void PSfigSpecial(DrawPage *dp, char *cmd)
   int    RawW, RawH;
   int    Decompress;
 
+  // a preview only shows the frame of the figure, so GhostScript isn't started
+
+  if (dp->Settings.Preview)
+  {
+    if (strncmp(cmd, ":[begin]", 8) == 0 && sscanf(cmd + 8, "%d %d\n", &RawW, &RawH) >= 2)
+    {
+      BBoxValid   = true;
+      BBoxWidth   = dp->Settings.PixelConv(RawW * dp->DimConvert);
+      BBoxHeight  = dp->Settings.PixelConv(RawH * dp->DimConvert);
+      BBoxVOffset = 0;
+
+      DrawBBox(dp);
+    }
+    dp->Incomplete = true;
+    return;
+  }
+
   dp->InitPSIface();
 
   if (strncmp(cmd, ":[begin]", 8) == 0)
@@ -604,14 +612,20 @@ static void epsfSpecial(DrawPage *dp, char *cmd)
 
     BBoxWidth   = 0.1 * ((Flags & 0x10) ? KeyVal[4] :
                   KeyVal[5] * (KeyVal[2] - KeyVal[0]) / (KeyVal[3] - KeyVal[1])) *
-                  dp->DimConvert / dp->Settings.ShrinkFactor + 0.5;
+                  dp->DimConvert / dp->Settings.ShrinkFactor() + 0.5;
     BBoxHeight  = 0.1 * ((Flags & 0x20) ? KeyVal[5] :
                   KeyVal[4] * (KeyVal[3] - KeyVal[1]) / (KeyVal[2] - KeyVal[0])) *
-                  dp->DimConvert / dp->Settings.ShrinkFactor + 0.5;
+                  dp->DimConvert / dp->Settings.ShrinkFactor() + 0.5;
     BBoxVOffset = BBoxHeight;
   }
 
-  if (!Name.empty())
+  if (!Name.empty() && dp->Settings.Preview)
+  {
+    DrawBBox(dp);
+
+    dp->Incomplete = true;
+  }
+  else if (!Name.empty())
   {
     log_info("loading eps file `%s'", Name.c_str());
 
@@ -627,6 +641,12 @@ static void epsfSpecial(DrawPage *dp, char *cmd)
 
 static void QuoteSpecial(DrawPage *dp, char *cmd)
 {
+  if (dp->Settings.Preview)
+  {
+    dp->Incomplete = true;
+    return;
+  }
+
   dp->InitPSIface();
   dp->PSIface->DrawBegin(dp, dp->Settings.PixelConv(dp->Data.Horiz), dp->Data.PixelV, "@beginspecial @setspecial ");
   dp->PSIface->DrawRaw(cmd);
@@ -635,6 +655,12 @@ static void QuoteSpecial(DrawPage *dp, char *cmd)
 
 static void BangSpecial(DrawPage *dp, char *cmd)
 {
+  if (dp->Settings.Preview)
+  {
+    dp->Incomplete = true;
+    return;
+  }
+
   dp->InitPSIface();
   dp->PSIface->DrawBegin(dp, dp->Settings.PixelConv(dp->Data.Horiz), dp->Data.PixelV, "@defspecial ");
   dp->PSIface->DrawRaw(cmd);
@@ -647,7 +673,7 @@ void DrawBBox(DrawPage *dp)
 {
   if (BBoxValid)
   {
-    dp->vw->StrokeRect(BRect(dp->Settings.PixelConv(dp->Data.Horiz),
+    dp->rt->StrokeRect(BRect(dp->Settings.PixelConv(dp->Data.Horiz),
                              dp->Data.PixelV - BBoxVOffset,
                              dp->Settings.PixelConv(dp->Data.Horiz) + BBoxWidth - 1,
                              dp->Data.PixelV - BBoxVOffset + BBoxHeight));
@@ -678,6 +704,15 @@ void DrawPage::Special(long len)
   char        *str;
   char        *p;
 
+  if (Mode == ScanLayout || Mode == ScanText)
+  {
+    if (Mode == ScanLayout)
+      Layout->HasSpecials = true;
+
+    Skip(len);
+    return;
+  }
+
   try
   {
     if (CmdLen < len)
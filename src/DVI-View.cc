@@ -18,6 +18,9 @@
 #include "BeDVI.h"
 #include "DVI-View.h"
 #include "TeXFont.h"
+#include "PageLayout.h"
+#include "RenderTarget.h"
+#include "TextIndex.h"
 #include "log.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -37,12 +40,40 @@ DVIView::DVIView(BRect rect, const char *Name):
   Document(NULL),
   Settings(((ViewApplication *)be_app)->Settings),
   BufferLock(B_ERROR),
-  Buffer(NULL),
+  Tiles(NULL),
+  Pages(NULL),
+  TileBuffer(NULL),
   BufferView(NULL),
   MagnifyBuffer(NULL),
+  MagnifyBack(NULL),
+  RenderSem(B_ERROR),
+  Renderer(B_ERROR),
+  CancelRender(false),
+  PrerenderSem(B_ERROR),
+  Prerenderer(B_ERROR),
+  CancelPrerender(false),
+  Quitting(false),
+  Index(NULL),
+  Indexer(B_ERROR),
+  CancelIndex(false),
+  Searcher(B_ERROR),
+  CancelSearch(false),
+  SearchId(0),
+  SearchDone(false),
   MagnifyWinSize(BaseMagnifyWinSize),
   ShowMagnify(false),
-  PageNo(1)
+  MagnifyRequested(false),
+  MagnifyValid(false),
+  PageNo(1),
+  Loaded(false),
+  TargetPage(1),
+  TargetScroll(ScrollNone),
+  PageRequested(false),
+  ChangeRequested(false),
+  NewPage(1),
+  NewScroll(ScrollNone),
+  SearchRequested(false),
+  SearchForwards(true)
 {
   if ((DocLock = create_sem(1, "document")) < B_OK)
     throw(runtime_error("can't create semaphore"));
@@ -50,8 +81,28 @@ DVIView::DVIView(BRect rect, const char *Name):
   if ((BufferLock = create_sem(1, "buffer")) < B_OK)
     throw(runtime_error("can't create semaphore"));
 
+  if ((RenderSem = create_sem(0, "render")) < B_OK)
+    throw(runtime_error("can't create semaphore"));
+
+  if ((PrerenderSem = create_sem(0, "prerender")) < B_OK)
+    throw(runtime_error("can't create semaphore"));
+
+  Tiles      = new TileCache;
+  Pages      = new PageCache(PageCacheSize);
   BufferView = new BView(BRect(0, 0, 1, 1), NULL, 0, 0);
 
+  // without this thread nothing would ever be drawn
+
+  if ((Renderer = spawn_thread(RenderThread, "render page", B_DISPLAY_PRIORITY, this)) < B_OK)
+    throw(runtime_error("can't start rendering thread"));
+
+  resume_thread(Renderer);
+
+  if ((Prerenderer = spawn_thread(PrerenderThread, "prerender pages", B_LOW_PRIORITY, this)) >= B_OK)
+    resume_thread(Prerenderer);
+  else
+    log_warn("can't start prerendering thread!");
+
   SetViewColor(B_TRANSPARENT_32_BIT);
 }
 
@@ -65,6 +116,30 @@ DVIView::DVIView(BRect rect, const char *Name):
 
 DVIView::~DVIView()
 {
+  status_t res;
+
+  Quitting     = true;
+  CancelRender = true;
+
+  if (Renderer >= B_OK)
+  {
+    release_sem(RenderSem);
+    wait_for_thread(Renderer, &res);
+  }
+  if (RenderSem >= B_OK)
+    delete_sem(RenderSem);
+
+  if (Prerenderer >= B_OK)
+  {
+    release_sem(PrerenderSem);
+    wait_for_thread(Prerenderer, &res);
+  }
+  if (PrerenderSem >= B_OK)
+    delete_sem(PrerenderSem);
+
+  StopSearch();
+  StopIndexer();
+
   if (DocLock >= B_OK)
   {
     acquire_sem(DocLock);
@@ -77,23 +152,17 @@ DVIView::~DVIView()
     delete Document;
 
   if (BufferLock >= B_OK)
-  {
     acquire_sem(BufferLock);
 
-    if (Buffer)
-      delete Buffer;
-    else                    // deleted automatically if BBitmap is deleted
-      delete BufferView;
+  delete Tiles;
+  delete Pages;
+  delete TileBuffer;
+  delete MagnifyBuffer;
+  delete MagnifyBack;
+  delete BufferView;        // never attached to a bitmap at this point
 
+  if (BufferLock >= B_OK)
     delete_sem(BufferLock);
-  }
-  else
-  {
-    if (Buffer)
-      delete Buffer;
-    else                    // deleted automatically if BBitmap is deleted
-      delete BufferView;
-  }
 
   ((ViewApplication *)be_app)->Settings = Settings;
 }
@@ -114,12 +183,27 @@ void DVIView::Draw(BRect r)
     return;
   }
 
-  if (Buffer != NULL && acquire_sem_etc(BufferLock, 1, B_TIMEOUT, 0) == B_OK)
+  // the buffers are only locked briefly by the rendering threads, which also change the displayed page
+
+  if (acquire_sem(BufferLock) < B_OK)
+    return;
+
+  if (Loaded)
   {
-    DrawBitmapAsync(Buffer, r, r);
+    BBitmap *bm = NULL;
+
+    bm = Pages->Find(CacheKey(PageNo));
+
+    if (bm)
+      DrawBitmapAsync(bm, r, r);
+    else
+      DrawTiles(r);
 
-    if (ShowMagnify && MagnifyBuffer)
-      DrawBitmapAsync(MagnifyBuffer, BPoint(MousePos.x - MagnifyWinSize, MousePos.y - MagnifyWinSize));
+    if (!Highlights.empty())
+      DrawHighlights(r);
+
+    if (ShowMagnify && MagnifyValid)
+      DrawBitmapAsync(MagnifyBuffer, BPoint(MagnifyPos.x - MagnifyWinSize, MagnifyPos.y - MagnifyWinSize));
 
     release_sem(BufferLock);
 
@@ -132,7 +216,11 @@ void DVIView::Draw(BRect r)
     }
   }
   else
+  {
+    release_sem(BufferLock);
+
     FillRect(Bounds(), B_SOLID_LOW);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -158,6 +246,10 @@ void DVIView::MessageReceived(BMessage *msg)
         Reload();
         break;
 
+      case MsgFontsReady:
+        ReloadForFonts();
+        break;
+
       case MsgPrintPage:
         if (Document)
         {
@@ -196,6 +288,35 @@ void DVIView::MessageReceived(BMessage *msg)
         Search(str, (msg->what == MsgSearchForwards));
         break;
       }
+      case MsgFindAll:
+      {
+        BMessenger Reply;
+        char       *str;
+
+        if (msg->FindString("Search Text", &str) != B_OK)
+        {
+          log_warn("invalide message received!");
+          break;
+        }
+
+        msg->FindMessenger("Reply", &Reply);            // optional
+
+        FindAll(str, Reply);
+        break;
+      }
+      case MsgSearchHit:
+      case MsgSearchDone:
+        SearchResult(msg);
+        break;
+
+      case MsgShowHit:
+      {
+        int32 index;
+
+        if (msg->FindInt32("Index", &index) == B_OK)
+          ShowHit(index);
+        break;
+      }
       case MsgAntiAliasing:
         ToggleAntiAliasing();
         break;
@@ -205,19 +326,19 @@ void DVIView::MessageReceived(BMessage *msg)
         break;
 
       case MsgNext:
-        SetPage(PageNo + 1);
+        RequestPage(RequestedPage() + 1);
         break;
 
       case MsgPrev:
-        SetPage(PageNo - 1);
+        RequestPage(RequestedPage() - 1);
         break;
 
       case MsgFirst:
-        SetPage(1);      
+        RequestPage(1);
         break;
 
       case MsgLast:
-        SetPage(INT_MAX);
+        RequestPage(INT_MAX);
         break;
 
       case B_GET_PROPERTY:
@@ -228,6 +349,50 @@ void DVIView::MessageReceived(BMessage *msg)
         SetProperty(msg);
         break;
 
+      case MsgShowPage:
+        ShowRequestedPage();
+        break;
+
+      case MsgPageShown:
+      {
+        BRect r = Bounds();
+        int32 scroll;
+
+        if (msg->FindInt32("Scroll", &scroll) != B_OK)
+          scroll = ScrollNone;
+
+        switch (scroll)
+        {
+          case ScrollTop:
+            ScrollTo(r.left, 0.0);
+            break;
+
+          case ScrollBottom:
+            ScrollTo(r.left, DocHeight - r.bottom + r.top - 1.0);
+            break;
+
+          default:
+            break;
+        }
+
+        UpdatePageCounter();
+        Invalidate();
+        break;
+      }
+
+      case MsgLabelsRead:
+        UpdatePageCounter();
+        break;
+
+      case MsgRendered:
+      {
+        BRect r;
+
+        if (msg->FindRect("Rect", &r) == B_OK)
+          Invalidate(r);
+        break;
+      }
+
       case B_MOUSE_UP:
       {
         BPoint p;
@@ -280,68 +445,56 @@ void DVIView::KeyDown(const char *bytes, int32 numBytes)
     case B_PAGE_DOWN:
     case B_SPACE:
       if (modifiers() & B_SHIFT_KEY)
-        SetPage(PageNo + 1);
+        RequestPage(RequestedPage() + 1);
       else
       {
-        if (r.top < MaxY)
+        if (r.top < MaxY && !PageRequested)
           ScrollTo(r.left, min_c(r.bottom - 20.0, MaxY));
         else
-        {
-          if (SetPage(PageNo + 1))
-            ScrollTo(r.left, 0.0);
-        }
+          RequestPage(RequestedPage() + 1, ScrollTop);
       }
       break;
 
     case B_PAGE_UP:
     case B_BACKSPACE:
       if (modifiers() & B_SHIFT_KEY)
-        SetPage(PageNo - 1);
+        RequestPage(RequestedPage() - 1);
       else
       {
-        if (r.top > 0.0)
+        if (r.top > 0.0 && !PageRequested)
           ScrollTo(r.left, max_c(2 * r.top - r.bottom + 20.0, 0.0));
         else
-        {
-          if (SetPage(PageNo - 1))
-            ScrollTo(r.left, MaxY);
-        }
+          RequestPage(RequestedPage() - 1, ScrollBottom);
       }
       break;
 
     case B_HOME:
       if (modifiers() & B_SHIFT_KEY)
-        SetPage(1);
+        RequestPage(1);
       else
         ScrollTo(r.left, 0.0);
       break;
 
     case B_END:
       if (modifiers() & B_SHIFT_KEY)
-        SetPage(INT_MAX);
+        RequestPage(INT_MAX);
       else
         ScrollTo(r.left, MaxY);
       break;
 
     case B_DOWN_ARROW:
     case B_RETURN:
-      if (r.top < MaxY)
+      if (r.top < MaxY && !PageRequested)
         ScrollTo(r.left, min_c(r.top + Factor * h, MaxY));
       else
-      {
-        if (SetPage(PageNo + 1))
-          ScrollTo(r.left, 0.0);
-      }
+        RequestPage(RequestedPage() + 1, ScrollTop);
       break;
 
     case B_UP_ARROW:
-      if (r.top > 0.0)
+      if (r.top > 0.0 && !PageRequested)
         ScrollTo(r.left, max_c(r.top - Factor * h, 0.0));
       else
-      {
-        if (SetPage(PageNo - 1))
-          ScrollTo(r.left, MaxY);
-      }
+        RequestPage(RequestedPage() - 1, ScrollBottom);
       break;
 
     case B_LEFT_ARROW:
@@ -353,19 +506,19 @@ void DVIView::KeyDown(const char *bytes, int32 numBytes)
       break;
 
     case '+':
-      SetPage(PageNo + 1);
+      RequestPage(RequestedPage() + 1);
       break;
 
     case '-':
-      SetPage(PageNo - 1);
+      RequestPage(RequestedPage() - 1);
       break;
 
     case '<':
-      SetPage(1);
+      RequestPage(1);
       break;
 
     case '>':
-      SetPage(INT_MAX);
+      RequestPage(INT_MAX);
       break;
 
     case '*':
@@ -414,15 +567,20 @@ void DVIView::KeyDown(const char *bytes, int32 numBytes)
     case '4':
     case '5':
     case '6':
-      SetShrinkFactor(bytes[0] - '0');
+      SetShrink((bytes[0] - '0') * DrawSettings::ShrinkOne);
       break;
 
     case '7':
-      SetShrinkFactor(9);
+      SetShrink(9 * DrawSettings::ShrinkOne);
       break;
 
     case '8':
-      SetShrinkFactor(12);
+      SetShrink(12 * DrawSettings::ShrinkOne);
+      break;
+
+    case 'w':
+    case 'W':
+      FitWidth();
       break;
 
     default:
@@ -454,32 +612,21 @@ void DVIView::MouseDown(BPoint where)
 
   MousePos = where;
 
-  if (!ShowMagnify && Settings.ShrinkFactor != 1)
+  if (!ShowMagnify && Settings.Shrink != DrawSettings::ShrinkOne)
   {
-    if (acquire_sem(DocLock) < B_OK)
-      return;
-
     ShowMagnify  = true;
+    MagnifyValid = false;                 // don't show a window drawn for another position
 
-    RedrawMagnifyBuffer();
-
-    release_sem(DocLock);
+    RequestMagnify();                     // the window appears when it has been drawn
 
     be_app->HideCursor();
-
-    if (Window()->Lock())
-    {
-      Draw(BRect(MousePos.x - MagnifyWinSize, MousePos.y - MagnifyWinSize,
-                 MousePos.x + MagnifyWinSize, MousePos.y + MagnifyWinSize));
-      Window()->Unlock();
-    }
   }
   if (((ViewApplication *)be_app)->MeasureWinOpen && Window()->IsActive())
   {
     BMessage msg(MsgPoint);
 
-    msg.AddFloat("x", (double)MousePos.x * Settings.ShrinkFactor / Settings.DspInfo.PixelsPerInch);
-    msg.AddFloat("y", (double)MousePos.y * Settings.ShrinkFactor / Settings.DspInfo.PixelsPerInch);
+    msg.AddFloat("x", (double)MousePos.x * Settings.ShrinkFactor() / Settings.DspInfo.PixelsPerInch);
+    msg.AddFloat("y", (double)MousePos.y * Settings.ShrinkFactor() / Settings.DspInfo.PixelsPerInch);
 
     be_app->PostMessage(&msg);
 
@@ -521,19 +668,16 @@ void DVIView::MouseUp(BPoint where)
 
   if (ShowMagnify)
   {
-    ShowMagnify = false;
+    ShowMagnify  = false;
+    MagnifyValid = false;
 
     be_app->ShowCursor();
 
     if (((ViewApplication *)be_app)->MeasureWinOpen)
       Invalidate();
     else
-      if (LockLooper())
-      {
-        Draw(BRect(MousePos.x - MagnifyWinSize, MousePos.y - MagnifyWinSize,
-                   MousePos.x + MagnifyWinSize, MousePos.y + MagnifyWinSize));
-        UnlockLooper();
-      }
+      Invalidate(BRect(MagnifyPos.x - MagnifyWinSize, MagnifyPos.y - MagnifyWinSize,
+                       MagnifyPos.x + MagnifyWinSize, MagnifyPos.y + MagnifyWinSize));
   }
   else if (((ViewApplication *)be_app)->MeasureWinOpen && Window()->IsActive())
   {
@@ -549,8 +693,8 @@ void DVIView::MouseUp(BPoint where)
   {
     BMessage msg(MsgPoint);
 
-    msg.AddFloat("x", (double)MousePos.x * Settings.ShrinkFactor / Settings.DspInfo.PixelsPerInch);
-    msg.AddFloat("y", (double)MousePos.y * Settings.ShrinkFactor / Settings.DspInfo.PixelsPerInch);
+    msg.AddFloat("x", (double)MousePos.x * Settings.ShrinkFactor() / Settings.DspInfo.PixelsPerInch);
+    msg.AddFloat("y", (double)MousePos.y * Settings.ShrinkFactor() / Settings.DspInfo.PixelsPerInch);
 
     be_app->PostMessage(&msg);
   }
@@ -591,8 +735,8 @@ void DVIView::MouseMoved(BPoint where, uint32 /* code */, const BMessage * /* ms
   {
     BMessage msg(MsgPoint);
 
-    msg.AddFloat("x", (double)where.x * Settings.ShrinkFactor / Settings.DspInfo.PixelsPerInch);
-    msg.AddFloat("y", (double)where.y * Settings.ShrinkFactor / Settings.DspInfo.PixelsPerInch);
+    msg.AddFloat("x", (double)where.x * Settings.ShrinkFactor() / Settings.DspInfo.PixelsPerInch);
+    msg.AddFloat("y", (double)where.y * Settings.ShrinkFactor() / Settings.DspInfo.PixelsPerInch);
 
     be_app->PostMessage(&msg);
 
@@ -607,32 +751,9 @@ void DVIView::MouseMoved(BPoint where, uint32 /* code */, const BMessage * /* ms
 
   if (ShowMagnify)
   {
-    BRect UpdateRect(MousePos.x, MousePos.y, MousePos.x, MousePos.y);
-
     MousePos = where;
 
-    if (acquire_sem(DocLock) < B_OK)
-      return;
-
-    RedrawMagnifyBuffer();
-
-    release_sem(DocLock);
-
-    if (UpdateRect.left   > MousePos.x)  UpdateRect.left   = MousePos.x;
-    if (UpdateRect.top    > MousePos.y)  UpdateRect.top    = MousePos.y;
-    if (UpdateRect.right  < MousePos.x)  UpdateRect.right  = MousePos.x;
-    if (UpdateRect.bottom < MousePos.y)  UpdateRect.bottom = MousePos.y;
-
-    UpdateRect.left   -= MagnifyWinSize;
-    UpdateRect.top    -= MagnifyWinSize;
-    UpdateRect.right  += MagnifyWinSize;
-    UpdateRect.bottom += MagnifyWinSize;
-
-    if (LockLooper())
-    {
-      Draw(UpdateRect);
-      UnlockLooper();
-    }
+    RequestMagnify();                     // the window is moved when it has been redrawn
   }
   else if (((ViewApplication *)be_app)->MeasureWinOpen && Window()->IsActive())
   {
@@ -655,7 +776,10 @@ property_info DVIView::PropertyList[] =
 {
   {"Page",    {B_GET_PROPERTY, B_SET_PROPERTY, 0}, {B_DIRECT_SPECIFIER, 0}, "get or set displayed page",          0},
   {"IncPage", {B_SET_PROPERTY, 0},                 {B_DIRECT_SPECIFIER, 0}, "increment number of displayed page", 0},
+  {"Label",   {B_GET_PROPERTY, B_SET_PROPERTY, 0}, {B_DIRECT_SPECIFIER, 0}, "get or set printed page number",     0},
   {"Shrink",  {B_GET_PROPERTY, B_SET_PROPERTY, 0}, {B_DIRECT_SPECIFIER, 0}, "get or set shrink factor",           0},
+  {"Hits",    {B_GET_PROPERTY, B_SET_PROPERTY, 0}, {B_DIRECT_SPECIFIER, 0}, "get hits or search for all hits",    0},
+  {"Hit",     {B_SET_PROPERTY, 0},                 {B_DIRECT_SPECIFIER, 0}, "show hit with the given index",      0},
   0
 };
 
@@ -672,7 +796,10 @@ BHandler *DVIView::ResolveSpecifier(BMessage *msg, int32 index, BMessage *specif
 {
   if (strcmp(property, "Page")    == 0 ||
       strcmp(property, "IncPage") == 0 ||
-      strcmp(property, "Shrink")  == 0)
+      strcmp(property, "Label")   == 0 ||
+      strcmp(property, "Shrink")  == 0 ||
+      strcmp(property, "Hits")    == 0 ||
+      strcmp(property, "Hit")     == 0)
     return this;
 
   return inherited::ResolveSpecifier(msg, index, specifier, form, property);
@@ -720,7 +847,23 @@ void DVIView::GetProperty(BMessage *msg)
     BMessage Reply(B_REPLY);
     status_t err;
 
-    err = Reply.AddInt32("result", PageNo);
+    err = Reply.AddInt32("result", RequestedPage());
+
+    Reply.AddInt32("error", err);
+
+    msg->SendReply(&Reply);
+  }
+  else if (strcmp(Property, "Label") == 0)
+  {
+    BMessage Reply(B_REPLY);
+    string   Label;
+    status_t err = B_ERROR;
+
+    if (Document)
+      Label = Document->PageLabel(PageNo);
+
+    if (!Label.empty())
+      err = Reply.AddString("result", Label.c_str());
 
     Reply.AddInt32("error", err);
 
@@ -731,7 +874,30 @@ void DVIView::GetProperty(BMessage *msg)
     BMessage Reply(B_REPLY);
     status_t err;
 
-    err = Reply.AddInt32("result", Settings.ShrinkFactor);
+    // a shrink factor which isn't an integer is returned as float
+
+    if (Settings.Shrink % DrawSettings::ShrinkOne == 0)
+      err = Reply.AddInt32("result", Settings.Shrink / DrawSettings::ShrinkOne);
+    else
+      err = Reply.AddFloat("result", Settings.ShrinkFactor());
+
+    Reply.AddInt32("error", err);
+
+    msg->SendReply(&Reply);
+  }
+  else if (strcmp(Property, "Hits") == 0)
+  {
+    BMessage Reply(B_REPLY);
+    status_t err = B_OK;
+    uint     i;
+
+    for (i = 0; i < Hits.size() && err == B_OK; i++)
+      if ((err = Reply.AddInt32("result", Hits[i].Page)) == B_OK &&
+          (err = Reply.AddRect( "rect",   Hits[i].Rect)) == B_OK)
+        err = Reply.AddString("context", Hits[i].Context.c_str());
+
+    if (err == B_OK)
+      err = Reply.AddBool("done", SearchDone);
 
     Reply.AddInt32("error", err);
 
@@ -774,16 +940,51 @@ void DVIView::SetProperty(BMessage *msg)
       log_warn("invalid message received!");
       return;
     }
-    SetPage(PageNo + Index);
+    SetPage(RequestedPage() + Index);
+  }
+  else if (strcmp(Property, "Label") == 0)
+  {
+    const char *str;
+
+    if (msg->FindString("data", &str) != B_OK)
+    {
+      log_warn("invalid message received!");
+      return;
+    }
+    SetPage(str);
   }
   else if (strcmp(Property, "Shrink") == 0)
+  {
+    float sf;
+
+    if (msg->FindInt32("data", &Index) == B_OK)
+      sf = Index;
+    else if (msg->FindFloat("data", &sf) != B_OK)
+    {
+      log_warn("invalid message received!");
+      return;
+    }
+    SetShrink((int32)(sf * DrawSettings::ShrinkOne + 0.5));
+  }
+  else if (strcmp(Property, "Hits") == 0)
+  {
+    const char *str;
+
+    if (msg->FindString("data", &str) != B_OK)
+    {
+      log_warn("invalid message received!");
+      return;
+    }
+    FindAll(str, BMessenger());
+  }
+  else if (strcmp(Property, "Hit") == 0)
   {
     if (msg->FindInt32("data", &Index) != B_OK)
     {
       log_warn("invalid message received!");
       return;
     }
-    SetShrinkFactor(Index);
+    ShowHit(Index);
   }
 }
 
@@ -801,7 +1002,10 @@ void DVIView::SetProperty(BMessage *msg)
 void DVIView::SetDocument(DVI *doc, uint NewPageNo)
 {
   DVI  *OldDoc;
-  uint OldPageNo;
+  bool Changed = false;
+
+  StopSearch();
+  StopIndexer();
 
   if (acquire_sem(DocLock) < B_OK)
   {
@@ -809,23 +1013,25 @@ void DVIView::SetDocument(DVI *doc, uint NewPageNo)
     return;
   }
 
-  OldDoc    = Document;
-  OldPageNo = PageNo;
+  OldDoc = Document;
 
   try
   {
     Document = doc;
-    PageNo   = NewPageNo;
 
-    if (DocumentChanged())
+    if ((Changed = DocumentChanged()))
+    {
       delete OldDoc;
 
+      if (Document)
+        Document->SetLabelTarget(BMessenger(this));
+    }
+
     else
     {
       delete Document;
 
       Document = OldDoc;
-      PageNo   = OldPageNo;
     }
   }
   catch(const exception &e)
@@ -836,7 +1042,7 @@ void DVIView::SetDocument(DVI *doc, uint NewPageNo)
     delete Document;
 
     Document = OldDoc;
-    PageNo   = OldPageNo;
+    Changed  = false;
   }
   catch(...)
   {
@@ -846,11 +1052,27 @@ void DVIView::SetDocument(DVI *doc, uint NewPageNo)
     delete Document;
 
     Document = OldDoc;
-    PageNo   = OldPageNo;
+    Changed  = false;
+  }
+
+  // requests for the old document are dropped
+
+  if (acquire_sem(BufferLock) == B_OK)
+  {
+    if (Changed)
+      PageNo = NewPageNo;
+
+    Loaded          = (Document != NULL);
+    ChangeRequested = false;
+    SearchRequested = false;
+
+    release_sem(BufferLock);
   }
 
   release_sem(DocLock);
 
+  StartIndexer();
+
   UpdateWindow();
 }
 
@@ -871,6 +1093,9 @@ DVI *DVIView::UnsetDocument()
   if (!Document)
     return NULL;
 
+  StopSearch();
+  StopIndexer();
+
   if (acquire_sem(DocLock) < B_OK)
     return NULL;
 
@@ -878,6 +1103,15 @@ DVI *DVIView::UnsetDocument()
 
   Document = NULL;
 
+  if (acquire_sem(BufferLock) == B_OK)
+  {
+    Loaded          = false;
+    ChangeRequested = false;
+    SearchRequested = false;
+
+    release_sem(BufferLock);
+  }
+
   release_sem(DocLock);
 
   UpdateWindow();
@@ -899,7 +1133,7 @@ void DVIView::PrintPage(uint no)
 {
   DrawSettings set = Settings;
 
-  set.ShrinkFactor = 1;
+  set.Shrink = DrawSettings::ShrinkOne;
 
   if (!Document)
     return;
@@ -916,416 +1150,1788 @@ void DVIView::PrintPage(uint no)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// bool DVIView::SetPage(int no)                                                                                  //
+// bool DVIView::SetPage(int no, ScrollMode scroll = ScrollNone)                                                  //
 //                                                                                                                //
-// Sets the displayed page of the document.                                                                       //
+// Sets the displayed page of the document. The page is changed by the render thread, which posts `MsgPageShown'  //
+// when it is done, so the window thread never waits for the document.                                            //
 //                                                                                                                //
-// int no                               page number                                                               //
+// int        no                        page number                                                               //
+// ScrollMode scroll                    where to scroll if the page changes                                       //
 //                                                                                                                //
-// Result:                              `true' if the page number changed, `false' if it remains the same         //
+// Result:                              `true' if the page number changes, `false' if it remains the same         //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool DVIView::SetPage(int no)
+bool DVIView::SetPage(int no, ScrollMode scroll)
 {
   log_info("page: %u", no);
 
-  if (no != PageNo && Document)
-  {
-    if (acquire_sem(DocLock) < B_OK)
-      return false;
-
-    if (no < 1)
-      no = 1;
-    if (no > Document->NumPages)
-      no = Document->NumPages;
-
-    if (PageNo != no)
-    {
-      PageNo = no;
-
-      SearchString.erase();
+  if (!Document)
+    return false;
 
-      RedrawBuffer();
-    }
-    else
-      no = 0;
+  if (no > (int)Document->NumberOfPages())
+    no = Document->NumberOfPages();
+  if (no < 1)
+    no = 1;
 
-    release_sem(DocLock);
-  }
-  else
-    no = 0;
+  if ((uint)no == RequestedPage())
+    return false;
 
-  if (LockLooper())
-  {
-    UpdatePageCounter();
-    Invalidate();
-    UnlockLooper();
-  }
+  RequestChange(no, scroll, string(), RectList());
 
-  return no > 0;
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::SetShrinkFactor(ushort sf)                                                                       //
+// bool DVIView::SetPage(const char *Label)                                                                       //
 //                                                                                                                //
-// Draws or clears the lines indicating the border of the page.                                                   //
+// Displays the page with the given printed number. If several pages have it, the next one is taken. A number     //
+// preceded by `#' or one which isn't printed on any page is taken as the index of the page in the file.          //
 //                                                                                                                //
-// ushort sf                            factor to shrink document                                                 //
+// const char *Label                    page number                                                               //
+//                                                                                                                //
+// Result:                              `true' if the page number changed, `false' if it remains the same         //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::SetShrinkFactor(ushort sf)
+bool DVIView::SetPage(const char *Label)
 {
-  Settings.ShrinkFactor = sf;
+  ulong no = 0;
 
-  Reload();
+  if (!Document)
+    return false;
 
-  UpdateWindow();
+  if (*Label != '#')
+    no = Document->FindLabel(Label, PageNo);
+
+  if (no == 0 && sscanf(*Label == '#' ? Label + 1 : Label, "%lu", &no) != 1)
+    return false;
+
+  return SetPage((int)no);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::ToggleBorderLine()                                                                               //
+// void DVIView::RequestPage(int no, ScrollMode scroll = ScrollNone)                                              //
 //                                                                                                                //
-// Draws or clears the lines indicating the border of the page.                                                   //
+// Changes the displayed page as soon as all pending input has been handled. Several requests in a row are        //
+// combined so that only the last page is drawn, and prerendering of the pages we are leaving is cancelled.       //
+//                                                                                                                //
+// int        no                        page number                                                               //
+// ScrollMode scroll                    where to scroll if the page has changed                                   //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::ToggleBorderLine()
+void DVIView::RequestPage(int no, ScrollMode scroll)
 {
-  if (acquire_sem(DocLock) < B_OK)
+  if (!Document)
     return;
 
-  Settings.BorderLine = !Settings.BorderLine;
-
-  ((BMenu *)Window()->FindView("Menu"))->FindItem(MsgBorderLine)->SetMarked(Settings.BorderLine);
-
-  RedrawBuffer();
+  if (no < 1)
+    no = 1;
+  if (no > Document->NumPages)
+    no = Document->NumPages;
 
-  release_sem(DocLock);
+  TargetPage   = no;
+  TargetScroll = scroll;
 
-  if (LockLooper())
+  if (!PageRequested)
   {
-    Invalidate();
-    UnlockLooper();
+    BMessage msg(MsgShowPage);
+
+    if (Window()->PostMessage(&msg, this) < B_OK)
+    {
+      ShowRequestedPage();
+      return;
+    }
+    PageRequested = true;
   }
+
+  CancelPrerender = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::ToggleAntiAliasing()                                                                             //
+// uint DVIView::RequestedPage()                                                                                  //
 //                                                                                                                //
-// Draws or clears the lines indicating the border of the page.                                                   //
+// Returns the page which will be displayed after all pending requests have been handled.                         //
+//                                                                                                                //
+// Result:                              page number                                                               //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::ToggleAntiAliasing()
+uint DVIView::RequestedPage()
 {
-  if (acquire_sem(DocLock) < B_OK)
-    return;
-
-  Settings.AntiAliasing = !Settings.AntiAliasing;
+  uint no = PageNo;
 
-  ((BMenu *)Window()->FindView("Menu"))->FindItem(MsgAntiAliasing)->SetMarked(Settings.AntiAliasing);
-
-  if (Document)
-    Document->Fonts.FlushShrinkedGlyphes();
+  if (PageRequested)
+    return TargetPage;
 
-  RedrawBuffer();
-
-  release_sem(DocLock);
-
-  if (LockLooper())
+  if (acquire_sem(BufferLock) == B_OK)
   {
-    Invalidate();
-    UnlockLooper();
+    if (ChangeRequested)
+      no = NewPage;
+
+    release_sem(BufferLock);
   }
+  return no;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::UpdateWindow()                                                                                   //
+// void DVIView::ShowRequestedPage()                                                                              //
 //                                                                                                                //
-// Updates the window completely.                                                                                 //
+// Displays the page set by `RequestPage'.                                                                        //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::UpdateWindow()
+void DVIView::ShowRequestedPage()
 {
-  if (LockLooper())
-  {
-    UpdateMenus();
+  PageRequested = false;
 
-    UnlockLooper();
-  }
-  inherited::UpdateWindow();
+  SetPage(TargetPage, TargetScroll);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::UpdateMenus()                                                                                    //
+// void DVIView::RequestChange(uint no, ScrollMode scroll, const string &str, const RectList &Found)              //
 //                                                                                                                //
-// Updates the marked menu items.                                                                                 //
+// Asks the render thread to display a page. A request which hasn't been handled yet is replaced.                 //
+//                                                                                                                //
+// uint           no                    page number                                                               //
+// ScrollMode     scroll                where to scroll if the page changes                                       //
+// const string   &str                  string whose hits are highlighted                                         //
+// const RectList &Found                hits on the page in unshrunk pixels                                       //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::UpdateMenus()
+void DVIView::RequestChange(uint no, ScrollMode scroll, const string &str, const RectList &Found)
 {
-  BMenu *Menu;
-  int   i;
+  if (acquire_sem(BufferLock) < B_OK)
+    return;
 
-  Menu = ((BMenu *)Window()->FindView("Menu"));
+  ChangeRequested = true;
+  NewPage         = no;
+  NewScroll       = scroll;
+  NewSearchString = str;
+  NewHighlights   = Found;
 
-  for (i = 0; i < Settings.DspInfo.NumModes; i++)
-    if (strcmp(Settings.DspInfo.Mode, Settings.DspInfo.ModeNames[i]) == 0)
-    {
-      Menu->FindItem(Settings.DspInfo.ModeDPI[i])->SetMarked(true);
+  release_sem(BufferLock);
+
+  CancelPrerender = true;
+  CancelRender    = true;
+
+  release_sem(RenderSem);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::HandleRequests()                                                                                 //
+//                                                                                                                //
+// Changes the page and searches as requested by the window thread. Called by the render thread before it draws   //
+// any tiles.                                                                                                     //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::HandleRequests()
+{
+  RectList   Found;
+  string     str, Search;
+  ScrollMode scroll   = ScrollNone;
+  uint       no       = 0;
+  bool       Change   = false;
+  bool       Find     = false;
+  bool       Forwards = true;
+
+  if (acquire_sem(BufferLock) < B_OK)
+    return;
+
+  if ((Change = ChangeRequested))
+  {
+    no     = NewPage;
+    scroll = NewScroll;
+    str    = NewSearchString;
+    Found  = NewHighlights;
+  }
+  if ((Find = SearchRequested))
+  {
+    Search   = SearchRequest;
+    Forwards = SearchForwards;
+  }
+
+  ChangeRequested = false;
+  SearchRequested = false;
+
+  release_sem(BufferLock);
+
+  if (!Change && !Find)
+    return;
+
+  if (acquire_sem(DocLock) < B_OK)
+    return;
+
+  // a search starts from the page requested before it
+
+  if (Document != NULL && Change)
+    ShowPage(no, scroll, str, Found);
+  if (Document != NULL && Find)
+    FindNext(Search, Forwards);
+
+  release_sem(DocLock);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::ShowPage(uint no, ScrollMode scroll, const string &str, const RectList &Found)                   //
+//                                                                                                                //
+// Displays a page and tells the window thread with `MsgPageShown'. This procedure should only be called by the   //
+// render thread with `DocLock' locked.                                                                           //
+//                                                                                                                //
+// uint           no                    page number                                                               //
+// ScrollMode     scroll                where to scroll if the page changes                                       //
+// const string   &str                  string whose hits are highlighted                                         //
+// const RectList &Found                hits on the page in unshrunk pixels                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::ShowPage(uint no, ScrollMode scroll, const string &str, const RectList &Found)
+{
+  BMessage msg(MsgPageShown);
+  bool     Changed;
+
+  if (no > Document->NumberOfPages())
+    no = Document->NumberOfPages();
+  if (no < 1)
+    no = 1;
+
+  SearchString = str;
+
+  if (acquire_sem(BufferLock) < B_OK)
+    return;
+
+  if ((Changed = (no != PageNo)))
+    PageNo = no;
+
+  Highlights = Found;
+
+  release_sem(BufferLock);
+
+  if (Changed)
+    FlushTiles();
+  else
+    scroll = ScrollNone;
+
+  msg.AddInt32("Scroll", scroll);
+
+  if (Window())
+    Window()->PostMessage(&msg, this);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::SetShrink(int32 Shrink)                                                                          //
+//                                                                                                                //
+// Changes the magnification. The document isn't reloaded since the fonts and page layouts don't depend on the    //
+// shrink factor. The point in the centre of the view stays there.                                                //
+//                                                                                                                //
+// int32 Shrink                         factor to shrink document (see `DrawSettings::Shrink')                    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::SetShrink(int32 Shrink)
+{
+  BRect  b = Bounds();
+  BPoint Centre;
+  float  sf;
+
+  if (Shrink < DrawSettings::ShrinkOne || Shrink > Glyph::MaxShrinkFactor * DrawSettings::ShrinkOne ||
+      Shrink == Settings.Shrink)
+    return;
+
+  CancelPrerender = true;
+  CancelRender    = true;
+
+  if (acquire_sem(DocLock) < B_OK)
+    return;
+
+  // centre of the view in unshrunk pixels
+
+  Centre.x = (b.left + b.right)  / 2 * Settings.ShrinkFactor();
+  Centre.y = (b.top  + b.bottom) / 2 * Settings.ShrinkFactor();
+
+  Settings.Shrink = Shrink;
+  sf              = Settings.ShrinkFactor();
+
+  if (Document)
+  {
+    Document->ShrinkFactorChanged(&Settings);
+
+    DocumentChanged();
+  }
+
+  release_sem(DocLock);
+
+  UpdateWindow();
+
+  if (Document && LockLooper())
+  {
+    b = Bounds();
+
+    ScrollTo(max_c(0.0, min_c(Centre.x / sf - b.Width()  / 2, DocWidth  - b.Width()  - 1)),
+             max_c(0.0, min_c(Centre.y / sf - b.Height() / 2, DocHeight - b.Height() - 1)));
+    UnlockLooper();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::FitWidth()                                                                                       //
+//                                                                                                                //
+// Chooses the shrink factor at which the page fills the width of the view.                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::FitWidth()
+{
+  int32 Width;
+  int32 Shrink;
+
+  if (!Document)
+    return;
+
+  // the shrunken page is two pixels wider than the unshrunken one divided by the shrink factor
+
+  Width = (int32)Bounds().Width() + 1 - 2;
+
+  if (Width < 1)
+    return;
+
+  Shrink = (((int32)Document->UnshrunkPageWidth << 16) + Width - 1) / Width;
+
+  SetShrink(max_c(Shrink, DrawSettings::ShrinkOne));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::ToggleBorderLine()                                                                               //
+//                                                                                                                //
+// Draws or clears the lines indicating the border of the page.                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::ToggleBorderLine()
+{
+  if (acquire_sem(DocLock) < B_OK)
+    return;
+
+  Settings.BorderLine = !Settings.BorderLine;
+
+  ((BMenu *)Window()->FindView("Menu"))->FindItem(MsgBorderLine)->SetMarked(Settings.BorderLine);
+
+  FlushTiles();
+
+  release_sem(DocLock);
+
+  if (LockLooper())
+  {
+    Invalidate();
+    UnlockLooper();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::ToggleAntiAliasing()                                                                             //
+//                                                                                                                //
+// Draws or clears the lines indicating the border of the page.                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::ToggleAntiAliasing()
+{
+  if (acquire_sem(DocLock) < B_OK)
+    return;
+
+  Settings.AntiAliasing = !Settings.AntiAliasing;
+
+  ((BMenu *)Window()->FindView("Menu"))->FindItem(MsgAntiAliasing)->SetMarked(Settings.AntiAliasing);
+
+  if (Document)
+    Document->Fonts.FlushShrinkedGlyphes();
+
+  FlushTiles();
+
+  release_sem(DocLock);
+
+  if (LockLooper())
+  {
+    Invalidate();
+    UnlockLooper();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::UpdateWindow()                                                                                   //
+//                                                                                                                //
+// Updates the window completely.                                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::UpdateWindow()
+{
+  if (LockLooper())
+  {
+    UpdateMenus();
+
+    UnlockLooper();
+  }
+  inherited::UpdateWindow();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::UpdateMenus()                                                                                    //
+//                                                                                                                //
+// Updates the marked menu items.                                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::UpdateMenus()
+{
+  BMenu     *Menu;
+  BMenuItem *Item;
+  int       i;
+
+  Menu = ((BMenu *)Window()->FindView("Menu"));
+
+  for (i = 0; i < Settings.DspInfo.NumModes; i++)
+    if (strcmp(Settings.DspInfo.Mode, Settings.DspInfo.ModeNames[i]) == 0)
+    {
+      Menu->FindItem(Settings.DspInfo.ModeDPI[i])->SetMarked(true);
       break;
     }
 
-  Menu->FindItem(Settings.ShrinkFactor)->SetMarked(true);
-  Menu->FindItem(MsgAntiAliasing)->SetMarked(Settings.AntiAliasing);
-  Menu->FindItem(MsgBorderLine)->SetMarked(Settings.BorderLine);
-  Menu->FindItem(MsgMeasureWin)->SetMarked(((ViewApplication *)be_app)->MeasureWinOpen);
+  // there is no item for a shrink factor which isn't an integer
+
+  if (Settings.Shrink % DrawSettings::ShrinkOne == 0 &&
+      (Item = Menu->FindItem(Settings.Shrink / DrawSettings::ShrinkOne)) != NULL)
+    Item->SetMarked(true);
+  else if ((Item = Menu->FindItem(1)) != NULL && (Item = Item->Menu()->FindMarked()) != NULL)
+    Item->SetMarked(false);
+
+  Menu->FindItem(MsgAntiAliasing)->SetMarked(Settings.AntiAliasing);
+  Menu->FindItem(MsgBorderLine)->SetMarked(Settings.BorderLine);
+  Menu->FindItem(MsgMeasureWin)->SetMarked(((ViewApplication *)be_app)->MeasureWinOpen);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::UpdatePageCounter()                                                                              //
+//                                                                                                                //
+// Updates the text control showing the current page number. The number printed on the page is shown once it has  //
+// been read in the background, until then the position of the page as `#n'. The window should be locked.         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::UpdatePageCounter()
+{
+  string Label;
+  char   str[16];
+
+  if (Document)
+    Label = Document->PageLabel(PageNo);
+
+  if (Label.empty())
+  {
+    sprintf(str, "#%u", PageNo);
+    Label = str;
+  }
+  ((BTextControl *)Window()->FindView("PageNumber"))->SetText(Label.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::FlushTiles()                                                                                     //
+//                                                                                                                //
+// Discards the rendered parts of the page. They are redrawn when they become visible. The neighbouring pages are //
+// prerendered for the new settings. This procedure should be called with `DocLock' locked.                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::FlushTiles()
+{
+  if (acquire_sem(BufferLock) == B_OK)
+  {
+    Tiles->Invalidate();
+
+    release_sem(BufferLock);
+  }
+
+  release_sem(PrerenderSem);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::DrawTiles(BRect r)                                                                               //
+//                                                                                                                //
+// Draws the page from the tile cache. Missing tiles are left blank and the rendering thread is asked to draw     //
+// them; it invalidates each tile when it is ready. Previews are shown until they have been refined. This         //
+// procedure should be called with `BufferLock' locked.                                                           //
+//                                                                                                                //
+// BRect r                              part of the view to draw                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::DrawTiles(BRect r)
+{
+  BRect   Visible = Bounds();
+  BRect   t, src;
+  BBitmap *bm;
+  int32   Column, Row;
+  bool    Missing = false;
+
+  // keep twice the visible area so that scrolling back doesn't render the tiles again
+
+  Tiles->Reserve(2 * ((int32)(Visible.Width()  / TileCache::TileSize) + 2) *
+                     ((int32)(Visible.Height() / TileCache::TileSize) + 2));
+
+  r = r & BRect(0, 0, DocWidth - 1, DocHeight - 1);
+
+  if (!r.IsValid())
+    return;
+
+  for (Row = (int32)r.top / TileCache::TileSize; Row <= (int32)r.bottom / TileCache::TileSize; Row++)
+    for (Column = (int32)r.left / TileCache::TileSize; Column <= (int32)r.right / TileCache::TileSize; Column++)
+    {
+      t   = TileCache::Bounds(Column, Row);
+      src = t & r;
+
+      if ((bm = Tiles->Lookup(Column, Row)) != NULL)
+        DrawBitmapAsync(bm, src.OffsetByCopy(-t.left, -t.top), src);
+      else
+      {
+        FillRect(src, B_SOLID_LOW);
+        Missing = true;
+      }
+    }
+
+  // don't draw a page the user is about to leave; the view is redrawn after the page change
+
+  if (Missing && !PageRequested)
+  {
+    RenderArea = Visible & BRect(0, 0, DocWidth - 1, DocHeight - 1);
+
+    release_sem(RenderSem);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::DrawHighlights(BRect r)                                                                          //
+//                                                                                                                //
+// Marks the hits of the last search on top of the page. The tiles don't contain any highlighting, so showing or  //
+// clearing hits doesn't render anything.                                                                         //
+//                                                                                                                //
+// BRect r                              part of the view to draw                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::DrawHighlights(BRect r)
+{
+  BRect h;
+  float sf = Settings.ShrinkFactor();
+  uint  i;
+
+  SetDrawingMode(B_OP_MIN);                      // the text stays black
+  SetHighColor(200, 200, 0, 255);
+
+  for (i = 0; i < Highlights.size(); i++)
+  {
+    h.Set((int32)(Highlights[i].left  / sf), (int32)(Highlights[i].top    / sf),
+          (int32)(Highlights[i].right / sf), (int32)(Highlights[i].bottom / sf));
+
+    if (h.Intersects(r))
+      FillRect(h & r, B_SOLID_HIGH);
+  }
+
+  SetHighColor(0, 0, 0, 255);
+  SetDrawingMode(B_OP_COPY);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVIView::NextMissingTile(int32 &Column, int32 &Row, bool &Preview)                                        //
+//                                                                                                                //
+// Looks for a tile inside `RenderArea' which still has to be drawn. Tiles which haven't been drawn at all come   //
+// first, so that the whole area shows a preview before any tile is refined. If there is none, `RenderArea' is    //
+// cleared. This procedure should be called with `BufferLock' locked.                                             //
+//                                                                                                                //
+// int32 &Column, &Row                  returns the position of the tile                                          //
+// bool  &Preview                       returns whether a preview should be drawn                                 //
+//                                                                                                                //
+// Result:                              `true' if a tile is missing, otherwise `false'                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVIView::NextMissingTile(int32 &Column, int32 &Row, bool &Preview)
+{
+  BRect r;
+
+  if (!RenderArea.IsValid())
+    return false;
+
+  r = RenderArea & BRect(0, 0, DocWidth - 1, DocHeight - 1);
+
+  if (r.IsValid())
+  {
+    for (Row = (int32)r.top / TileCache::TileSize; Row <= (int32)r.bottom / TileCache::TileSize; Row++)
+      for (Column = (int32)r.left / TileCache::TileSize; Column <= (int32)r.right / TileCache::TileSize; Column++)
+        if (!Tiles->IsValid(Column, Row))
+        {
+          Preview = true;
+          return true;
+        }
+
+    for (Row = (int32)r.top / TileCache::TileSize; Row <= (int32)r.bottom / TileCache::TileSize; Row++)
+      for (Column = (int32)r.left / TileCache::TileSize; Column <= (int32)r.right / TileCache::TileSize; Column++)
+        if (!Tiles->IsFinal(Column, Row))
+        {
+          Preview = false;
+          return true;
+        }
+  }
+
+  RenderArea = BRect();
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVIView::RenderNext(BBitmap *&Back)                                                                       //
+//                                                                                                                //
+// Draws the magnify window or the next missing tile and exchanges it with the displayed one. The window thread   //
+// is only told which part of the view has changed, so it never waits for the document. Tiles are drawn as a      //
+// preview first if they would need glyphs to be unpacked or figures to be rendered.                              //
+//                                                                                                                //
+// BBitmap *&Back                       bitmap the next tile is drawn into; it is exchanged with the replaced one //
+//                                                                                                                //
+// Result:                              `true' if something was drawn, `false' if there is nothing left to do or  //
+//                                      the drawing has been cancelled                                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVIView::RenderNext(BBitmap *&Back)
+{
+  BBitmap *bm;
+  BPoint  at;
+  BRect   t, Update;
+  int32   Column, Row;
+  uint32  gen;
+  bool    Magnify = false;
+  bool    Found   = false;
+  bool    Preview = false;
+  bool    Ok      = false;
+
+  if (acquire_sem(BufferLock) < B_OK)
+    return false;
+
+  // the magnify window follows the mouse, so it's drawn first
+
+  if (MagnifyRequested && ShowMagnify)
+  {
+    MagnifyRequested = false;
+
+    at      = MagnifyTarget;
+    Magnify = true;
+    Found   = true;
+  }
+  else if (!PageRequested && !ChangeRequested && !SearchRequested)
+    Found = NextMissingTile(Column, Row, Preview);
+
+  gen = Tiles->CurrentGeneration();
+
+  release_sem(BufferLock);
+
+  if (!Found)
+    return false;
+
+  // draw the part into a bitmap which isn't displayed
+
+  if (acquire_sem(DocLock) < B_OK)
+    return false;
+
+  if (Magnify)
+    Ok = RedrawMagnifyBuffer(at);
+  else
+  {
+    t = TileCache::Bounds(Column, Row);
+
+    if (!Back)
+    {
+      try
+      {
+        Back = new BBitmap(BRect(0, 0, TileCache::TileSize - 1, TileCache::TileSize - 1), B_COLOR_8_BIT);
+      }
+      catch(...)
+      {
+        log_warn("not enough memory!");
+      }
+    }
+    Ok = Back != NULL && RenderPart(Back, t, &CancelRender, &Preview);
+  }
+
+  release_sem(DocLock);
+
+  if (!Ok)
+    return false;
+
+  // publish it
+
+  if (acquire_sem(BufferLock) < B_OK)
+    return false;
+
+  if (Magnify)
+  {
+    Update = BRect(MagnifyPos.x - MagnifyWinSize, MagnifyPos.y - MagnifyWinSize,
+                   MagnifyPos.x + MagnifyWinSize, MagnifyPos.y + MagnifyWinSize) |
+             BRect(at.x - MagnifyWinSize, at.y - MagnifyWinSize,
+                   at.x + MagnifyWinSize, at.y + MagnifyWinSize);
+
+    bm            = MagnifyBuffer;
+    MagnifyBuffer = MagnifyBack;
+    MagnifyBack   = bm;
+    MagnifyPos    = at;
+    MagnifyValid  = ShowMagnify;
+  }
+  else
+  {
+    Update = t;
+    Ok     = Tiles->Store(Column, Row, Back, gen, Preview);      // fails if the page has changed in the meantime
+  }
+
+  release_sem(BufferLock);
+
+  if (Ok && Window())
+  {
+    BMessage msg(MsgRendered);
+
+    msg.AddRect("Rect", Update);
+
+    Window()->PostMessage(&msg, this);
+  }
+
+  return Ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::RequestMagnify()                                                                                 //
+//                                                                                                                //
+// Asks the rendering thread to redraw the magnify window at the mouse position. Several requests in a row are    //
+// combined.                                                                                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::RequestMagnify()
+{
+  if (acquire_sem(BufferLock) < B_OK)
+    return;
+
+  MagnifyTarget    = MousePos;
+  MagnifyRequested = true;
+
+  release_sem(BufferLock);
+
+  release_sem(RenderSem);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVIView::RenderPart(BBitmap *bm, BRect r, const bool *Cancel = NULL, bool *Preview = NULL)                //
+//                                                                                                                //
+// Draws a part of the page into a bitmap. Pages without \special commands are drawn into a page buffer and their //
+// grey values are converted to the colour space of the bitmap once. Otherwise the part is drawn with the         //
+// app_server; tiles are drawn into `TileBuffer' and copied so that the cached bitmaps don't need to accept views.//
+// This procedure should be called with `DocLock' locked.                                                         //
+//                                                                                                                //
+// BBitmap    *bm                       bitmap of the size of `r'                                                 //
+// BRect      r                         part of the page                                                          //
+// const bool *Cancel                   the drawing is stopped when this flag is set                              //
+// bool       *Preview                  if set, a preview is drawn; returns whether placeholders were drawn       //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVIView::RenderPart(BBitmap *bm, BRect r, const bool *Cancel, bool *Preview)
+{
+  DrawSettings set = Settings;
+  BBitmap      *dest;
+  PageLayout   *l;
+
+  if (!Document)
+    return false;
+
+  set.Cancel  = Cancel;
+  set.Preview = Preview != NULL && *Preview;
+
+  // figures need the app_server; search results are drawn over the tiles by `Draw()'
+
+  if ((l = Document->Layout(&set, PageNo)) != NULL && !l->HasSpecials)
+  {
+    PageBuffer   pb(bm->Bounds().IntegerWidth() + 1, bm->Bounds().IntegerHeight() + 1);
+    MemoryTarget rt(&pb, (int32)r.left, (int32)r.top);
+
+    if (pb.Ok())
+    {
+      Document->Draw(&rt, &set, PageNo, &r);
+
+      if (set.Cancelled())
+        return false;
+
+      if (Preview)
+        *Preview = set.Incomplete;
+
+      pb.CopyTo(bm);
+
+      return true;
+    }
+  }
+
+  if (bm->Bounds().Width()  == TileCache::TileSize - 1 &&
+      bm->Bounds().Height() == TileCache::TileSize - 1)
+  {
+    if (!TileBuffer)
+    {
+      try
+      {
+        TileBuffer = new BBitmap(bm->Bounds(), B_COLOR_8_BIT, true);
+      }
+      catch(...)
+      {
+        log_warn("not enough memory!");
+        return false;
+      }
+    }
+    dest = TileBuffer;
+  }
+  else
+    dest = bm;
+
+  BufferView->ResizeTo(DocWidth, DocHeight);
+  dest->AddChild(BufferView);
+
+  if (BufferView->LockLooper())
+  {
+    BufferView->MoveTo(-r.left, -r.top);
+
+    Document->Draw(BufferView, &set, PageNo, &r);
+
+    BufferView->MoveTo(0, 0);
+    BufferView->UnlockLooper();
+  }
+  dest->RemoveChild(BufferView);
+
+  if (set.Cancelled())
+    return false;
+
+  if (Preview)
+    *Preview = set.Incomplete;
+
+  if (dest != bm)
+    memcpy(bm->Bits(), dest->Bits(), bm->BitsLength());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVIView::RedrawMagnifyBuffer(BPoint at)                                                                   //
+//                                                                                                                //
+// Draws the magnified part of the page into `MagnifyBack'. This procedure should be called with `DocLock'        //
+// locked.                                                                                                        //
+//                                                                                                                //
+// BPoint at                            centre of the magnify window                                              //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVIView::RedrawMagnifyBuffer(BPoint at)
+{
+  DrawSettings set   = Settings;
+  rgb_color    Black = {0, 0, 0, 255};
+  float        ShrinkFactor;
+  BRect        Clip;
+
+  if (!Document)
+    return false;
+
+  if (!MagnifyBack)                               // if bitmap isn't allocated yet
+    if (!(MagnifyBack = new BBitmap(BRect(0, 0, 2 * MagnifyWinSize, 2 * MagnifyWinSize), B_COLOR_8_BIT, true)))
+      return false;
+
+  ShrinkFactor = Settings.ShrinkFactor();
+  set.Shrink   = DrawSettings::ShrinkOne;
+
+  BufferView->ResizeTo(Document->UnshrunkPageWidth, Document->UnshrunkPageHeight);
+  MagnifyBack->AddChild(BufferView);
+
+  if (BufferView->LockLooper())
+  {
+    BufferView->MoveTo(-at.x * ShrinkFactor + MagnifyWinSize,
+                       -at.y * ShrinkFactor + MagnifyWinSize);
+
+    // only the part of the page inside the magnify window is drawn
+
+    Clip.Set(at.x * ShrinkFactor - MagnifyWinSize, at.y * ShrinkFactor - MagnifyWinSize,
+             at.x * ShrinkFactor + MagnifyWinSize, at.y * ShrinkFactor + MagnifyWinSize);
+
+    Document->Draw(BufferView, &set, PageNo, &Clip);
+
+    BufferView->MoveTo(0, 0);
+
+    BufferView->BeginLineArray(4);
+    BufferView->AddLine(BPoint(0, 0),                   BPoint(2 * MagnifyWinSize, 0),                   Black);
+    BufferView->AddLine(BPoint(2 * MagnifyWinSize, 0),  BPoint(2 * MagnifyWinSize, 2 * MagnifyWinSize),  Black);
+    BufferView->AddLine(BPoint(2 * MagnifyWinSize, 2 * MagnifyWinSize),  BPoint(0, 2 * MagnifyWinSize),  Black);
+    BufferView->AddLine(BPoint(0, 2 * MagnifyWinSize),  BPoint(0, 0),                                    Black);
+    BufferView->EndLineArray();
+
+    BufferView->UnlockLooper();
+  }
+  MagnifyBack->RemoveChild(BufferView);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::SetDspInfo(DisplayInfo *dsp)                                                                     //
+//                                                                                                                //
+// Sets display data.                                                                                             //
+//                                                                                                                //
+// DisplayInfo *dsp                     display information                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::SetDspInfo(DisplayInfo *dsp)
+{
+  Settings.DspInfo = *dsp;
+
+  Reload();
+  UpdateWindow();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVIView::DocumentChanged()                                                                                //
+//                                                                                                                //
+// Updates the view when the document has changed. This procedure should be called with `DocLock' locked.         //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVIView::DocumentChanged()
+{
+  if (!Document)
+    return true;
+
+  SetSize(Document->PageWidth, Document->PageHeight);
+
+  if (acquire_sem(BufferLock) == B_OK)
+  {
+    Pages->Flush();
+
+    release_sem(BufferLock);
+  }
+
+  FlushTiles();
+
+  // resize magnify buffer if necessary
+
+  MagnifyWinSize = BaseMagnifyWinSize * Settings.DspInfo.PixelsPerInch / 100;
+
+  if (acquire_sem(BufferLock) == B_OK)
+  {
+    delete MagnifyBuffer;
+    delete MagnifyBack;
+
+    MagnifyBuffer = NULL;
+    MagnifyBack   = NULL;
+    MagnifyValid  = false;
+
+    release_sem(BufferLock);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVIView::ReloadThread(void *arg)                                                                         //
+//                                                                                                                //
+// Reloads the current document.                                                                                  //
+//                                                                                                                //
+// void *arg                            pointer to the view                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVIView::ReloadThread(void *arg)
+{
+  DVIView *vw = (DVIView *)arg;
+  DVI     *doc;
+  uint    PageNo;
+
+  try
+  {
+    if (!(doc = vw->UnsetDocument()))      // another thread is reloading it
+      return 0;
+
+    if (acquire_sem(vw->DocLock) < B_OK)
+      return 0;
+ 
+    ((ViewApplication *)be_app)->SetSleepCursor();
+
+    PageNo = vw->PageNo;
+
+    if (doc->Reload(&vw->Settings))
+      vw->DocumentChanged();
+
+    release_sem(vw->DocLock);
+
+    vw->SetDocument(doc, PageNo);
+
+    ((ViewApplication *)be_app)->SetNormalCursor();
+  }
+  catch(const exception &e)
+  {
+    log_error("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_error("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVIView::RenderThread(void *arg)                                                                         //
+//                                                                                                                //
+// Changes the page and draws the missing tiles of the visible area and the magnify window, so that the window    //
+// thread only has to copy finished bitmaps to the screen.                                                        //
+//                                                                                                                //
+// void *arg                            pointer to the view                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVIView::RenderThread(void *arg)
+{
+  DVIView *vw   = (DVIView *)arg;
+  BBitmap *Back = NULL;
+  int32   count;
+
+  try
+  {
+    while (acquire_sem(vw->RenderSem) == B_OK && !vw->Quitting)
+    {
+      // several requests are handled at once
+
+      if (get_sem_count(vw->RenderSem, &count) == B_OK && count > 0)
+        acquire_sem_etc(vw->RenderSem, count, 0, 0);
+
+      vw->CancelRender = false;
+
+      vw->HandleRequests();
+
+      while (!vw->Quitting && !vw->CancelRender && vw->RenderNext(Back))
+        ;
+    }
+  }
+  catch(const exception &e)
+  {
+    log_error("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_error("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+
+  delete Back;
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVIView::PrerenderThread(void *arg)                                                                      //
+//                                                                                                                //
+// Renders the pages next to the displayed one into the page cache whenever the displayed page changes. The page  //
+// after the next one is only rendered if the page hasn't changed in the meantime.                                //
+//                                                                                                                //
+// void *arg                            pointer to the view                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVIView::PrerenderThread(void *arg)
+{
+  static const int Offsets[] = {1, -1, 2};
+
+  DVIView *vw      = (DVIView *)arg;
+  BView   *View    = NULL;
+  BBitmap *Scratch = NULL;
+  int32   count;
+  uint    i;
+
+  try
+  {
+    View = new BView(BRect(0, 0, 1, 1), NULL, 0, 0);
+
+    while (acquire_sem(vw->PrerenderSem) == B_OK && !vw->Quitting)
+    {
+      // several page changes are handled at once
+
+      if (get_sem_count(vw->PrerenderSem, &count) == B_OK && count > 0)
+        acquire_sem_etc(vw->PrerenderSem, count, 0, 0);
+
+      vw->CancelPrerender = false;
+
+      for (i = 0; i < sizeof(Offsets) / sizeof(Offsets[0]) && !vw->Quitting; i++)
+      {
+        if (vw->CancelPrerender || (get_sem_count(vw->PrerenderSem, &count) == B_OK && count > 0))
+          break;
+
+        if (acquire_sem(vw->DocLock) < B_OK)
+          break;
+
+        vw->PrerenderPage(View, Scratch, (int)vw->PageNo + Offsets[i]);
+
+        release_sem(vw->DocLock);
+      }
+    }
+  }
+  catch(const exception &e)
+  {
+    log_error("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_error("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+
+  delete Scratch;
+  delete View;
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVIView::IndexThread(void *arg)                                                                          //
+//                                                                                                                //
+// Builds the text index of the document page by page, so `DocLock' is only held for one page at a time. An index //
+// saved next to the DVI file is used instead if it belongs to the same version of the file.                      //
+//                                                                                                                //
+// void *arg                            pointer to the view                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVIView::IndexThread(void *arg)
+{
+  DVIView      *vw        = (DVIView *)arg;
+  TextIndex    *idx       = NULL;
+  PageLayout   *l         = NULL;
+  bool         Locked     = false;
+  bool         Persistent = false;
+  bool         Saved      = false;
+  DrawSettings set;
+  string       FileName;
+  off_t        size       = 0;
+  time_t       mtime      = 0;
+  uint         i, num;
+
+  try
+  {
+    if (acquire_sem(vw->DocLock) < B_OK)
+      return 0;
+
+    Locked = true;
+
+    set = vw->Settings;
+    num = vw->Document->NumPages;
+
+    if (!vw->Document->Path.empty())
+    {
+      BEntry e(vw->Document->Path.c_str());
+
+      FileName   = vw->Document->Path + ".index";
+      Persistent = (e.GetSize(&size)             == B_OK &&
+                    e.GetModificationTime(&mtime) == B_OK);
+      Saved      = Persistent && BEntry(FileName.c_str()).Exists();
+    }
+
+    release_sem(vw->DocLock);
+
+    Locked = false;
+
+    // A saved index can only be checked against the exact number of pages, so we wait until the pages have been
+    // counted. Otherwise the pages are read while they are counted, and the count is only waited for at the end.
+
+    if (Saved)
+      num = vw->Document->CountPages();
+
+    idx = new TextIndex(num, set.DspInfo.PixelsPerInch, size, mtime);
+
+    if (!Saved || !idx->Load(FileName.c_str()))
+    {
+      for (i = 1; !vw->CancelIndex; i++)
+      {
+        if (i > vw->Document->NumberOfPages() && i > vw->Document->CountPages())
+          break;
+
+        if (acquire_sem(vw->DocLock) < B_OK)
+          break;
+
+        Locked = true;
+        l      = vw->Document->ReadLayout(&set, i);
+
+        release_sem(vw->DocLock);
+
+        Locked = false;
+
+        idx->AddPage(l);
+
+        delete l;
+        l = NULL;
+      }
+
+      if (!vw->CancelIndex)
+        idx->SetNumPages(vw->Document->CountPages());
+
+      if (idx->Complete() && Persistent && ((ViewApplication *)be_app)->SaveTextIndex)
+        if (!idx->Save(FileName.c_str()))
+          log_warn("can't write %s!", FileName.c_str());
+    }
+
+    if (idx->Complete() && acquire_sem(vw->DocLock) == B_OK)
+    {
+      if (!vw->CancelIndex)
+      {
+        delete vw->Index;
+
+        vw->Index = idx;
+        idx       = NULL;
+      }
+      release_sem(vw->DocLock);
+    }
+  }
+  catch(const exception &e)
+  {
+    log_error("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (Locked)
+      release_sem(vw->DocLock);
+  }
+  catch(...)
+  {
+    log_error("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (Locked)
+      release_sem(vw->DocLock);
+  }
+  delete l;
+  delete idx;
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void FindOnPage(DVI *doc, const TextIndex *idx, const DrawSettings *set, const char *str, uint no,      //
+//                        TextIndex::HitList &Found)                                                              //
+//                                                                                                                //
+// Looks for all occurrences of a string on a page. If the text index isn't complete yet, the page is indexed on  //
+// its own. This procedure should be called with `DocLock' locked.                                                //
+//                                                                                                                //
+// DVI                *doc              document                                                                  //
+// const TextIndex    *idx              complete text index of the document or `NULL'                             //
+// const DrawSettings *set              settings used to read the page                                            //
+// const char         *str              string to look for                                                        //
+// uint               no                page number                                                               //
+// TextIndex::HitList &Found            list the occurrences are appended to                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void FindOnPage(DVI *doc, const TextIndex *idx, const DrawSettings *set, const char *str, uint no,
+                       TextIndex::HitList &Found)
+{
+  PageLayout *l;
+
+  if (idx != NULL)
+  {
+    idx->FindAll(str, no, Found);
+    return;
+  }
+
+  if ((l = doc->ReadLayout(set, no)) == NULL)
+    return;
+
+  try
+  {
+    TextIndex Page(1, set->DspInfo.PixelsPerInch, 0, 0);
+
+    Page.AddPage(l);
+    Page.FindAll(str, 1, Found);
+  }
+  catch(...)
+  {
+    delete l;
+    throw;
+  }
+  delete l;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool PostResult(BMessenger &Target, BMessage *msg, const bool *Cancel)                                  //
+//                                                                                                                //
+// Sends a message without blocking forever, since the receiver may be waiting for the sending thread.            //
+//                                                                                                                //
+// BMessenger &Target                   receiver                                                                  //
+// BMessage   *msg                      message                                                                   //
+// const bool *Cancel                   gives up as soon as `*Cancel' becomes `true'                              //
+//                                                                                                                //
+// Result:                              `true' if the message was delivered                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool PostResult(BMessenger &Target, BMessage *msg, const bool *Cancel)
+{
+  status_t err;
+
+  while ((err = Target.SendMessage(msg, (BHandler *)NULL, 100000)) == B_TIMED_OUT &&
+         !*(volatile const bool *)Cancel)
+    ;
+
+  return err == B_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVIView::SearchThread(void *arg)                                                                         //
+//                                                                                                                //
+// Searches all pages for `FindAllString' and sends a `MsgSearchHit' message to the view for each page containing //
+// the string. The text index is used if it is complete, otherwise each page is indexed on its own.               //
+//                                                                                                                //
+// void *arg                            pointer to the view                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVIView::SearchThread(void *arg)
+{
+  DVIView            *vw    = (DVIView *)arg;
+  BMessenger         Self(vw);
+  TextIndex::HitList Found;
+  DrawSettings       set;
+  string             str    = vw->FindAllString;
+  int32              id     = vw->SearchId;
+  bool               Locked = false;
+  uint               i, k;
+
+  try
+  {
+    if (acquire_sem(vw->DocLock) < B_OK)
+      return 0;
+
+    Locked = true;
+
+    set = vw->Settings;
+
+    release_sem(vw->DocLock);
+
+    Locked = false;
+
+    // the number of pages may grow while they are read, until the postamble is reached
+
+    for (i = 1; i <= vw->Document->NumberOfPages() && !vw->CancelSearch; i++)
+    {
+      Found.clear();
+
+      if (acquire_sem(vw->DocLock) < B_OK)
+        break;
+
+      Locked = true;
+
+      FindOnPage(vw->Document, vw->Index, &set, str.c_str(), i, Found);
+
+      release_sem(vw->DocLock);
+
+      Locked = false;
+
+      if (!Found.empty())
+      {
+        BMessage msg(MsgSearchHit);
+
+        msg.AddInt32("Search", id);
+        msg.AddInt32("Page",   i);
+
+        for (k = 0; k < Found.size(); k++)
+        {
+          msg.AddRect(  "Rect",    Found[k].Rect);
+          msg.AddString("Context", Found[k].Context.c_str());
+        }
+
+        if (!PostResult(Self, &msg, &vw->CancelSearch))
+          break;
+      }
+    }
+
+    if (!vw->CancelSearch)
+    {
+      BMessage msg(MsgSearchDone);
+
+      msg.AddInt32("Search", id);
+
+      PostResult(Self, &msg, &vw->CancelSearch);
+    }
+  }
+  catch(const exception &e)
+  {
+    log_error("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (Locked)
+      release_sem(vw->DocLock);
+  }
+  catch(...)
+  {
+    log_error("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (Locked)
+      release_sem(vw->DocLock);
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::PrerenderPage(BView *View, BBitmap *&Scratch, int no)                                            //
+//                                                                                                                //
+// Renders a page into the page cache unless it is already there. This procedure should be called with `DocLock'  //
+// locked.                                                                                                        //
+//                                                                                                                //
+// BView   *View                        view used to draw the page                                                //
+// BBitmap *&Scratch                    bitmap accepting views; it is reallocated if the page size has changed    //
+// int     no                           page number                                                               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::PrerenderPage(BView *View, BBitmap *&Scratch, int no)
+{
+  DrawSettings set = Settings;
+  PageKey      k   = CacheKey(no);
+  BRect        r(0, 0, DocWidth - 1, DocHeight - 1);
+  BBitmap      *bm = NULL;
+  bool         Cached;
+
+  if (!Document || no < 1 || no > Document->NumPages)
+    return;
+
+  // at least two pages have to fit into the cache
+
+  if ((size_t)DocWidth * DocHeight > PageCacheSize / 2)
+    return;
+
+  if (acquire_sem(BufferLock) < B_OK)
+    return;
+
+  Cached = (Pages->Find(k) != NULL);
+
+  release_sem(BufferLock);
+
+  if (Cached)
+    return;
+
+  try
+  {
+    if (Scratch == NULL || Scratch->Bounds() != r)
+    {
+      delete Scratch;
+      Scratch = NULL;
+      Scratch = new BBitmap(r, B_COLOR_8_BIT, true);
+    }
+
+    bm = new BBitmap(r, B_COLOR_8_BIT);
+  }
+  catch(...)
+  {
+    log_warn("not enough memory!");
+    return;
+  }
+
+  View->ResizeTo(DocWidth, DocHeight);
+  Scratch->AddChild(View);
+
+  set.Cancel = &CancelPrerender;
+
+  if (View->LockLooper())
+  {
+    Document->Draw(View, &set, no);
+    View->UnlockLooper();
+  }
+  Scratch->RemoveChild(View);
+
+  memcpy(bm->Bits(), Scratch->Bits(), bm->BitsLength());
+
+  if (set.Cancelled() || acquire_sem(BufferLock) < B_OK)
+  {
+    delete bm;
+    return;
+  }
+
+  Pages->Insert(k, bm);
+
+  release_sem(BufferLock);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::UpdatePageCounter()                                                                              //
+// PageKey DVIView::CacheKey(uint no)                                                                             //
 //                                                                                                                //
-// Updates the text control showing the current page number. The window should be locked.                         //
+// Returns the key of a page in the page cache for the current settings.                                          //
+//                                                                                                                //
+// uint no                              page number                                                               //
+//                                                                                                                //
+// Result:                              the key                                                                   //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::UpdatePageCounter()
+PageKey DVIView::CacheKey(uint no)
 {
-  char str[10];
+  PageKey k;
 
-  sprintf(str, "%u", PageNo);
-  ((BTextControl *)Window()->FindView("PageNumber"))->SetText(str);
+  k.PageNo       = no;
+  k.Shrink       = Settings.Shrink;
+  k.AntiAliasing = Settings.AntiAliasing;
+  k.BorderLine   = Settings.BorderLine;
+
+  return k;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::RedrawBuffer()                                                                                   //
+// void DVIView::StartIndexer()                                                                                   //
 //                                                                                                                //
-// Redraws the page in the internal buffer. This procedure should be called with `DocLock' locked.                //
+// Starts building the text index of the current document in the background.                                      //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::RedrawBuffer()
+void DVIView::StartIndexer()
 {
-  if (Document)
+  if (Document == NULL || Indexer >= B_OK)
+    return;
+
+  CancelIndex = false;
+
+  if ((Indexer = spawn_thread(IndexThread, "index text", B_LOW_PRIORITY, this)) >= B_OK)
+    resume_thread(Indexer);
+  else
+    log_warn("can't start indexing thread!");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::StopIndexer()                                                                                    //
+//                                                                                                                //
+// Stops the indexing thread and discards the index. Must not be called while `DocLock' is held.                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::StopIndexer()
+{
+  status_t res;
+
+  if (Indexer >= B_OK)
   {
-    ((ViewApplication *)be_app)->SetSleepCursor();
+    CancelIndex = true;
 
-    BufferView->ResizeTo(DocWidth, DocHeight);
-    BufferView->MoveTo(0, 0);
-    Buffer->AddChild(BufferView);
+    wait_for_thread(Indexer, &res);
 
-    if (BufferView->LockLooper())
-    {
-      if (acquire_sem(BufferLock) == B_OK)
-      {
-        Document->Draw(BufferView, &Settings, PageNo);
+    Indexer = B_ERROR;
+  }
 
-        release_sem(BufferLock);
-      }
+  if (acquire_sem(DocLock) == B_OK)
+  {
+    delete Index;
 
-      BufferView->UnlockLooper();
-    }
-    Buffer->RemoveChild(BufferView);
+    Index = NULL;
 
-    ((ViewApplication *)be_app)->SetNormalCursor();
+    release_sem(DocLock);
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::RedrawMagnifyBuffer()                                                                            //
+// void DVIView::FindAll(const char *str, BMessenger Target)                                                      //
 //                                                                                                                //
-// Redraws the magnified part of the page in the internal buffer. This procedure should be called with `DocLock'  //
-// locked.                                                                                                        //
+// Starts searching the whole document for a string in the background. The hits are collected in `Hits' as they   //
+// are found and a copy of each `MsgSearchHit' and `MsgSearchDone' message is sent to `Target'.                   //
+//                                                                                                                //
+// const char *str                      string to search for                                                      //
+// BMessenger Target                    receiver of the results, may be invalid                                   //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::RedrawMagnifyBuffer()
+void DVIView::FindAll(const char *str, BMessenger Target)
 {
-  DrawSettings set   = Settings;
-  rgb_color    Black = {0, 0, 0, 255};
-  int          ShrinkFactor;
-
-  if (!Document)
-    return;
+  StopSearch();
 
-  if (acquire_sem(BufferLock) < B_OK)
-    return;
+  Hits.clear();
 
-  if (!MagnifyBuffer)                             // if bitmap isn't allocated yet
-    if (!(MagnifyBuffer = new BBitmap(BRect(0, 0, 2 * MagnifyWinSize, 2 * MagnifyWinSize), B_COLOR_8_BIT, true)))
-      return;
+  FindAllString = str;
+  HitTarget     = Target;
+  SearchDone    = false;
+  CancelSearch  = false;
 
-  ShrinkFactor     = Settings.ShrinkFactor;
-  set.ShrinkFactor = 1;
+  SearchId++;
 
-  BufferView->ResizeTo(Document->UnshrunkPageWidth, Document->UnshrunkPageHeight);
-  MagnifyBuffer->AddChild(BufferView);
+  if (Document != NULL &&
+      (Searcher = spawn_thread(SearchThread, "find all", B_LOW_PRIORITY, this)) >= B_OK)
+    resume_thread(Searcher);
 
-  if (BufferView->LockLooper())
+  else
   {
-    BufferView->MoveTo(-MousePos.x * ShrinkFactor + MagnifyWinSize,
-                       -MousePos.y * ShrinkFactor + MagnifyWinSize);
+    BMessage msg(MsgSearchDone);
 
-    Document->Draw(BufferView, &set, PageNo);
-
-    BufferView->MoveTo(0, 0);
-
-    BufferView->BeginLineArray(4);
-    BufferView->AddLine(BPoint(0, 0),                   BPoint(2 * MagnifyWinSize, 0),                   Black);
-    BufferView->AddLine(BPoint(2 * MagnifyWinSize, 0),  BPoint(2 * MagnifyWinSize, 2 * MagnifyWinSize),  Black);
-    BufferView->AddLine(BPoint(2 * MagnifyWinSize, 2 * MagnifyWinSize),  BPoint(0, 2 * MagnifyWinSize),  Black);
-    BufferView->AddLine(BPoint(0, 2 * MagnifyWinSize),  BPoint(0, 0),                                    Black);
-    BufferView->EndLineArray();
+    msg.AddInt32("Search", SearchId);
 
-    BufferView->UnlockLooper();
+    SearchResult(&msg);
   }
-  MagnifyBuffer->RemoveChild(BufferView);
-
-  release_sem(BufferLock);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVIView::SetDspInfo(DisplayInfo *dsp)                                                                     //
-//                                                                                                                //
-// Sets display data.                                                                                             //
+// void DVIView::StopSearch()                                                                                     //
 //                                                                                                                //
-// DisplayInfo *dsp                     display information                                                       //
+// Stops the search started by `FindAll()'. The hits found so far are kept.                                       //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVIView::SetDspInfo(DisplayInfo *dsp)
+void DVIView::StopSearch()
 {
-  Settings.DspInfo = *dsp;
+  status_t res;
 
-  Reload();
-  UpdateWindow();
+  if (Searcher >= B_OK)
+  {
+    CancelSearch = true;
+
+    wait_for_thread(Searcher, &res);
+
+    Searcher = B_ERROR;
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// bool DVIView::DocumentChanged()                                                                                //
+// void DVIView::SearchResult(BMessage *msg)                                                                      //
 //                                                                                                                //
-// Updates the view when the document has changed. This procedure should be called with `DocLock' locked.         //
+// Adds the hits sent by the search thread to `Hits' and passes the message on to `HitTarget'.                    //
 //                                                                                                                //
-// Result:                              `true' if successful, otherwise `false'                                   //
+// BMessage *msg                        `MsgSearchHit' or `MsgSearchDone' message                                 //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool DVIView::DocumentChanged()
+void DVIView::SearchResult(BMessage *msg)
 {
-  BRect r;
-
-  if (!Document)
-    return true;
+  SearchHit  h;
+  const char *Context;
+  int32      id;
+  int32      page;
+  int32      i;
 
-  SetSize(Document->PageWidth, Document->PageHeight);
-
-  // resize buffer if necessary
-
-  if (Buffer)
-    r = Buffer->Bounds();
+  if (msg->FindInt32("Search", &id) != B_OK || id != SearchId)   // left over from an earlier search
+    return;
 
-  if (Buffer    == NULL                  ||
-      DocWidth  != r.right  - r.left + 1 ||
-      DocHeight != r.bottom - r.top  + 1)
+  if (msg->what == MsgSearchHit)
   {
-    BBitmap *NewBuffer = NULL;
-
-    try
+    if (msg->FindInt32("Page", &page) != B_OK)
     {
-      if (!(NewBuffer = new BBitmap(BRect(0, 0, DocWidth - 1, DocHeight - 1), B_COLOR_8_BIT, true)))
-        return false;
+      log_warn("invalid message received!");
+      return;
+    }
 
-      delete Buffer;
+    h.Page = page;
 
-      Buffer = NewBuffer;
-    }
-    catch(const exception &e)
-    {
-      log_warn("%s!", e.what());
-      log_debug("at %s:%d", __FILE__, __LINE__);
-      return false;
-    }
-    catch(...)
+    for (i = 0; msg->FindRect("Rect", i, &h.Rect) == B_OK; i++)
     {
-      log_warn("unknown exception!");
-      log_debug("at %s:%d", __FILE__, __LINE__);
-      return false;
+      if (msg->FindString("Context", i, &Context) == B_OK)
+        h.Context = Context;
+      else
+        h.Context.erase();
+
+      Hits.push_back(h);
     }
   }
+  else
+    SearchDone = true;
 
-  RedrawBuffer();
-
-  // resize magnify buffer if necessary
-
-  MagnifyWinSize = BaseMagnifyWinSize * Settings.DspInfo.PixelsPerInch / 100;
-
-  delete MagnifyBuffer;
-  MagnifyBuffer = NULL;
-
-  return true;
+  if (HitTarget.IsValid())
+    HitTarget.SendMessage(msg);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// int32 DVIView::ReloadThread(void *arg)                                                                         //
+// void DVIView::ShowHit(int32 index)                                                                             //
 //                                                                                                                //
-// Reloads the current document.                                                                                  //
+// Displays the page of a hit found by `FindAll()' and scrolls the hit into view.                                 //
 //                                                                                                                //
-// void *arg                            pointer to the view                                                       //
+// int32 index                          number of the hit in `Hits' starting with 0                               //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int32 DVIView::ReloadThread(void *arg)
+void DVIView::ShowHit(int32 index)
 {
-  DVIView *vw = (DVIView *)arg;
-  DVI     *doc;
-  uint    PageNo;
+  RectList Found;
+  BRect    r, b;
+  float    sf;
+  uint     i;
 
-  try
-  {
-    doc = vw->UnsetDocument();
+  if (Document == NULL || index < 0 || index >= (int32)Hits.size())
+    return;
 
-    if (acquire_sem(vw->DocLock) < B_OK)
-      return 0;
- 
-    ((ViewApplication *)be_app)->SetSleepCursor();
+  // all hits on the page are highlighted, nothing has to be drawn again
 
-    PageNo = vw->PageNo;
+  for (i = 0; i < Hits.size(); i++)
+    if (Hits[i].Page == Hits[index].Page)
+      Found.push_back(Hits[i].Rect);
 
-    if (doc->Reload(&vw->Settings))
-      vw->DocumentChanged();
+  RequestChange(Hits[index].Page, ScrollNone, FindAllString, Found);
 
-    release_sem(vw->DocLock);
+  sf = Settings.ShrinkFactor();
+  r  = Hits[index].Rect;
+  b  = Bounds();
 
-    vw->SetDocument(doc, PageNo);
+  r.Set(r.left / sf, r.top / sf, r.right / sf, r.bottom / sf);
 
-    ((ViewApplication *)be_app)->SetNormalCursor();
-  }
-  catch(const exception &e)
-  {
-    log_error("%s!", e.what());
-    log_debug("at %s:%d", __FILE__, __LINE__);
-  }
-  catch(...)
-  {
-    log_error("unknown exception!");
-    log_debug("at %s:%d", __FILE__, __LINE__);
-  }
-  return 0;
+  if (!b.Contains(r))
+    ScrollTo(max_c(0.0, min_c(r.left - b.Width()  / 2, DocWidth  - b.Width()  - 1)),
+             max_c(0.0, min_c(r.top  - b.Height() / 2, DocHeight - b.Height() - 1)));
+
+  Invalidate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1353,11 +2959,38 @@ bool DVIView::Reload()
   return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::ReloadForFonts()                                                                                 //
+//                                                                                                                //
+// Reloads the document if some of its characters are drawn as boxes because their fonts are generated in the     //
+// background. Called when fonts have been generated; the fonts which were there already are used again.          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVIView::ReloadForFonts()
+{
+  bool Pending;
+
+  if (!Document)
+    return;
+
+  if (acquire_sem(DocLock) < B_OK)
+    return;
+
+  Pending = Document && Document->Fonts.GlyphsPending();
+
+  release_sem(DocLock);
+
+  if (Pending)
+    Reload();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // void DVIView::Search(const char *str, bool direction)                                                          //
 //                                                                                                                //
-// Searchs for the given string in the document.                                                                  //
+// Searchs for the given string in the document. The search is done by the render thread.                         //
 //                                                                                                                //
 // const char *str                      string to search for                                                      //
 // bool       direction                 `true': search forwards; `false': search backwards                        //
@@ -1369,80 +3002,94 @@ void DVIView::Search(const char *str, bool direction)
   if (!Document)
     return;
 
-  if (acquire_sem(DocLock) < B_OK)
+  if (acquire_sem(BufferLock) < B_OK)
     return;
 
-  ((ViewApplication *)be_app)->SetSleepCursor();
+  SearchRequested = true;
+  SearchRequest   = str;
+  SearchForwards  = direction;
 
-  BufferView->ResizeTo(DocWidth, DocHeight);
-  BufferView->MoveTo(0, 0);
-  Buffer->AddChild(BufferView);
+  release_sem(BufferLock);
 
-  if (BufferView->LockLooper())
-  {
-    if (acquire_sem(BufferLock) == B_OK)
-    {
-      DrawSettings set = Settings;
-      int          increment;
-      int          bound;
-      uint         OldPageNo = PageNo;
+  CancelRender = true;
 
-      if (direction)
-      {
-        increment = 1;
-        bound     = Document->NumPages;
-      }
-      else
-      {
-        increment = -1;
-        bound     = 1;
-      }
+  release_sem(RenderSem);
+}
 
-      set.SearchString = str;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVIView::FindNext(const string &str, bool direction)                                                      //
+//                                                                                                                //
+// Displays the next page containing the given string and highlights the hits on it. If the string was searched   //
+// for before, the search starts with the page after the displayed one. This procedure should only be called by   //
+// the render thread with `DocLock' locked.                                                                       //
+//                                                                                                                //
+// const string &str                    string to search for                                                      //
+// bool         direction               `true': search forwards; `false': search backwards                        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      if (SearchString != str)                   // first search: start with this page
-        SearchString = str;
+void DVIView::FindNext(const string &str, bool direction)
+{
+  TextIndex::HitList Hits;
+  RectList           Found;
+  uint               found = 0;
+  uint               i;
 
-      else                                       // else: start with next/previous page
-        if (PageNo != bound)
-          PageNo += increment;
+  ((ViewApplication *)be_app)->SetSleepCursor();
 
-      for (set.StringFound = false; !set.StringFound; PageNo += increment)
-      {
-        Document->Draw(BufferView, &set, PageNo);
+  try
+  {
+    int  increment;
+    uint bound;
+    uint start = PageNo;
 
-        if (!set.StringFound && PageNo == bound)
-          break;
-      }
-      if (set.StringFound)
-        PageNo -= increment;
+    if (direction)
+    {
+      increment = 1;
+      bound     = Document->NumPages;
+    }
+    else
+    {
+      increment = -1;
+      bound     = 1;
+    }
 
-      else
-      {
-        PageNo = OldPageNo;
+    if (SearchString == str && start != bound)   // searched before: start with next/previous page
+      start += increment;
 
-        set.SearchString = NULL;
+    // once the text index is complete no page has to be read; before that the pages are only scanned for text.
+    // The hits are drawn over the page, so it only has to be rendered if the page changes.
 
-        Document->Draw(BufferView, &set, PageNo);
-      }
+    if (Index != NULL)
+      found = Index->Find(str.c_str(), start, bound);
+    else
+      found = Document->Find(&Settings, str.c_str(), start, bound);
 
-      release_sem(BufferLock);
-    }
+    if (found != 0)
+    {
+      FindOnPage(Document, Index, &Settings, str.c_str(), found, Hits);
 
-    BufferView->UnlockLooper();
+      for (i = 0; i < Hits.size(); i++)
+        Found.push_back(Hits[i].Rect);
+    }
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_warn("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
   }
-  Buffer->RemoveChild(BufferView);
 
   ((ViewApplication *)be_app)->SetNormalCursor();
 
-  release_sem(DocLock);
+  // if nothing was found, the hits of the previous search are removed from the page
 
-  if (LockLooper())
-  {
-    UpdatePageCounter();
-    Invalidate();
-    UnlockLooper();
-  }
+  ShowPage(found != 0 ? found : PageNo, ScrollNone, str, Found);
 }
 
 static status_t SetFileType(BFile *File, int32 Translator, uint32 Type)
@@ -1486,19 +3133,38 @@ void DVIView::SavePage(BFile *File, uint32 Translator, uint32 Type)
   if (!Document)
     return;
 
-  if (Buffer != NULL && acquire_sem(BufferLock) == B_OK)
+  if (acquire_sem(DocLock) < B_OK)
+    return;
+
+  BBitmap *bm = NULL;
+
+  try
+  {
+    // the page isn't kept as a whole, so it's drawn into a temporary bitmap
+
+    bm = new BBitmap(BRect(0, 0, DocWidth - 1, DocHeight - 1), B_COLOR_8_BIT, true);
+
+    if (!RenderPart(bm, bm->Bounds()))
+    {
+      delete bm;
+      bm = NULL;
+    }
+  }
+  catch(...)
+  {
+    log_warn("not enough memory!");
+    bm = NULL;
+  }
+
+  release_sem(DocLock);
+
+  if (bm != NULL)
   {
-    BBitmapStream Page(Buffer);
+    BBitmapStream Page(bm);     // deletes `bm'
 
     if (BTranslatorRoster::Default()->Translate(Translator, &Page, NULL, File, Type) == B_OK)
       SetFileType(File, Translator, Type);
     else
       log_error("couldn't translate bitmap!");
-
-    BBitmap *bm;
-
-    Page.DetachBitmap(&bm);     // we still need `Buffer', don't delete it
-
-    release_sem(BufferLock);
   }
 }
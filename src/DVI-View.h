@@ -14,6 +14,7 @@
 #define VW_VIEW_H
 
 #include <View.h>
+#include <vector.h>
 
 #ifndef DEFINES_H
 #include "defines.h"
@@ -24,6 +25,23 @@
 #ifndef DOCVIEW_H
 #include "DocView.h"
 #endif
+#ifndef TILECACHE_H
+#include "TileCache.h"
+#endif
+#ifndef PAGECACHE_H
+#include "PageCache.h"
+#endif
+
+class TextIndex;
+
+// occurrence of the string looked for by `DVIView::FindAll()'
+
+struct SearchHit
+{
+  uint   Page;
+  BRect  Rect;         // bounding box in unshrunk pixels
+  string Context;      // surrounding text
+};
 
 class DVIView: public DocView
 {
@@ -32,7 +50,18 @@ class DVIView: public DocView
 
     enum
     {
-      BaseMagnifyWinSize = 20    // half size of the magnify window per 100 dpi resolution
+      BaseMagnifyWinSize = 20,                 // half size of the magnify window per 100 dpi resolution
+      PageCacheSize      = 24 * 1024 * 1024    // memory used for prerendered pages
+    };
+
+    typedef vector<SearchHit, allocator<SearchHit> > HitList;
+    typedef vector<BRect, allocator<BRect> >         RectList;
+
+    enum ScrollMode              // where to scroll after a requested page change
+    {
+      ScrollNone,
+      ScrollTop,
+      ScrollBottom
     };
 
     // document
@@ -43,21 +72,74 @@ class DVIView: public DocView
     // state
 
     DrawSettings Settings;
-    string       SearchString;
-    uint         PageNo;
+    string       SearchString;    // only used by the render thread
+    RectList     Highlights;      // hits on the displayed page in unshrunk pixels, drawn over the page
+    uint         PageNo;          // changed with `DocLock' and `BufferLock' held
+    bool         Loaded;          // there is a document; protected by `BufferLock' so `Draw()' needn't wait
+    uint         TargetPage;      // page requested by the last key press
+    ScrollMode   TargetScroll;
+    bool         PageRequested;   // `MsgShowPage' has been posted but not handled yet
+
+    // page changes and searches handled by the render thread, protected by `BufferLock'
+
+    bool         ChangeRequested;
+    uint         NewPage;
+    ScrollMode   NewScroll;
+    string       NewSearchString;
+    RectList     NewHighlights;
+    bool         SearchRequested;
+    string       SearchRequest;
+    bool         SearchForwards;
 
     // bitmaps
 
     sem_id       BufferLock;
-    BBitmap      *Buffer;          // whole page
+    TileCache    *Tiles;           // rendered parts of the page
+    PageCache    *Pages;           // prerendered neighbouring pages
+    BBitmap      *TileBuffer;      // tiles are drawn here and copied into the cache
     BBitmap      *MagnifyBuffer;   // magnified part of the page
+    BBitmap      *MagnifyBack;     // the render thread draws the next magnified part here
     BView        *BufferView;      // used to draw into the bitmaps
 
+    // rendering
+
+    sem_id       RenderSem;       // released when tiles or the magnify window are needed
+    thread_id    Renderer;
+    bool         CancelRender;    // the displayed page is about to change
+    BRect        RenderArea;      // part of the page whose missing tiles are drawn
+
+    // prerendering
+
+    sem_id       PrerenderSem;    // released when the displayed page changes
+    thread_id    Prerenderer;
+    bool         CancelPrerender; // the displayed page is about to change
+    bool         Quitting;        // the threads should exit
+
+    // text index
+
+    TextIndex    *Index;          // text of the document; only set when all pages are indexed
+    thread_id    Indexer;
+    bool         CancelIndex;     // the document is about to change
+
+    // search for all occurrences of a string
+
+    thread_id    Searcher;
+    bool         CancelSearch;    // the search was restarted or the document is about to change
+    int32        SearchId;        // identifies the messages of the current search
+    string       FindAllString;
+    HitList      Hits;            // occurrences found so far
+    bool         SearchDone;      // `Hits' is complete
+    BMessenger   HitTarget;       // receives a copy of the results
+
     // Magnify-Window
 
     BPoint       MousePos;
+    BPoint       MagnifyTarget;    // position requested from the render thread
+    BPoint       MagnifyPos;       // position `MagnifyBuffer' was drawn for
     int          MagnifyWinSize;
     bool         ShowMagnify;
+    bool         MagnifyRequested;
+    bool         MagnifyValid;     // `MagnifyBuffer' may be displayed
 
     // scripting
 
@@ -80,7 +162,9 @@ class DVIView: public DocView
 
     void SetDocument(DVI *doc, uint NewPageNo = 1);
     DVI  *UnsetDocument();
-    bool SetPage(int no);
+    bool SetPage(int no, ScrollMode scroll = ScrollNone);
+    bool SetPage(const char *Label);
+    void RequestPage(int no, ScrollMode scroll = ScrollNone);
     void UpdateMenus();
     void UpdatePageCounter();
 
@@ -88,19 +172,47 @@ class DVIView: public DocView
     void GetProperty(BMessage *msg);
     void SetProperty(BMessage *msg);
 
-    void SetShrinkFactor(ushort sf);
+    uint RequestedPage();
+    void ShowRequestedPage();
+    void RequestChange(uint no, ScrollMode scroll, const string &str, const RectList &Found);
+    void HandleRequests();
+    void ShowPage(uint no, ScrollMode scroll, const string &str, const RectList &Found);
+    void SetShrink(int32 Shrink);
+    void FitWidth();
     void ToggleBorderLine();
     void ToggleAntiAliasing();
-    void RedrawBuffer();
-    void RedrawMagnifyBuffer();
+    void FlushTiles();
+    void DrawTiles(BRect r);
+    void DrawHighlights(BRect r);
+    bool RenderPart(BBitmap *bm, BRect r, const bool *Cancel = NULL, bool *Preview = NULL);
+    bool NextMissingTile(int32 &Column, int32 &Row, bool &Preview);
+    bool RenderNext(BBitmap *&Back);
+    void RequestMagnify();
+    bool RedrawMagnifyBuffer(BPoint at);
     bool DocumentChanged();
     void PrintPage(uint no);
     void SetDspInfo(DisplayInfo *dsp);
 
     static int32 ReloadThread(void *arg);
+    static int32 RenderThread(void *arg);
+    static int32 PrerenderThread(void *arg);
+    static int32 IndexThread(void *arg);
+    static int32 SearchThread(void *arg);
+
+    PageKey CacheKey(uint no);
+    void    PrerenderPage(BView *View, BBitmap *&Scratch, int no);
+
+    void StartIndexer();
+    void StopIndexer();
+    void FindAll(const char *str, BMessenger Target);
+    void StopSearch();
+    void SearchResult(BMessage *msg);
+    void ShowHit(int32 index);
 
     bool Reload();
+    void ReloadForFonts();
     void Search(const char *str, bool direction);
+    void FindNext(const string &str, bool direction);
     void SavePage(BFile *File, uint32 Translator, uint32 Type);
 
   public:
@@ -108,6 +220,8 @@ class DVIView: public DocView
     {
       return (DocLock    >= B_OK) &&
              (BufferLock >= B_OK) &&
+             (Tiles      != NULL) &&
+             (Pages      != NULL) &&
              (BufferView != NULL);
     }
 
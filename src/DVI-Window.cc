@@ -189,18 +189,19 @@ void ViewWindow::MessageReceived(BMessage *msg)
       case MsgLast:
       case MsgSearchForwards:
       case MsgSearchBackwards:
+      case MsgFindAll:
+      case MsgShowHit:
+      case MsgFontsReady:
         vw->MessageReceived(msg);
         break;
 
       case MsgPage:
       {
-        ulong no = 1;
-
         Lock();
 
-        sscanf(((BTextControl *)FindView("PageNumber"))->Text(), "%lu", &no);
+        if (!vw->SetPage(((BTextControl *)FindView("PageNumber"))->Text()))
+          vw->UpdatePageCounter();                   // restore the number of the displayed page
 
-        vw->SetPage(no);
         vw->MakeFocus(true);
 
         Unlock();
@@ -208,7 +209,7 @@ void ViewWindow::MessageReceived(BMessage *msg)
       }
       default:
         if (msg->what <= 15)                                             // shrink factor
-          vw->SetShrinkFactor((ushort)msg->what);
+          vw->SetShrink(msg->what * DrawSettings::ShrinkOne);
 
         else if (msg->what < 0x10000)                                    // resolution
           ((ViewApplication *)be_app)->SetResolution(msg->what);
@@ -395,6 +396,9 @@ int32 ViewWindow::LoadFileThread(void *args)
     BEntry e(File);
     BPath  path;
 
+    if (e.GetPath(&path) == B_OK)
+      NewDocument->Path.assign(path.Path());
+
     if (e.GetParent(&e)  == B_OK &&
         e.GetPath(&path) == B_OK)
       NewDocument->Directory.assign(path.Path());
@@ -34,6 +34,9 @@
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 #include <InterfaceKit.h>
 #include <StorageKit.h>
@@ -54,12 +57,239 @@ extern "C"
 #include "DVI.h"
 #include "DVI-DrawPage.h"
 #include "FontList.h"
+#include "PageLayout.h"
+#include "RenderTarget.h"
 #include "TeXFont.h"
 #include "log.h"
 
 static const int NoMagStep = -29999;
 static const int NoBuild   =  29999;
 
+// bounding box of everything drawn on a page
+
+struct PageInk
+{
+  BRect Bounds;        // in unshrunk pixels; invalid for an empty page
+  bool  Known;         // the layout of the page has been read
+
+  PageInk():
+    Known(false)
+  {}
+};
+
+// reads the commands of a DVI file without using its file position
+
+struct PageScan
+{
+  BPositionIO *File;
+  ulong       Pos;             // offset of the next byte to be read
+  ulong       Start;           // offset of `Buffer[0]'
+  ssize_t     Length;          // number of valid bytes in `Buffer'
+  uchar       Buffer[4096];
+
+  PageScan(BPositionIO *f, ulong p):
+    File(f),
+    Pos(p),
+    Start(0),
+    Length(0)
+  {}
+
+  uint32 ReadInt(int Size)
+  {
+    uint32 x = 0;
+
+    while (Size--)
+    {
+      if (Pos < Start || Pos >= Start + Length)
+      {
+        if ((Length = File->ReadAt(Pos, Buffer, sizeof(Buffer))) <= 0)
+          throw(runtime_error("unexpected end of file"));
+
+        Start = Pos;
+      }
+      x = (x << 8) | Buffer[Pos++ - Start];
+    }
+    return x;
+  }
+
+  void Skip(ulong n)
+  {
+    Pos += n;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static ulong SkipDefinitions(PageScan &s)                                                                      //
+//                                                                                                                //
+// Skips the `NOP' and font definitions which may precede a page.                                                 //
+//                                                                                                                //
+// PageScan &s                          file positioned after the preamble or the end of a page                   //
+//                                                                                                                //
+// Result:                              offset of the next `BeginOP' or of the postamble                          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static ulong SkipDefinitions(PageScan &s)
+{
+  ulong  Pos;
+  uint32 c;
+
+  for (;;)
+  {
+    Pos = s.Pos;
+    c   = s.ReadInt(1);
+
+    if (c == DVI::BeginOP || c == DVI::Postamble)
+      return Pos;
+
+    if (c >= DVI::FontDef1 && c <= DVI::FontDef4)
+    {
+      s.Skip(13 + c - DVI::FontDef1);
+      s.Skip(s.ReadInt(1) + s.ReadInt(1));
+    }
+    else if (c != DVI::NOP)
+      throw(runtime_error("invalid operand between pages"));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static ulong NextPage(BPositionIO *File, ulong Offset, int32 *Count0)                                          //
+//                                                                                                                //
+// Finds the start of the page following another one by skipping its commands. Only the length of each command    //
+// is looked at.                                                                                                  //
+//                                                                                                                //
+// BPositionIO *File                    DVI file                                                                  //
+// ulong       Offset                   offset of the `BeginOP' of the page                                       //
+// int32       *Count0                  returns the value of \count0 of the page                                  //
+//                                                                                                                //
+// Result:                              offset of the next `BeginOP' or of the postamble                          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static ulong NextPage(BPositionIO *File, ulong Offset, int32 *Count0)
+{
+  PageScan s(File, Offset);
+  uint32   c;
+
+  if (s.ReadInt(1) != DVI::BeginOP)
+    throw(runtime_error("page expected"));
+
+  *Count0 = (int32)s.ReadInt(4);
+
+  s.Skip(40);
+
+  while ((c = s.ReadInt(1)) != DVI::EndOP)
+  {
+    if (c < DVI::Set1 || (c >= DVI::FontNum0 && c < DVI::Font1))
+      continue;
+
+    switch (c)
+    {
+      case DVI::SetRule:
+      case DVI::PutRule:
+        s.Skip(8);
+        break;
+
+      case DVI::NOP:
+      case DVI::Push:
+      case DVI::Pop:
+      case DVI::W0:
+      case DVI::X0:
+      case DVI::Y0:
+      case DVI::Z0:
+      case DVI::StartRefl:
+      case DVI::EndRefl:
+        break;
+
+      case DVI::XXX1:
+      case DVI::XXX2:
+      case DVI::XXX3:
+      case DVI::XXX4:
+        s.Skip(s.ReadInt(c - DVI::XXX1 + 1));
+        break;
+
+      case DVI::FontDef1:
+      case DVI::FontDef2:
+      case DVI::FontDef3:
+      case DVI::FontDef4:
+        s.Skip(13 + c - DVI::FontDef1);
+        s.Skip(s.ReadInt(1) + s.ReadInt(1));
+        break;
+
+      default:
+        if      (c >= DVI::Set1   && c <  DVI::SetRule) s.Skip(c - DVI::Set1   + 1);
+        else if (c >= DVI::Put1   && c <  DVI::PutRule) s.Skip(c - DVI::Put1   + 1);
+        else if (c >= DVI::Right1 && c <= DVI::Right4)  s.Skip(c - DVI::Right1 + 1);
+        else if (c >= DVI::W1     && c <= DVI::W4)      s.Skip(c - DVI::W1     + 1);
+        else if (c >= DVI::X1     && c <= DVI::X4)      s.Skip(c - DVI::X1     + 1);
+        else if (c >= DVI::Down1  && c <= DVI::Down4)   s.Skip(c - DVI::Down1  + 1);
+        else if (c >= DVI::Y1     && c <= DVI::Y4)      s.Skip(c - DVI::Y1     + 1);
+        else if (c >= DVI::Z1     && c <= DVI::Z4)      s.Skip(c - DVI::Z1     + 1);
+        else if (c >= DVI::Font1  && c <= DVI::Font4)   s.Skip(c - DVI::Font1  + 1);
+        else
+        {
+          log_warn("invalid operand: 0x%02x!", (uint)c);
+          throw(runtime_error("invalid operand"));
+        }
+        break;
+    }
+  }
+
+  return SkipDefinitions(s);
+}
+
+// value of `DVI::Count0' for pages whose \count0 hasn't been read yet; TeX's counters can't get this low
+
+static const int32 NoLabel = (int32)0x80000000;
+
+// offset stored as the previous page of the first page
+
+static const ulong NoPage = 0xffffffffUL;
+
+// reads a 4 byte integer
+
+static inline ulong BigEndian(const uchar *p)
+{
+  return ((ulong)p[0] << 24) | ((ulong)p[1] << 16) | ((ulong)p[2] << 8) | (ulong)p[3];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static ulong PreviousPage(BPositionIO *File, ulong Offset, int32 *Count0 = NULL)                               //
+//                                                                                                                //
+// Reads the pointer to the previous page stored in a page or in the postamble.                                   //
+//                                                                                                                //
+// BPositionIO *File                    DVI file                                                                  //
+// ulong       Offset                   offset of the `BeginOP' of the page or of the postamble                   //
+// int32       *Count0                  returns the value of \count0 of the page if not `NULL'                    //
+//                                                                                                                //
+// Result:                              offset of the previous page or `NoPage' if there is none                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static ulong PreviousPage(BPositionIO *File, ulong Offset, int32 *Count0 = NULL)
+{
+  uchar   Buffer[45];
+  uchar   *p;
+  ssize_t Length;
+
+  Length = File->ReadAt(Offset, Buffer, sizeof(Buffer));     // the postamble may be shorter than a `BeginOP'
+
+  if (Length == (ssize_t)sizeof(Buffer) && Buffer[0] == DVI::BeginOP)
+    p = &Buffer[41];
+  else if (Length >= 5 && Buffer[0] == DVI::Postamble && Count0 == NULL)
+    p = &Buffer[1];
+  else
+    throw(runtime_error("page expected"));
+
+  if (Count0)
+    *Count0 = (int32)BigEndian(&Buffer[1]);
+
+  return BigEndian(p);
+}
+
 
 /* DisplayInfo ****************************************************************************************************/
 
@@ -183,6 +413,25 @@ DVI::DVI(BPositionIO *File, DrawSettings *Settings, void (*DspError)(const char
   DVIFile(File),
   Name(NULL),
   PageOffset(NULL),
+  PostambleOffset(0),
+  CountKnown(false),
+  Count0(NULL),
+  LabelTarget(),
+  LabelsChanged(0),
+  LabelsPosted(0),
+  OffsetLock(create_sem(1, "page offsets")),
+  Counter(B_ERROR),
+  CancelCount(false),
+  Renumbered(false),
+  Layouts(NULL),
+  LayoutQueue(),
+  FullPage(NULL),
+  FullPageNo(0),
+  FullPageDPI(0),
+  FullOutlines(false),
+  FullPageLock(create_sem(1, "unshrunken page")),
+  Ink(NULL),
+  NumLayouts(0),
   Magnification(1000),
   DimConvert(1.0),
   OffsetX(Settings->DspInfo.PixelsPerInch),
@@ -191,13 +440,21 @@ DVI::DVI(BPositionIO *File, DrawSettings *Settings, void (*DspError)(const char
 {
   if (!Reload(Settings))
   {
+    FlushLayouts();
+
     delete [] Name;
     delete [] PageOffset;
+    delete [] Count0;
+    delete [] Layouts;
+    delete [] Ink;
     delete DVIFile;
 
     DVIFile    = NULL;
     Name       = NULL;
     PageOffset = NULL;
+    Count0     = NULL;
+    Layouts    = NULL;
+    Ink        = NULL;
 
     return;
   }
@@ -213,8 +470,20 @@ DVI::DVI(BPositionIO *File, DrawSettings *Settings, void (*DspError)(const char
 
 DVI::~DVI()
 {
+  StopCounter();
+  FlushLayouts();
+
   delete [] Name;
   delete [] PageOffset;
+  delete [] Count0;
+  delete [] Layouts;
+  delete [] Ink;
+  delete FullPage;
+
+  if (OffsetLock >= B_OK)
+    delete_sem(OffsetLock);
+  if (FullPageLock >= B_OK)
+    delete_sem(FullPageLock);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -264,11 +533,14 @@ bool DVI::Reload(DrawSettings *Settings)
   long    Denominator;
   int     len;
   long    LastPageOffset;
+  ulong   FirstPageOffset;
   long    pos;
   uchar   *p;
   uchar   Buffer[BufferLen];
   uchar   x;
   uchar   Command;
+  uint    Pages;
+  bool    Known;
   int     i;
 
   try
@@ -277,6 +549,8 @@ bool DVI::Reload(DrawSettings *Settings)
 
     ASSERT(DVIFile != NULL);
 
+    StopCounter();
+
     DVIFile->Seek(0, SEEK_SET);
 
     if (ReadInt(DVIFile, 1) != Preamble)
@@ -304,6 +578,10 @@ bool DVI::Reload(DrawSettings *Settings)
     DVIFile->Read(Name, len);
     Name[len] = 0;
 
+    PageScan s(DVIFile, 15 + len);
+
+    FirstPageOffset = SkipDefinitions(s);
+
     pos = DVIFile->Seek(0, SEEK_END);
 
     if (pos > BufferLen)
@@ -340,7 +618,7 @@ bool DVI::Reload(DrawSettings *Settings)
     }
 
     DVIFile->Seek(pos - 4, SEEK_SET);
-    DVIFile->Seek((long)ReadInt(DVIFile, 4), SEEK_SET);
+    DVIFile->Seek(PostambleOffset = ReadInt(DVIFile, 4), SEEK_SET);
 
     if (ReadInt(DVIFile, 1) != Postamble)
     {
@@ -361,7 +639,18 @@ bool DVI::Reload(DrawSettings *Settings)
 
     ReadInt(DVIFile, 2);
 
-    NumPages = ReadInt(DVIFile, 2);
+    FlushLayouts();                  // layouts refer to the fonts
+
+    if (acquire_sem(FullPageLock) == B_OK)
+    {
+      delete FullPage;
+      FullPage   = NULL;
+      FullPageNo = 0;
+
+      release_sem(FullPageLock);
+    }
+
+    Pages = ReadInt(DVIFile, 2);
 
     Fonts.FreeFonts();
     Fonts.FlushShrinkedGlyphes();
@@ -379,21 +668,85 @@ bool DVI::Reload(DrawSettings *Settings)
       return false;
     }
 
-    delete [] PageOffset;
+    // The offsets of the pages are resolved when they are needed, starting from the first and the last page. The
+    // postamble stores only the lower 16 bits of the number of pages; unless the file is too short to contain
+    // another 65536 pages, the number is taken as it is until the pages have been counted in the background.
+
+    if (FirstPageOffset == PostambleOffset ? Pages != 0 : FirstPageOffset > (ulong)LastPageOffset)
+    {
+      log_error("file corrupt?");
+      return false;
+    }
+
+    Known = (PostambleOffset - FirstPageOffset < (Pages + 65536UL) * MinPageSize);
+
+    if (Pages == 0)
+      Known = (FirstPageOffset == PostambleOffset);
+    if (Pages == 0 && !Known)
+      Pages = 65536;
+
+    // the labels of the pages may be looked up while the document is reloaded
+
+    if (acquire_sem(OffsetLock) < B_OK)
+      throw(runtime_error("can't lock page offsets"));
+
+    try
+    {
+      delete [] PageOffset;
+      delete [] Count0;
+      delete [] Layouts;
+      delete [] Ink;
+
+      PageOffset = NULL;
+      Count0     = NULL;
+      Layouts    = NULL;
+      Ink        = NULL;
+      NumPages   = 0;
+      NumLayouts = 0;
+
+      LabelPages.clear();
+
+      PageOffset = new ulong[Pages + 1];
+      Count0     = new int32[Pages];
+      Layouts    = new PageLayout *[Pages];
+      Ink        = new PageInk[Pages];
+      NumPages   = Pages;
+      NumLayouts = Pages;
+      CountKnown = Known;
+    }
+    catch(...)
+    {
+      release_sem(OffsetLock);
+      throw;
+    }
 
-    PageOffset = new ulong[NumPages];
+    memset(Layouts,    0, NumPages * sizeof(PageLayout *));
+    memset(PageOffset, 0, (NumPages + 1) * sizeof(ulong));
 
-    PageOffset[NumPages - 1] = LastPageOffset;
-    DVIFile->Seek(LastPageOffset, SEEK_SET);
+    for (i = 0; i < (int)NumPages; i++)
+      Count0[i] = NoLabel;
 
-    for (i = NumPages - 2; i >= 0; i--)
+    if (NumPages > 0)
     {
-      DVIFile->Seek(41, SEEK_CUR);
-      DVIFile->Seek(PageOffset[i] = ReadInt(DVIFile, 4), SEEK_SET);
+      PageOffset[0]            = FirstPageOffset;
+      PageOffset[NumPages - 1] = LastPageOffset;
     }
+    PageOffset[NumPages] = PostambleOffset;
+    Renumbered           = false;
+
+    release_sem(OffsetLock);
+
+    SetPageSize(Settings);
+
+    // the pages are counted and their labels read in the background
+
+    if (NumPages > 0)
+    {
+      CancelCount = false;
 
-    PageWidth  = (UnshrunkPageWidth  + Settings->ShrinkFactor - 1) / Settings->ShrinkFactor + 2;
-    PageHeight = (UnshrunkPageHeight + Settings->ShrinkFactor - 1) / Settings->ShrinkFactor + 2;
+      if ((Counter = spawn_thread(CountThread, "count pages", B_LOW_PRIORITY, this)) >= B_OK)
+        resume_thread(Counter);
+    }
 
     return true;
   }
@@ -413,46 +766,51 @@ bool DVI::Reload(DrawSettings *Settings)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void DVI::Draw(BView *vw, DrawSettings *Settings, uint PageNo)                                                 //
+// void DVI::Interpret(DrawPage &dp, uint PageNo)                                                                 //
 //                                                                                                                //
-// Draws a DVI-Document.                                                                                          //
+// Reads a page into memory and executes it. The output device of `dp' must already be set. The file position     //
+// isn't used, so several threads may interpret pages at the same time.                                           //
 //                                                                                                                //
-// BView        *vw                     view the document should be displayed in                                  //
-// DrawSettings *Settings               settings used to draw the page                                            //
-// uint         PageNo                  page to be displayed                                                      //
+// DrawPage &dp                         drawing information                                                       //
+// uint     PageNo                      page to be displayed                                                      //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DVI::Draw(BView *vw, DrawSettings *Settings, uint PageNo)
+void DVI::Interpret(DrawPage &dp, uint PageNo)
 {
-  DrawPage dp(*Settings);
-  size_t   BufferLen;
+  size_t BufferLen;
+  ulong  Start;
+  uchar  *Buffer;
+
+  // read page into memory
 
-  vw->PushState();
+  if (acquire_sem(OffsetLock) < B_OK)
+    throw(runtime_error("can't lock page offsets"));
 
   try
   {
-    PageWidth  = (UnshrunkPageWidth  + Settings->ShrinkFactor - 1) / Settings->ShrinkFactor + 2;
-    PageHeight = (UnshrunkPageHeight + Settings->ShrinkFactor - 1) / Settings->ShrinkFactor + 2;
-
-    // read page into memory
-
-    if (PageNo < NumPages)                                       // this is a little bit more than the actual page
-      BufferLen = PageOffset[PageNo] - PageOffset[PageNo - 1];
-    else
-    {
-      BufferLen =  DVIFile->Seek(0, SEEK_END);
-      BufferLen -= PageOffset[PageNo - 1];
-    }
+    BufferLen = PageStart(PageNo + 1);                         // this is a little bit more than the actual page
+    Start     = PageStart(PageNo);
+    BufferLen -= Start;
+  }
+  catch(...)
+  {
+    release_sem(OffsetLock);
+    PostLabels();
+    throw;
+  }
 
-    DVIFile->Seek(PageOffset[PageNo - 1], SEEK_SET);
+  release_sem(OffsetLock);
+  PostLabels();
 
-    dp.BufferPos = new uchar[BufferLen];
+  Buffer = new uchar[BufferLen];
 
-    DVIFile->Read(dp.BufferPos, BufferLen);
+  try
+  {
+    if (DVIFile->ReadAt(Start, Buffer, BufferLen) < (ssize_t)BufferLen)
+      throw(runtime_error("can't read page"));
 
     dp.Document    = this;
-    dp.vw          = vw;
     dp.TPicConvert = TPicConvert;
     dp.DimConvert  = DimConvert;
     dp.DrawDir     = 1;
@@ -460,65 +818,1418 @@ void DVI::Draw(BView *vw, DrawSettings *Settings, uint PageNo)
     dp.CurFont     = NULL;
     dp.SetChar     = dp.SetNoChar;
     dp.File        = DVIFile;
-    dp.BufferEnd   = dp.BufferPos + BufferLen;
+    dp.BufferPos   = Buffer;
+    dp.BufferEnd   = Buffer + BufferLen;
     dp.ScanFrame   = NULL;
 
     memset(&dp.Data, 0, sizeof(dp.Data));
 
-    // draw it
+    dp.DrawPart();
+  }
+  catch(...)
+  {
+    delete [] Buffer;
+    dp.BufferPos = NULL;
+    dp.BufferEnd = NULL;
+    throw;
+  }
+
+  delete [] Buffer;
+  dp.BufferPos = NULL;
+  dp.BufferEnd = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// ulong DVI::PageStart(uint PageNo)                                                                              //
+//                                                                                                                //
+// Returns the offset of a page in the file. Unknown offsets are resolved from the nearest known ones, either by  //
+// following the pointers to the previous pages or by skipping pages forwards, and every offset passed on the way //
+// is kept. Pages resolved from the last one are renumbered by `CountThread' if the postamble counted the pages   //
+// wrong. `OffsetLock' must be held.                                                                              //
+//                                                                                                                //
+// uint PageNo                          page number; `NumPages + 1' returns the offset of the postamble           //
+//                                                                                                                //
+// Result:                              offset of the `BeginOP' of the page                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    vw->SetHighColor( 0,   0,   0, 255);
-    vw->SetLowColor(255, 255, 255, 255);
+ulong DVI::PageStart(uint PageNo)
+{
+  uint  Index = PageNo - 1;
+  uint  Below, Above, i;
+  ulong Next;
+  int32 Label;
 
-    vw->SetDrawingMode(B_OP_COPY);
-    vw->FillRect(vw->Bounds(), B_SOLID_LOW);
+  if (PageNo < 1 || Index > NumPages)
+    throw(runtime_error("page doesn't exist"));
 
-    if (dp.Settings.AntiAliasing && dp.Settings.ShrinkFactor > 1)
-      vw->SetDrawingMode(B_OP_MIN);
-    else
-      vw->SetDrawingMode(B_OP_OVER);
+  if (PageOffset[Index] != 0)
+    return PageOffset[Index];
 
-    dp.DrawPart();
+  for (Below = Index; PageOffset[Below] == 0; Below--)    // the first page is always known
+    ;
+  for (Above = Index; PageOffset[Above] == 0; Above++)    // and so is the postamble
+    ;
 
-    delete [] (dp.BufferEnd - BufferLen);
-    dp.BufferPos = NULL;
-    dp.BufferEnd = NULL;
+  if (Above - Index < (Index - Below) * PageSkipCost)
+  {
+    for (i = Above; i > Index; i--)
+    {
+      PageOffset[i - 1] = PreviousPage(DVIFile, PageOffset[i], i < NumPages ? &Label : NULL);
 
-    // draw border
+      if (PageOffset[i - 1] < PageOffset[0] || PageOffset[i - 1] >= PageOffset[i])
+        throw(runtime_error("invalid pointer to the previous page"));
 
-    if (dp.Settings.BorderLine)
+      if (i < NumPages)
+        SetLabel(i, Label);
+    }
+  }
+  else
+  {
+    for (i = Below; i < Index; i++)
     {
-      BRect   r;
-      pattern Dash = {0xf0, 0xf0, 0xf0, 0xf0, 0x0f, 0x0f, 0x0f, 0x0f};
+      Next = NextPage(DVIFile, PageOffset[i], &Label);
 
-      vw->SetDrawingMode(B_OP_COPY);
+      SetLabel(i, Label);
 
-      r.Set(dp.Settings.DspInfo.PixelsPerInch / dp.Settings.ShrinkFactor,
-            dp.Settings.DspInfo.PixelsPerInch / dp.Settings.ShrinkFactor,
-            PageWidth  - dp.Settings.DspInfo.PixelsPerInch / dp.Settings.ShrinkFactor,
-            PageHeight - dp.Settings.DspInfo.PixelsPerInch / dp.Settings.ShrinkFactor);
+      if (Next == PostambleOffset)                         // the postamble counted the pages wrong
+      {
+        if (CountKnown)
+          throw(runtime_error("wrong number of pages"));
+
+        log_warn("postamble says %u pages, found %u!", NumPages, i + 1);
 
-      vw->StrokeLine(BPoint(r.left,  0.0),      BPoint(r.left,        PageHeight - 1), Dash);
-      vw->StrokeLine(BPoint(r.right, 0.0),      BPoint(r.right,       PageHeight - 1), Dash);
-      vw->StrokeLine(BPoint(0.0,     r.top),    BPoint(PageWidth - 1, r.top),          Dash);
-      vw->StrokeLine(BPoint(0.0,     r.bottom), BPoint(PageWidth - 1, r.bottom),       Dash);
+        NumPages             = i + 1;
+        PageOffset[NumPages] = Next;
+
+        throw(runtime_error("page doesn't exist"));
+      }
+      PageOffset[i + 1] = Next;
     }
+  }
+
+  return PageOffset[Index];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::GrowPages(uint Count)                                                                                //
+//                                                                                                                //
+// Makes room for more pages than the postamble counted. The offsets and \count0 values of the new pages are      //
+// unknown. `OffsetLock' must be held.                                                                            //
+//                                                                                                                //
+// uint Count                           new number of pages                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::GrowPages(uint Count)
+{
+  ulong *NewOffsets;
+  int32 *NewCount0;
+  uint  i;
 
-    vw->Sync();
+  if (Count <= NumPages)
+    return;
+
+  NewOffsets = new ulong[Count + 1];
+
+  try
+  {
+    NewCount0 = new int32[Count];
   }
-  catch(const exception &e)
+  catch(...)
   {
-    log_warn("%s!", e.what());
-    log_debug("at %s:%d", __FILE__, __LINE__);
+    delete [] NewOffsets;
+    throw;
+  }
 
-    if (dp.BufferPos && dp.BufferEnd)
-      delete [] (dp.BufferEnd - BufferLen);
+  memset(NewOffsets, 0, (Count + 1) * sizeof(ulong));
+  memcpy(NewOffsets, PageOffset, NumPages * sizeof(ulong));    // the postamble moves to the end
 
-    if (DisplayError)
-      (*DisplayError)(e.what());
+  for (i = 0; i < Count; i++)
+    NewCount0[i] = i < NumPages ? Count0[i] : NoLabel;
+
+  delete [] PageOffset;
+  delete [] Count0;
+
+  PageOffset = NewOffsets;
+  Count0     = NewCount0;
+  NumPages   = Count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::SetLabel(uint Index, int32 Label)                                                                    //
+//                                                                                                                //
+// Stores the \count0 of a page unless it is already known and adds the page to `LabelPages'. `OffsetLock' must   //
+// be held.                                                                                                       //
+//                                                                                                                //
+// uint  Index                          page number - 1                                                           //
+// int32 Label                          \count0 of the page                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::SetLabel(uint Index, int32 Label)
+{
+  PageList *Pages;
+
+  if (Count0[Index] != NoLabel)
+    return;
+
+  Pages = &LabelPages[Label];
+
+  Pages->insert(upper_bound(Pages->begin(), Pages->end(), Index + 1), Index + 1);
+
+  Count0[Index] = Label;
+
+  atomic_or(&LabelsChanged, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::PostLabels()                                                                                         //
+//                                                                                                                //
+// Sends `MsgLabelsRead' to `LabelTarget' if labels have been read. No further message is sent until the last one //
+// has been answered by `PageLabel', so skipping over many pages sends only a few. Must be called after releasing //
+// `OffsetLock', so the receiver can read the labels at once.                                                     //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::PostLabels()
+{
+  BMessenger Target;
+  BMessage   msg(MsgLabelsRead);
+
+  if (*(volatile int32 *)&LabelsChanged == 0 || atomic_or(&LabelsPosted, 1) != 0)
+    return;
+
+  atomic_and(&LabelsChanged, 0);
+
+  if (acquire_sem(OffsetLock) == B_OK)
+  {
+    Target = LabelTarget;
+
+    release_sem(OffsetLock);
   }
 
-  Settings->StringFound = dp.StringFound();
+  if (!Target.IsValid() || Target.SendMessage(&msg, (BHandler *)NULL, 0) < B_OK)
+    atomic_and(&LabelsPosted, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVI::GrowLayouts(uint PageNo)                                                                             //
+//                                                                                                                //
+// Makes sure that `Layouts' and `Ink' have an entry for a page after `NumPages' has grown and drops them if the  //
+// pages have been renumbered.                                                                                    //
+//                                                                                                                //
+// uint PageNo                          page number                                                               //
+//                                                                                                                //
+// Result:                              `false' if there is no entry for the page                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVI::GrowLayouts(uint PageNo)
+{
+  PageLayout **NewLayouts = NULL;
+  PageInk    *NewInk;
+  uint       Count        = NumPages;
+  uint       i;
+
+  if (*(volatile const bool *)&Renumbered)
+  {
+    FlushLayouts();
+
+    for (i = 0; i < NumLayouts; i++)
+      Ink[i] = PageInk();
+
+    FullPageNo = 0;
+    Renumbered = false;
+  }
+
+  if (PageNo <= NumLayouts)
+    return true;
+  if (PageNo > Count)
+    return false;
+
+  try
+  {
+    NewLayouts = new PageLayout *[Count];
+    NewInk     = new PageInk[Count];
+  }
+  catch(...)
+  {
+    delete [] NewLayouts;
+    return false;
+  }
+
+  memset(NewLayouts, 0, Count * sizeof(PageLayout *));
+
+  for (i = 0; i < NumLayouts; i++)
+  {
+    NewLayouts[i] = Layouts[i];
+    NewInk[i]     = Ink[i];
+  }
+
+  delete [] Layouts;
+  delete [] Ink;
+
+  Layouts    = NewLayouts;
+  Ink        = NewInk;
+  NumLayouts = Count;
 
-  vw->PopState();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVI::CountThread(void *arg)                                                                              //
+//                                                                                                                //
+// Counts the pages and reads their \count0 by following the pointers from the postamble back to the first page.  //
+// The file is read without locking; `OffsetLock' is only held to store the offsets and labels at the end. Pages  //
+// numbered from the last page under a wrong number of pages are renumbered.                                      //
+//                                                                                                                //
+// void *arg                            pointer to the document                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVI::CountThread(void *arg)
+{
+  DVI                              *doc = (DVI *)arg;
+  vector<ulong, allocator<ulong> > Offsets;
+  vector<int32, allocator<int32> > Labels;
+  ulong                            Offset, Previous;
+  int32                            Label;
+  uint                             Count, i;
+  bool                             Renumber = false;
+
+  try
+  {
+    for (Offset = PreviousPage(doc->DVIFile, doc->PostambleOffset); Offset != NoPage; Offset = Previous)
+    {
+      if (*(volatile const bool *)&doc->CancelCount)
+        return 0;
+
+      if (Offset >= (Offsets.empty() ? doc->PostambleOffset : Offsets.back()))
+        throw(runtime_error("invalid pointer to the previous page"));
+
+      Previous = PreviousPage(doc->DVIFile, Offset, &Label);
+
+      Offsets.push_back(Offset);
+      Labels.push_back(Label);
+    }
+
+    if (acquire_sem(doc->OffsetLock) < B_OK)
+      return 0;
+
+    try
+    {
+      Count = Offsets.size();
+
+      if (Count == 0 || Offsets.back() != doc->PageOffset[0])
+        throw(runtime_error("invalid pointer to the previous page"));
+
+      if (Count != doc->NumPages && doc->CountKnown)
+        throw(runtime_error("wrong number of pages"));
+
+      // pages resolved by `PageStart' meanwhile are off the chain only if they were numbered from the last page
+      // under a wrong number of pages
+
+      for (i = 0; i < doc->NumPages && !Renumber; i++)
+        Renumber = doc->PageOffset[i] != 0 && (i >= Count || doc->PageOffset[i] != Offsets[Count - 1 - i]);
+
+      if (Count != doc->NumPages)
+        log_warn("postamble says %u pages, found %u!", doc->NumPages, Count);
+
+      doc->GrowPages(Count);
+      doc->LabelPages.clear();
+
+      for (i = 0; i < Count; i++)
+      {
+        doc->PageOffset[i] = Offsets[Count - 1 - i];
+        doc->Count0[i]     = NoLabel;
+        doc->SetLabel(i, Labels[Count - 1 - i]);
+      }
+
+      doc->PageOffset[Count] = doc->PostambleOffset;
+      doc->NumPages          = Count;
+      doc->CountKnown        = true;
+
+      if (Renumber)
+        doc->Renumbered = true;
+    }
+    catch(...)
+    {
+      release_sem(doc->OffsetLock);
+      throw;
+    }
+
+    release_sem(doc->OffsetLock);
+
+    doc->PostLabels();
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_warn("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::StopCounter()                                                                                        //
+//                                                                                                                //
+// Stops counting the pages in the background.                                                                    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::StopCounter()
+{
+  status_t res;
+
+  if (Counter >= B_OK)
+  {
+    CancelCount = true;
+
+    wait_for_thread(Counter, &res);
+
+    Counter = B_ERROR;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::Draw(RenderTarget *rt, DrawSettings *Settings, uint PageNo, const BRect *Clip = NULL)                //
+//                                                                                                                //
+// Draws a DVI-Document. If a clipping rectangle is given, the page is drawn from its cached layout and all       //
+// characters and rules outside of the rectangle are skipped.                                                     //
+//                                                                                                                //
+// RenderTarget *rt                     device the document should be displayed on                                //
+// DrawSettings *Settings               settings used to draw the page                                            //
+// uint         PageNo                  page to be displayed                                                      //
+// const BRect  *Clip                   part of the page which has to be drawn or `NULL' for the whole page       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::Draw(RenderTarget *rt, DrawSettings *Settings, uint PageNo, const BRect *Clip)
+{
+  DrawPage   dp(*Settings);
+  PageLayout *l = NULL;
+
+  rt->Begin(Settings->AntiAliasing && Settings->Shrink > DrawSettings::ShrinkOne);
+
+  try
+  {
+    SetPageSize(Settings);
+
+    dp.rt       = rt;
+    dp.Document = this;
+
+    if (Clip)
+    {
+      dp.Clip = *Clip;
+
+      // the search has to see every character in order, so it needs the interpreter
+
+      if (Settings->SearchString == NULL)
+        l = Layout(Settings, PageNo);
+    }
+
+    if (l)
+    {
+      if (l->HasSpecials)
+      {
+        dp.Mode = DrawPage::DrawSpecials;
+        Interpret(dp, PageNo);
+        dp.Mode = DrawPage::DrawAll;
+      }
+      dp.DrawLayout(l);
+    }
+    else
+      Interpret(dp, PageNo);
+
+    DrawBorder(rt, Settings);
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (DisplayError)
+      (*DisplayError)(e.what());
+  }
+
+  Settings->StringFound = dp.StringFound();
+  Settings->Incomplete  = dp.Incomplete;
+
+  rt->End();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::Draw(BView *vw, DrawSettings *Settings, uint PageNo, const BRect *Clip = NULL)                       //
+//                                                                                                                //
+// Draws a DVI-Document into a view.                                                                              //
+//                                                                                                                //
+// BView        *vw                     view the document should be displayed in                                  //
+// DrawSettings *Settings               settings used to draw the page                                            //
+// uint         PageNo                  page to be displayed                                                      //
+// const BRect  *Clip                   part of the page which has to be drawn or `NULL' for the whole page       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::Draw(BView *vw, DrawSettings *Settings, uint PageNo, const BRect *Clip)
+{
+  ViewTarget rt(vw);
+
+  Draw(&rt, Settings, PageNo, Clip);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::Draw(PageBuffer *pb, DrawSettings *Settings, uint PageNo, const BRect *Clip = NULL)                  //
+//                                                                                                                //
+// Draws a DVI-Document into a page buffer. This doesn't need the app_server. PostScript figures are replaced by  //
+// their bounding boxes. If `Settings->Supersample' is set, the whole page is drawn by `DrawSupersampled'.        //
+//                                                                                                                //
+// PageBuffer   *pb                     buffer the page is drawn into                                             //
+// DrawSettings *Settings               settings used to draw the page                                            //
+// uint         PageNo                  page to be displayed                                                      //
+// const BRect  *Clip                   part of the page which has to be drawn or `NULL' for the whole page       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::Draw(PageBuffer *pb, DrawSettings *Settings, uint PageNo, const BRect *Clip)
+{
+  if (Settings->Supersample && Clip == NULL && Settings->SearchString == NULL &&
+      Settings->Shrink > DrawSettings::ShrinkOne)
+  {
+    DrawSupersampled(pb, Settings, PageNo, 1);
+    return;
+  }
+
+  MemoryTarget rt(pb);
+
+  Draw(&rt, Settings, PageNo, Clip);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::DrawCropped(PageBuffer *pb, DrawSettings *Settings, uint PageNo, const BRect &Crop)                  //
+//                                                                                                                //
+// Draws a part of a page into a buffer of its size, so only that part is cleared and composited. Together with   //
+// `ContentBounds' this crops the page to its content.                                                            //
+//                                                                                                                //
+// PageBuffer   *pb                     buffer of the size of `Crop'                                              //
+// DrawSettings *Settings               settings used to draw the page                                            //
+// uint         PageNo                  page to be displayed                                                      //
+// const BRect  &Crop                   part of the page in shrunken pixels                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::DrawCropped(PageBuffer *pb, DrawSettings *Settings, uint PageNo, const BRect &Crop)
+{
+  MemoryTarget rt(pb, (int32)Crop.left, (int32)Crop.top);
+
+  Draw(&rt, Settings, PageNo, &Crop);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// BRect DVI::ContentBounds(const DrawSettings *Settings, uint PageNo)                                            //
+//                                                                                                                //
+// Returns the part of a page which contains characters, rules or figures. It is taken from the layout of the     //
+// page and kept after the layout has been dropped. Pages with \special commands aren't cropped since the extent  //
+// of the figures isn't known.                                                                                    //
+//                                                                                                                //
+// const DrawSettings *Settings         settings used to draw the page                                            //
+// uint               PageNo            page number                                                               //
+//                                                                                                                //
+// Result:                              bounding box in shrunken pixels, one pixel larger than the ink for anti   //
+//                                      aliasing, or an invalid rectangle for an empty page                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BRect DVI::ContentBounds(const DrawSettings *Settings, uint PageNo)
+{
+  BRect r;
+
+  if (Ink == NULL || PageNo < 1 || PageNo > NumPages || !GrowLayouts(PageNo))
+    return r;
+
+  if (!Ink[PageNo - 1].Known && Layout(Settings, PageNo) == NULL)
+    return r;
+
+  if (!Ink[PageNo - 1].Bounds.IsValid())
+    return r;
+
+  SetPageSize(Settings);
+
+  r.left   = max_c(Settings->PixelConv((int32)Ink[PageNo - 1].Bounds.left   << 16) - 1, 0);
+  r.top    = max_c(Settings->PixelConv((int32)Ink[PageNo - 1].Bounds.top    << 16) - 1, 0);
+  r.right  = min_c(Settings->ToPixel  ((int32)Ink[PageNo - 1].Bounds.right  << 16) + 1, (int32)PageWidth  - 1);
+  r.bottom = min_c(Settings->ToPixel  ((int32)Ink[PageNo - 1].Bounds.bottom << 16) + 1, (int32)PageHeight - 1);
+
+  return r;
+}
+
+// arguments of a thread drawing a band of a page
+
+struct PageBand
+{
+  const PageLayout   *Layout;
+  const DrawSettings *Settings;
+  PageBuffer         *Buffer;      // rows of the page buffer belonging to the band
+  int32              Top;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::DrawBanded(PageBuffer *pb, DrawSettings *Settings, uint PageNo, int NumThreads = 0)                  //
+//                                                                                                                //
+// Draws a DVI-Document into a page buffer using several threads. The page is divided into horizontal bands and   //
+// each thread draws the characters and rules of its cached layout which intersect its band. The glyphs are       //
+// unpacked and shrunk beforehand, so the threads don't modify any shared data. \special commands are executed    //
+// afterwards by the calling thread. Searching needs the interpreter and falls back to `Draw'. Supersampled pages //
+// are drawn by `DrawSupersampled', which draws the unshrunken page in bands.                                     //
+//                                                                                                                //
+// PageBuffer   *pb                     buffer the page is drawn into                                             //
+// DrawSettings *Settings               settings used to draw the page                                            //
+// uint         PageNo                  page to be displayed                                                      //
+// int          NumThreads              number of threads or 0 to use one per CPU                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::DrawBanded(PageBuffer *pb, DrawSettings *Settings, uint PageNo, int NumThreads)
+{
+  PageBand     Bands[MaxBands];
+  thread_id    Threads[MaxBands];
+  int          NumBands = 0;
+  int32        BandHeight;
+  int32        Top;
+  status_t     res;
+  PageLayout   *l;
+  int          i;
+
+  if (NumThreads <= 0)
+  {
+    system_info info;
+
+    get_system_info(&info);
+    NumThreads = info.cpu_count;
+  }
+  if (NumThreads > MaxBands)
+    NumThreads = MaxBands;
+
+  if (Settings->Supersample && Settings->SearchString == NULL && Settings->Shrink > DrawSettings::ShrinkOne)
+  {
+    DrawSupersampled(pb, Settings, PageNo, NumThreads);
+    return;
+  }
+
+  if (NumThreads <= 1 || Settings->SearchString != NULL || (l = Layout(Settings, PageNo)) == NULL)
+  {
+    Draw(pb, Settings, PageNo);
+    return;
+  }
+
+  MemoryTarget rt(pb);
+  DrawPage     dp(*Settings);
+
+  try
+  {
+    SetPageSize(Settings);
+
+    // unpack and shrink all glyphs of the page
+
+    dp.rt       = &rt;
+    dp.Document = this;
+    dp.Mode     = DrawPage::PrepareGlyphs;
+
+    dp.DrawLayout(l);
+
+    // the height of a band is a multiple of 8 so that dashed lines look the same in all bands
+
+    BandHeight = ((pb->Height + NumThreads - 1) / NumThreads + 7) & ~7;
+
+    for (Top = 0; Top < pb->Height; Top += BandHeight)
+    {
+      Bands[NumBands].Layout   = l;
+      Bands[NumBands].Settings = Settings;
+      Bands[NumBands].Top      = Top;
+      Bands[NumBands].Buffer   = new PageBuffer(pb->Bits + Top * pb->BytesPerRow, pb->Width,
+                                                min_c(BandHeight, pb->Height - Top), pb->BytesPerRow, pb->ColourSpace);
+      NumBands++;
+    }
+
+    for (i = 0; i < NumBands; i++)
+    {
+      if ((Threads[i] = spawn_thread(BandThread, "draw band", B_NORMAL_PRIORITY, &Bands[i])) < B_OK)
+        BandThread(&Bands[i]);
+      else
+        resume_thread(Threads[i]);
+    }
+    for (i = 0; i < NumBands; i++)
+      if (Threads[i] >= B_OK)
+        wait_for_thread(Threads[i], &res);
+
+    // specials may depend on their order, so they are executed by a single thread
+
+    if (l->HasSpecials)
+    {
+      dp.Mode = DrawPage::DrawSpecials;
+      Interpret(dp, PageNo);
+    }
+
+    DrawBorder(&rt, Settings);
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (DisplayError)
+      (*DisplayError)(e.what());
+  }
+
+  for (i = 0; i < NumBands; i++)
+    delete Bands[i].Buffer;
+
+  Settings->StringFound = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::DrawSupersampled(PageBuffer *pb, DrawSettings *Settings, uint PageNo, int NumThreads)                //
+//                                                                                                                //
+// Draws the page unshrunken, where rules and glyphs are exact, and shrinks the whole page into the buffer with   //
+// `PageBuffer::Downsample()'. This smoothes rules and overlapping glyphs correctly. The unshrunken page is kept, //
+// so drawing it again with another shrink factor only costs the downsampling. It is drawn again if the page, the //
+// resolution or the fonts change. If there isn't enough memory for it, the glyphs are shrunken as usual.         //
+//                                                                                                                //
+// PageBuffer   *pb                     buffer the page is drawn into                                             //
+// DrawSettings *Settings               settings used to draw the page                                            //
+// uint         PageNo                  page to be displayed                                                      //
+// int          NumThreads              number of threads drawing the unshrunken page (see `DrawBanded')          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::DrawSupersampled(PageBuffer *pb, DrawSettings *Settings, uint PageNo, int NumThreads)
+{
+  DrawSettings Full = *Settings;
+  MemoryTarget rt(pb);
+
+  Full.Shrink      = DrawSettings::ShrinkOne;
+  Full.BorderLine  = false;
+  Full.NativeFonts = false;
+  Full.Supersample = false;
+
+  if (acquire_sem(FullPageLock) < B_OK)
+  {
+    Draw(&rt, Settings, PageNo);
+    return;
+  }
+
+  try
+  {
+    if (FullPage != NULL && (FullPage->Width  != (int32)UnshrunkPageWidth  + 2 ||
+                             FullPage->Height != (int32)UnshrunkPageHeight + 2))
+    {
+      delete FullPage;
+      FullPage = NULL;
+    }
+
+    if (FullPage == NULL)
+    {
+      FullPage   = new PageBuffer(UnshrunkPageWidth + 2, UnshrunkPageHeight + 2);
+      FullPageNo = 0;
+
+      if (!FullPage->Ok())
+      {
+        delete FullPage;
+        FullPage = NULL;
+
+        release_sem(FullPageLock);
+
+        Draw(&rt, Settings, PageNo);
+        return;
+      }
+    }
+
+    Settings->Incomplete = false;
+
+    if (FullPageNo != PageNo || FullPageDPI != Full.DspInfo.PixelsPerInch || FullOutlines != Full.OutlineFonts)
+    {
+      if (NumThreads == 1)
+        Draw(FullPage, &Full, PageNo);
+      else
+        DrawBanded(FullPage, &Full, PageNo, NumThreads);
+
+      // pages with placeholders have to be drawn again
+
+      FullPageNo           = (Full.Incomplete || Full.Cancelled()) ? 0 : PageNo;
+      FullPageDPI          = Full.DspInfo.PixelsPerInch;
+      FullOutlines         = Full.OutlineFonts;
+      Settings->Incomplete = Full.Incomplete;
+    }
+
+    SetPageSize(Settings);
+
+    pb->Downsample(FullPage, Settings->Shrink, Settings->AntiAliasing);
+
+    DrawBorder(&rt, Settings);
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    if (DisplayError)
+      (*DisplayError)(e.what());
+  }
+
+  release_sem(FullPageLock);
+
+  Settings->StringFound = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVI::BandThread(void *arg)                                                                               //
+//                                                                                                                //
+// Draws one band of a page. The glyphs must have been prepared by `DrawBanded'.                                  //
+//                                                                                                                //
+// void *arg                            pointer to a `PageBand' structure                                         //
+//                                                                                                                //
+// Result:                              `B_OK' if successful, otherwise `B_ERROR'                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVI::BandThread(void *arg)
+{
+  PageBand *b = (PageBand *)arg;
+
+  if (!b->Buffer->Ok())
+  {
+    log_warn("not enough memory!");
+    return B_ERROR;
+  }
+
+  try
+  {
+    DrawPage     dp(*b->Settings);
+    MemoryTarget rt(b->Buffer, 0, b->Top);
+
+    rt.Begin(b->Settings->AntiAliasing && b->Settings->Shrink > DrawSettings::ShrinkOne);
+
+    dp.rt   = &rt;
+    dp.Mode = DrawPage::DrawPrepared;
+    dp.Clip = rt.Bounds();
+
+    dp.DrawLayout(b->Layout);
+
+    rt.End();
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+    return B_ERROR;
+  }
+  catch(...)
+  {
+    log_warn("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+    return B_ERROR;
+  }
+  return B_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// uint DVI::CountPages()                                                                                         //
+//                                                                                                                //
+// Waits until the number of pages is exact. If the file is long enough to contain more than the 16 bits of the   //
+// count stored in the postamble, the pages are counted in the background after loading. Since this may take a    //
+// while for such a file, no lock on the document should be held.                                                 //
+//                                                                                                                //
+// Result:                              number of pages; the one in the postamble if they couldn't be counted     //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint DVI::CountPages()
+{
+  status_t res;
+
+  if (!CountKnown && Counter >= B_OK)
+    wait_for_thread(Counter, &res);
+
+  return NumPages;
+}
+
+// roman numerals as printed by TeX's \romannumeral
+
+static const struct
+{
+  int32      Value;
+  const char *Digits;
+}
+RomanDigits[] =
+{
+  {1000, "m"}, {900, "cm"}, {500, "d"}, {400, "cd"}, {100, "c"}, {90, "xc"}, {50, "l"}, {40, "xl"},
+  {10,   "x"}, {9,   "ix"}, {5,   "v"}, {4,   "iv"}, {1,   "i"}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static string RomanNumeral(int32 n)                                                                            //
+//                                                                                                                //
+// Converts a number into lower case roman numerals.                                                              //
+//                                                                                                                //
+// int32 n                              positive number                                                           //
+//                                                                                                                //
+// Result:                              roman numeral                                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static string RomanNumeral(int32 n)
+{
+  string str;
+  uint   i;
+
+  for (i = 0; i < sizeof(RomanDigits) / sizeof(RomanDigits[0]); i++)
+    while (n >= RomanDigits[i].Value)
+    {
+      str += RomanDigits[i].Digits;
+      n   -= RomanDigits[i].Value;
+    }
+
+  return str;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static int32 RomanValue(const char *str)                                                                       //
+//                                                                                                                //
+// Reads a roman numeral. Upper and lower case letters are accepted, but only numerals in the form TeX prints     //
+// them.                                                                                                          //
+//                                                                                                                //
+// const char *str                      roman numeral                                                             //
+//                                                                                                                //
+// Result:                              its value or 0 if `str' isn't a roman numeral                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int32 RomanValue(const char *str)
+{
+  string s;
+  int32  Value = 0;
+  uint   i, Pos;
+
+  for (; *str; str++)
+    s += tolower(*str);
+
+  for (i = 0, Pos = 0; i < sizeof(RomanDigits) / sizeof(RomanDigits[0]) && Value < 1000000; i++)
+    while (s.compare(Pos, strlen(RomanDigits[i].Digits), RomanDigits[i].Digits) == 0)
+    {
+      Value += RomanDigits[i].Value;
+      Pos   += strlen(RomanDigits[i].Digits);
+    }
+
+  if (Value == 0 || Pos != s.length() || RomanNumeral(Value) != s)
+    return 0;
+
+  return Value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// string DVI::PageLabel(uint PageNo)                                                                             //
+//                                                                                                                //
+// Returns the number TeX printed on a page, i.e. its \count0. Negative values are shown as roman numerals like   //
+// plain TeX does. Only labels which have already been read are returned, so the file isn't read and the call     //
+// doesn't wait while the page offsets are being resolved.                                                        //
+//                                                                                                                //
+// uint PageNo                          page number                                                               //
+//                                                                                                                //
+// Result:                              label of the page or an empty string if it isn't known yet                //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+string DVI::PageLabel(uint PageNo)
+{
+  char  str[16];
+  int32 Label = NoLabel;
+
+  atomic_and(&LabelsPosted, 0);
+
+  if (acquire_sem_etc(OffsetLock, 1, B_RELATIVE_TIMEOUT, 0) < B_OK)
+  {
+    atomic_or(&LabelsChanged, 1);             // asked again when the lock is released
+    return string();
+  }
+
+  if (Count0 != NULL && PageNo >= 1 && PageNo <= NumPages)
+    Label = Count0[PageNo - 1];
+
+  release_sem(OffsetLock);
+
+  if (Label == NoLabel)
+    return string();
+
+  if (Label < 0)
+    return RomanNumeral(-Label);
+
+  sprintf(str, "%ld", (long)Label);
+
+  return str;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static uint NextPageWithLabel(const DVI::LabelMap &Pages, int32 Label, uint From)                              //
+//                                                                                                                //
+// Looks up the first page with a label after `From', or the first one at all if there is none after it.          //
+//                                                                                                                //
+// const DVI::LabelMap &Pages           pages of each label                                                       //
+// int32               Label            \count0 of the page                                                       //
+// uint                From             page the search starts after                                              //
+//                                                                                                                //
+// Result:                              page number or 0 if no page has this label                                //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint NextPageWithLabel(const DVI::LabelMap &Pages, int32 Label, uint From)
+{
+  DVI::LabelMap::const_iterator i;
+  DVI::PageList::const_iterator p;
+
+  if ((i = Pages.find(Label)) == Pages.end() || i->second.empty())
+    return 0;
+
+  p = upper_bound(i->second.begin(), i->second.end(), From);
+
+  return p != i->second.end() ? *p : i->second.front();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// uint DVI::FindLabel(const char *Label, uint From)                                                              //
+//                                                                                                                //
+// Looks up the page a number was printed on. A decimal number is compared with the \count0 of the pages, a roman //
+// numeral with its negative like plain TeX uses it and, if no page matches, with its value because LaTeX counts  //
+// the front matter upwards as well. If the numbering restarts, several pages may match; then the first one after //
+// `From' is taken, so that repeated lookups visit all of them. Only the labels read so far are searched; they    //
+// are collected in the background after loading.                                                                 //
+//                                                                                                                //
+// const char *Label                    printed page number                                                       //
+// uint       From                      page the search starts after                                              //
+//                                                                                                                //
+// Result:                              page number or 0 if no page has this label                                //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint DVI::FindLabel(const char *Label, uint From)
+{
+  char  *End;
+  int32 Value;
+  bool  Roman;
+  uint  Found;
+
+  Value = strtol(Label, &End, 10);
+  Roman = (End == Label || *End != '\0');
+
+  if (Roman && (Value = RomanValue(Label)) == 0)
+    return 0;
+
+  if (acquire_sem(OffsetLock) < B_OK)
+    return 0;
+
+  Found = NextPageWithLabel(LabelPages, Roman ? -Value : Value, From);
+
+  if (Roman && !Found)
+    Found = NextPageWithLabel(LabelPages, Value, From);
+
+  release_sem(OffsetLock);
+  PostLabels();
+
+  return Found;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::SetLabelTarget(const BMessenger &Target)                                                             //
+//                                                                                                                //
+// Sets the handler which is sent `MsgLabelsRead' whenever labels of pages have been read in the background, so   //
+// it can update the displayed page number with `PageLabel'.                                                      //
+//                                                                                                                //
+// const BMessenger &Target             the handler                                                               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::SetLabelTarget(const BMessenger &Target)
+{
+  if (acquire_sem(OffsetLock) < B_OK)
+    return;
+
+  LabelTarget = Target;
+
+  release_sem(OffsetLock);
+  PostLabels();
+}
+
+// state shared by the threads searching a document
+
+struct SearchRange
+{
+  DVI                *Document;
+  const DrawSettings *Settings;    // `SearchString' is set
+  uint               First;        // page the search starts with
+  int                Direction;    // 1: forwards; -1: backwards
+  int32              Count;        // number of pages to be searched
+  int32              Next;         // index of the next page to be searched
+  int32              Hit;          // lowest index of a page containing the string so far
+  sem_id             Lock;         // protects `Hit'
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// uint DVI::Find(const DrawSettings *Settings, const char *str, uint First, uint Last, int NumThreads = 0)       //
+//                                                                                                                //
+// Searches the pages from `First' to `Last' for a string. If `Last' is lower than `First' the document is        //
+// searched backwards. The pages are only scanned for characters, nothing is drawn, so several threads can scan   //
+// different pages at once. Each thread takes the next page in search order; pages after a page containing the    //
+// string are skipped.                                                                                            //
+//                                                                                                                //
+// const DrawSettings *Settings         settings used to draw the document                                        //
+// const char         *str              string to look for                                                        //
+// uint               First, Last       range of pages                                                            //
+// int                NumThreads        number of threads or 0 to use one per CPU                                 //
+//                                                                                                                //
+// Result:                              first page in search order containing the string or 0 if none does        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint DVI::Find(const DrawSettings *Settings, const char *str, uint First, uint Last, int NumThreads)
+{
+  DrawSettings set = *Settings;
+  SearchRange  s;
+  thread_id    Threads[MaxSearchThreads];
+  status_t     res;
+  int          i;
+
+  if (str == NULL || *str == '\0' || First < 1 || First > NumPages || Last < 1 || Last > NumPages)
+    return 0;
+
+  if (NumThreads <= 0)
+  {
+    system_info info;
+
+    get_system_info(&info);
+    NumThreads = info.cpu_count;
+  }
+  if (NumThreads > MaxSearchThreads)
+    NumThreads = MaxSearchThreads;
+
+  set.SearchString = str;
+
+  s.Document  = this;
+  s.Settings  = &set;
+  s.First     = First;
+  s.Direction = (Last >= First ? 1 : -1);
+  s.Count     = (Last >= First ? Last - First : First - Last) + 1;
+  s.Next      = 0;
+  s.Hit       = s.Count;
+
+  if ((s.Lock = create_sem(1, "search")) < B_OK)
+    return 0;
+
+  if (NumThreads > s.Count)
+    NumThreads = s.Count;
+
+  for (i = 1; i < NumThreads; i++)
+    if ((Threads[i] = spawn_thread(SearchThread, "search document", B_NORMAL_PRIORITY, &s)) >= B_OK)
+      resume_thread(Threads[i]);
+
+  SearchThread(&s);
+
+  for (i = 1; i < NumThreads; i++)
+    if (Threads[i] >= B_OK)
+      wait_for_thread(Threads[i], &res);
+
+  delete_sem(s.Lock);
+
+  if (s.Hit >= s.Count)
+    return 0;
+
+  return First + s.Direction * s.Hit;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 DVI::SearchThread(void *arg)                                                                             //
+//                                                                                                                //
+// Scans pages for the search string until all pages before the first hit have been scanned.                      //
+//                                                                                                                //
+// void *arg                            pointer to a `SearchRange' structure                                      //
+//                                                                                                                //
+// Result:                              `B_OK'                                                                    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 DVI::SearchThread(void *arg)
+{
+  SearchRange *s = (SearchRange *)arg;
+  int32       k;
+
+  while ((k = atomic_add(&s->Next, 1)) < s->Count && k < s->Hit && !s->Settings->Cancelled())
+    if (s->Document->ScanPage(s->Settings, s->First + s->Direction * k))
+    {
+      acquire_sem(s->Lock);
+
+      if (k < s->Hit)
+        s->Hit = k;
+
+      release_sem(s->Lock);
+    }
+
+  return B_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool DVI::ScanPage(const DrawSettings *Settings, uint PageNo)                                                  //
+//                                                                                                                //
+// Checks whether a page contains the search string. Glyphs are neither unpacked nor drawn and \special commands  //
+// are skipped.                                                                                                   //
+//                                                                                                                //
+// const DrawSettings *Settings         settings containing the search string                                     //
+// uint               PageNo            page number                                                               //
+//                                                                                                                //
+// Result:                              `true' if the string was found, otherwise `false'                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DVI::ScanPage(const DrawSettings *Settings, uint PageNo)
+{
+  try
+  {
+    DrawPage dp(*Settings);
+
+    dp.Mode = DrawPage::ScanText;
+
+    Interpret(dp, PageNo);
+
+    return dp.StringFound();
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_warn("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::ShrinkFactorChanged(const DrawSettings *Settings)                                                    //
+//                                                                                                                //
+// Adapts the document to a new shrink factor. The fonts, the unshrunken glyphs and the page layouts don't depend //
+// on it, so only the shrunken glyphs and the size of the page have to be recomputed.                             //
+//                                                                                                                //
+// const DrawSettings *Settings         settings containing the new shrink factor                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::ShrinkFactorChanged(const DrawSettings *Settings)
+{
+  Fonts.FlushShrinkedGlyphes();
+
+  SetPageSize(Settings);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::SetPageSize(const DrawSettings *Settings)                                                            //
+//                                                                                                                //
+// Calculates the size of the shrunken page.                                                                      //
+//                                                                                                                //
+// const DrawSettings *Settings         settings used to draw the page                                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::SetPageSize(const DrawSettings *Settings)
+{
+  PageWidth  = Settings->ToPixel(UnshrunkPageWidth  << 16) + 2;
+  PageHeight = Settings->ToPixel(UnshrunkPageHeight << 16) + 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::DrawBorder(RenderTarget *rt, const DrawSettings *Settings)                                           //
+//                                                                                                                //
+// Draws the lines indicating the border of the page if they are enabled.                                         //
+//                                                                                                                //
+// RenderTarget       *rt               device the document is displayed on                                       //
+// const DrawSettings *Settings         settings used to draw the page                                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::DrawBorder(RenderTarget *rt, const DrawSettings *Settings)
+{
+  BRect r;
+  long  Inch;
+
+  if (!Settings->BorderLine)
+    return;
+
+  Inch = Settings->PixelConv(Settings->DspInfo.PixelsPerInch << 16);
+
+  r.Set(Inch, Inch, PageWidth - Inch, PageHeight - Inch);
+
+  rt->StrokeDashed(BPoint(r.left,  0.0),      BPoint(r.left,        PageHeight - 1));
+  rt->StrokeDashed(BPoint(r.right, 0.0),      BPoint(r.right,       PageHeight - 1));
+  rt->StrokeDashed(BPoint(0.0,     r.top),    BPoint(PageWidth - 1, r.top));
+  rt->StrokeDashed(BPoint(0.0,     r.bottom), BPoint(PageWidth - 1, r.bottom));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageLayout *DVI::Layout(const DrawSettings *Settings, uint PageNo)                                             //
+//                                                                                                                //
+// Returns the layout of a page. It is computed the first time a page is requested and kept until the document    //
+// is reloaded or the page is the least recently used one of more than `MaxLayouts' pages.                        //
+//                                                                                                                //
+// const DrawSettings *Settings         settings used to draw the page                                            //
+// uint               PageNo            page number                                                               //
+//                                                                                                                //
+// Result:                              layout of the page or `NULL' if an error occured                          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageLayout *DVI::Layout(const DrawSettings *Settings, uint PageNo)
+{
+  PageLayout            *l;
+  deque<uint>::iterator i;
+
+  if (Layouts == NULL || PageNo < 1 || PageNo > NumPages || !GrowLayouts(PageNo))
+    return NULL;
+
+  if (Layouts[PageNo - 1])
+  {
+    for (i = LayoutQueue.begin(); i != LayoutQueue.end(); i++)
+      if (*i == PageNo)
+      {
+        LayoutQueue.erase(i);
+        break;
+      }
+    LayoutQueue.push_back(PageNo);
+
+    return Layouts[PageNo - 1];
+  }
+
+  if ((l = ReadLayout(Settings, PageNo)) == NULL)
+    return NULL;
+
+  // the extent of figures isn't known
+
+  Ink[PageNo - 1].Bounds = l->HasSpecials ? BRect(0, 0, UnshrunkPageWidth - 1, UnshrunkPageHeight - 1) : l->Bounds;
+  Ink[PageNo - 1].Known  = true;
+
+  if (LayoutQueue.size() >= MaxLayouts)
+  {
+    delete Layouts[LayoutQueue.front() - 1];
+
+    Layouts[LayoutQueue.front() - 1] = NULL;
+    LayoutQueue.pop_front();
+  }
+  LayoutQueue.push_back(PageNo);
+
+  return Layouts[PageNo - 1] = l;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageLayout *DVI::ReadLayout(const DrawSettings *Settings, uint PageNo)                                         //
+//                                                                                                                //
+// Interprets a page and returns its layout without caching it. The page is always read completely, even if       //
+// `Settings' refers to a cancel flag, so the result may be kept.                                                 //
+//                                                                                                                //
+// const DrawSettings *Settings         settings used to draw the page                                            //
+// uint               PageNo            page number                                                               //
+//                                                                                                                //
+// Result:                              layout of the page or `NULL' if an error occured; the caller has to       //
+//                                      delete it                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageLayout *DVI::ReadLayout(const DrawSettings *Settings, uint PageNo)
+{
+  DrawSettings set = *Settings;
+
+  if (PageNo < 1 || PageNo > NumPages)
+    return NULL;
+
+  set.SearchString = NULL;
+  set.Cancel       = NULL;
+
+  DrawPage dp(set);
+
+  try
+  {
+    dp.Mode   = DrawPage::ScanLayout;
+    dp.Layout = new PageLayout;
+
+    Interpret(dp, PageNo);
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    delete dp.Layout;
+    return NULL;
+  }
+  catch(...)
+  {
+    log_warn("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    delete dp.Layout;
+    return NULL;
+  }
+
+  return dp.Layout;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void DVI::FlushLayouts()                                                                                       //
+//                                                                                                                //
+// Frees all cached page layouts.                                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DVI::FlushLayouts()
+{
+  while (!LayoutQueue.empty())
+  {
+    delete Layouts[LayoutQueue.front() - 1];
+
+    Layouts[LayoutQueue.front() - 1] = NULL;
+    LayoutQueue.pop_front();
+  }
 }
@@ -14,8 +14,11 @@
 #define DVI_H
 
 #include <StorageKit.h>
+#include <Messenger.h>
 #include <deque>
+#include <map>
 #include <stack>
+#include <vector.h>
 #if defined (__MWERKS__)
 #include <string>
 #endif
@@ -28,9 +31,14 @@
 #endif
 
 class BPositionIO;
+class BRect;
 class BView;
 class DrawPage;
 class DVIView;
+class PageBuffer;
+class PageLayout;
+class RenderTarget;
+struct PageInk;
 class Font;
 
 // resolution information
@@ -64,41 +72,87 @@ class DisplayInfo
 class DrawSettings
 {
   public:
+    enum
+    {
+      ShrinkOne = 0x10000            // `Shrink' of the unshrunken document
+    };
+
     DisplayInfo DspInfo;
-    ushort      ShrinkFactor;
+    int32       Shrink;          // shrink factor as 16.16 fixed point number, so it needn't be an integer
     bool        AntiAliasing;
     bool        BorderLine;
     bool        StringFound;
     const char  *SearchString;
+    const bool  *Cancel;          // drawing stops as soon as `*Cancel' becomes `true'
+    bool        Preview;         // draw placeholders for glyphs which aren't unpacked yet and for figures
+    bool        Incomplete;      // returns whether placeholders have been drawn
+    bool        NativeFonts;     // take the glyphs from fonts loaded near the displayed resolution
+    bool        MetricsOnly;     // load the TFM files instead of the fonts; enough to scan the pages
+    bool        OutlineFonts;    // rasterize the fonts listed in `psfonts.map' instead of loading PK files
+    bool        Supersample;     // draw page buffers unshrunken and shrink the whole page afterwards
 
     DrawSettings():
-      ShrinkFactor(3),
+      Shrink(3 * ShrinkOne),
       AntiAliasing(true),
       BorderLine(false),
       StringFound(false),
-      SearchString(NULL)
+      SearchString(NULL),
+      Cancel(NULL),
+      Preview(false),
+      Incomplete(false),
+      NativeFonts(false),
+      MetricsOnly(false),
+      OutlineFonts(false),
+      Supersample(false)
     {}
 
     DrawSettings &operator = (const DrawSettings &ds)
     {
       DspInfo          = ds.DspInfo;
-      ShrinkFactor     = ds.ShrinkFactor;
+      Shrink           = ds.Shrink;
       AntiAliasing     = ds.AntiAliasing;
       BorderLine       = ds.BorderLine;
       StringFound      = ds.StringFound;
       SearchString     = ds.SearchString;
+      Cancel           = ds.Cancel;
+      Preview          = ds.Preview;
+      Incomplete       = ds.Incomplete;
+      NativeFonts      = ds.NativeFonts;
+      MetricsOnly      = ds.MetricsOnly;
+      OutlineFonts     = ds.OutlineFonts;
+      Supersample      = ds.Supersample;
 
       return *this;
     }
 
-    long ToPixel(long x)
+    bool Cancelled() const
+    {
+      return Cancel != NULL && *(volatile const bool *)Cancel;
+    }
+
+    // factor the glyphs of fonts loaded near the displayed resolution are shrunk by; a small supersampling
+    // is left for anti aliasing
+
+    int NativeSample() const
+    {
+      return AntiAliasing ? 2 : 1;
+    }
+
+    float ShrinkFactor() const
+    {
+      return (float)Shrink / ShrinkOne;
+    }
+
+    // `x' is given in unshrunken pixels << 16
+
+    long ToPixel(long x) const
     {
-      return (x + (ShrinkFactor << 16) - 1) / (ShrinkFactor << 16);
+      return (x + Shrink - 1) / Shrink;
     }
 
-    long PixelConv(long x)
+    long PixelConv(long x) const
     {
-      return (x / ShrinkFactor) >> 16;
+      return (x >= 0 ? x : x - Shrink + 1) / Shrink;
     }
 };
 
@@ -170,18 +224,51 @@ class DVI
       Trailer   = 223
     };
 
+    enum
+    {
+      MaxLayouts       = 32,   // number of page layouts kept in memory
+      MaxBands         = 16,   // maximal number of threads drawing a page
+      MaxSearchThreads = 16,   // maximal number of threads searching the document
+      MinPageSize      = 46,   // bytes of a page containing nothing but `BeginOP' and `EndOP'
+      PageSkipCost     = 8     // reading a page compared to following the pointer to the previous one
+    };
+
+    typedef vector<uint, allocator<uint> >     PageList;
+    typedef map<int32, PageList, less<int32> > LabelMap;
+
   private:
     BPositionIO *DVIFile;
     char        *Name;
     int         OffsetX;
     int         OffsetY;
-    uint        NumPages;
-    ulong       *PageOffset;
+    uint        NumPages;      // changes when the pages are counted if `CountKnown' is false
+    ulong       *PageOffset;   // `NumPages + 1' entries, the last one for the postamble; 0 while not yet known
+    ulong       PostambleOffset;
+    bool        CountKnown;    // `NumPages' isn't just the lower 16 bits of the number stored in the postamble
+    int32       *Count0;       // \count0 of the pages as stored in their `BeginOP'; `NoLabel' while not yet read
+    LabelMap    LabelPages;    // pages with each \count0 read so far, in ascending order
+    BMessenger  LabelTarget;   // is sent `MsgLabelsRead' when labels have been read
+    int32       LabelsChanged; // labels have been read since the last `MsgLabelsRead'
+    int32       LabelsPosted;  // a `MsgLabelsRead' hasn't been answered by `PageLabel' yet
+    sem_id      OffsetLock;    // protects `PageOffset', `Count0' and `NumPages' while offsets are resolved
+    thread_id   Counter;       // counts the pages in the background
+    bool        CancelCount;
+    bool        Renumbered;    // pages were numbered under a wrong number of pages; their layouts are dropped
     FontTable   Fonts;
+    PageLayout  **Layouts;     // cached layouts of the pages
+    deque<uint> LayoutQueue;   // pages whose layout is cached, least recently used first
+    PageBuffer  *FullPage;     // unshrunken page drawn for `DrawSettings::Supersample'
+    uint        FullPageNo;    // number of the page in `FullPage' or 0 if it has to be drawn again
+    uint        FullPageDPI;   // resolution `FullPage' was drawn at
+    bool        FullOutlines;  // `FullPage' was drawn with `DrawSettings::OutlineFonts'
+    sem_id      FullPageLock;  // protects `FullPage' from threads drawing pages at the same time
+    PageInk     *Ink;          // bounding boxes of the pages, kept when their layouts are dropped
+    uint        NumLayouts;    // entries of `Layouts' and `Ink', which follow `NumPages' when it grows
 
   public:
     void         (*DisplayError)(const char *str);
     string       Directory;
+    string       Path;         // full name of the DVI file
     double       TPicConvert;
     double       DimConvert;
     long         Magnification;
@@ -195,14 +282,50 @@ class DVI
     ~DVI();
 
     bool Reload(DrawSettings *Settings);
-    void Draw(BView *vw, DrawSettings *Settings, uint PageNo);
+    void ShrinkFactorChanged(const DrawSettings *Settings);
+    void Draw(RenderTarget *rt, DrawSettings *Settings, uint PageNo, const BRect *Clip = NULL);
+    void Draw(BView *vw, DrawSettings *Settings, uint PageNo, const BRect *Clip = NULL);
+    void Draw(PageBuffer *pb, DrawSettings *Settings, uint PageNo, const BRect *Clip = NULL);
+    void DrawBanded(PageBuffer *pb, DrawSettings *Settings, uint PageNo, int NumThreads = 0);
+    void DrawCropped(PageBuffer *pb, DrawSettings *Settings, uint PageNo, const BRect &Crop);
+    BRect ContentBounds(const DrawSettings *Settings, uint PageNo);
+    PageLayout *Layout(const DrawSettings *Settings, uint PageNo);
+    PageLayout *ReadLayout(const DrawSettings *Settings, uint PageNo);
+    uint Find(const DrawSettings *Settings, const char *str, uint First, uint Last, int NumThreads = 0);
+    uint CountPages();
+    string PageLabel(uint PageNo);
+    uint FindLabel(const char *Label, uint From);
+    void SetLabelTarget(const BMessenger &Target);
     int  MagStepValue(int PixelsPerInch, float &mag) const;
 
+    uint NumberOfPages() const
+    {
+      return NumPages;
+    }
+
     bool Ok() const
     {
-      return Fonts.Ok() && DVIFile != NULL && PageOffset != NULL;
+      return Fonts.Ok() && DVIFile != NULL && PageOffset != NULL && OffsetLock >= B_OK;
     }
 
+  private:
+    void Interpret(DrawPage &dp, uint PageNo);
+    ulong PageStart(uint PageNo);
+    void GrowPages(uint Count);
+    void SetLabel(uint Index, int32 Label);
+    void PostLabels();
+    bool GrowLayouts(uint PageNo);
+    void StopCounter();
+    void FlushLayouts();
+    void SetPageSize(const DrawSettings *Settings);
+    void DrawBorder(RenderTarget *rt, const DrawSettings *Settings);
+    void DrawSupersampled(PageBuffer *pb, DrawSettings *Settings, uint PageNo, int NumThreads);
+    bool ScanPage(const DrawSettings *Settings, uint PageNo);
+
+    static int32 BandThread(void *arg);
+    static int32 SearchThread(void *arg);
+    static int32 CountThread(void *arg);
+
   friend class DVIView;
   friend class DrawPage;
 };
@@ -0,0 +1,298 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <StorageKit.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "defines.h"
+
+extern "C"
+{
+  #define string _string
+  #include "kpathsea/c-auto.h"
+  #include "kpathsea/progname.h"
+  #include "kpathsea/proginit.h"
+  #include "kpathsea/tex-file.h"
+  #undef string
+}
+
+#include "BeDVI.h"
+#include "DVI.h"
+#include "PageBuffer.h"
+#include "Support.h"
+#include "TeXFont.h"
+#include "log.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void Usage()                                                                                            //
+//                                                                                                                //
+// prints a short help text.                                                                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Usage()
+{
+  fprintf(stderr, "usage: DVIBench [-d<dpi>] [-m<mode>] [-s<shrink>] [-n] [-e] [-t] [-o] [-p] [-k] [-r<repeat>] [-c] [-j<threads>] [-f<text>] [-v<log-level>] file\n"
+                  "  -d  resolution (default 600)\n"
+                  "  -m  METAFONT mode (default ljfour)\n"
+                  "  -s  shrink factor, may be fractional (default 6)\n"
+                  "  -n  no anti aliasing\n"
+                  "  -e  load the fonts near the effective resolution\n"
+                  "  -t  load only the metrics of the fonts\n"
+                  "  -o  rasterize the Type 1 fonts listed in psfonts.map\n"
+                  "  -p  draw the pages unshrunken and shrink them as a whole\n"
+                  "  -k  crop the pages to their content\n"
+                  "  -r  number of times each page is drawn (default 3)\n"
+                  "  -c  use a 32 bit buffer instead of a greyscale one\n"
+                  "  -j  number of threads drawing a page, 0 for one per CPU (default 1)\n"
+                  "  -f  search the document for a text instead of drawing it\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void RenderPage(DVI *Document, PageBuffer *pb, DrawSettings *Settings, uint PageNo, int Threads,        //
+//                        bool Crop)                                                                              //
+//                                                                                                                //
+// draws a page with one or several threads. A cropped page is drawn into the beginning of the memory of `pb'.    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void RenderPage(DVI *Document, PageBuffer *pb, DrawSettings *Settings, uint PageNo, int Threads, bool Crop)
+{
+  if (Crop)
+  {
+    BRect r = Document->ContentBounds(Settings, PageNo);
+
+    if (r.IsValid())
+    {
+      int32      w = r.IntegerWidth()  + 1;
+      PageBuffer Part(pb->Bits, w, r.IntegerHeight() + 1, pb->ColourSpace == PageBuffer::RGB32 ? 4 * w : (w + 3) & ~3,
+                      pb->ColourSpace);
+
+      Document->DrawCropped(&Part, Settings, PageNo, r);
+    }
+    return;
+  }
+
+  if (Threads == 1)
+    Document->Draw(pb, Settings, PageNo);
+  else
+    Document->DrawBanded(pb, Settings, PageNo, Threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int main(int argc, char **argv)                                                                                //
+//                                                                                                                //
+// renders all pages of a document into a page buffer without using the app_server and prints the time needed.    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  DrawSettings       Settings;
+  DVI                *Document = NULL;
+  PageBuffer         *pb       = NULL;
+  PageBuffer::Format Format    = PageBuffer::Grey8;
+  const char         *Mode     = "ljfour";
+  const char         *FileName = NULL;
+  const char         *Text     = NULL;
+  int                dpi       = 600;
+  int                Repeat    = 3;
+  int                Threads   = 1;
+  int                LogLevel  = LogLevel_Error;
+  bool               Crop      = false;
+  double             Area;
+  bigtime_t          Start;
+  bigtime_t          First;
+  bigtime_t          Total;
+  uint               i;
+  int                j;
+
+  Settings.Shrink = 6 * DrawSettings::ShrinkOne;
+
+  for (j = 1; j < argc; j++)
+  {
+    if (argv[j][0] != '-')
+    {
+      FileName = argv[j];
+      continue;
+    }
+    switch (argv[j][1])
+    {
+      case 'd': dpi                   = atoi(&argv[j][2]);  break;
+      case 'm': Mode                  = &argv[j][2];        break;
+      case 's': Settings.Shrink       = (int32)(atof(&argv[j][2]) * DrawSettings::ShrinkOne + 0.5); break;
+      case 'n': Settings.AntiAliasing = false;              break;
+      case 'e': Settings.NativeFonts  = true;               break;
+      case 't': Settings.MetricsOnly  = true;               break;
+      case 'o': Settings.OutlineFonts = true;               break;
+      case 'p': Settings.Supersample  = true;               break;
+      case 'k': Crop                  = true;               break;
+      case 'r': Repeat                = atoi(&argv[j][2]);  break;
+      case 'c': Format                = PageBuffer::RGB32;  break;
+      case 'j': Threads               = atoi(&argv[j][2]);  break;
+      case 'f': Text                  = &argv[j][2];        break;
+      case 'v': LogLevel              = atoi(&argv[j][2]);  break;
+      default:
+        Usage();
+        exit(1);
+    }
+  }
+
+  if (FileName == NULL || dpi <= 0 || Repeat <= 0 || Threads < 0 || Settings.Shrink < DrawSettings::ShrinkOne ||
+      Settings.Shrink >= Glyph::MaxShrinkFactor * DrawSettings::ShrinkOne)
+  {
+    Usage();
+    exit(1);
+  }
+
+  log_open("DVIBench", LogLevel);
+
+  PageBuffer::Headless = true;
+
+  try
+  {
+    if (!InitKpseSem())
+    {
+      log_fatal("Can't create semaphore!");
+      exit(1);
+    }
+
+    acquire_sem(kpse_sem);
+    kpse_set_program_name(argv[0], "BeDVI");
+    kpse_init_prog("BEDVI", dpi, Mode, "cmr10");
+    kpse_set_program_enabled(kpse_pk_format,        1, kpse_src_compile);
+    kpse_set_program_enabled(kpse_any_glyph_format, 1, kpse_src_compile);
+    release_sem(kpse_sem);
+
+    Settings.DspInfo.Mode          = Mode;
+    Settings.DspInfo.PixelsPerInch = dpi;
+
+    Start    = system_time();
+    Document = new DVI(new BFile(FileName, B_READ_ONLY), &Settings);
+
+    if (!Document->Ok())
+    {
+      fprintf(stderr, "can't load `%s'\n", FileName);
+      delete Document;
+      FreeKpseSem();
+      exit(1);
+    }
+
+    printf("%s: %u pages, %ux%u pixels, loaded in %.1f ms\n", FileName, Document->NumberOfPages(),
+           Document->PageWidth, Document->PageHeight, (system_time() - Start) / 1000.0);
+
+    // `-j' gives the number of threads scanning the pages
+
+    if (Text)
+    {
+      Start = system_time();
+      i     = Document->Find(&Settings, Text, 1, Document->NumberOfPages(), Threads);
+      Total = system_time() - Start;
+
+      if (i)
+        printf("`%s' found on page %u in %.1f ms\n", Text, i, Total / 1000.0);
+      else
+        printf("`%s' not found, searched in %.1f ms\n", Text, Total / 1000.0);
+
+      delete Document;
+      FreeKpseSem();
+      return 0;
+    }
+
+    pb = new PageBuffer(Document->PageWidth, Document->PageHeight, Format);
+
+    if (!pb->Ok())
+    {
+      delete pb;
+      delete Document;
+      FreeKpseSem();
+      exit(1);
+    }
+
+    // first pass decodes and shrinks the glyphs, the others measure the compositor
+
+    Start = system_time();
+
+    for (i = 1; i <= Document->NumberOfPages(); i++)
+      RenderPage(Document, pb, &Settings, i, Threads, Crop);
+
+    First = system_time() - Start;
+
+    if (Crop)
+    {
+      BRect r;
+
+      for (i = 1, Area = 0.0; i <= Document->NumberOfPages(); i++)
+        if ((r = Document->ContentBounds(&Settings, i)).IsValid())
+          Area += (r.IntegerWidth() + 1.0) * (r.IntegerHeight() + 1.0);
+
+      printf("content:    %.0f%% of the page\n",
+             100.0 * Area / Document->NumberOfPages() / Document->PageWidth / Document->PageHeight);
+    }
+
+    Start = system_time();
+
+    for (j = 1; j < Repeat; j++)
+      for (i = 1; i <= Document->NumberOfPages(); i++)
+        RenderPage(Document, pb, &Settings, i, Threads, Crop);
+
+    Total = system_time() - Start;
+
+    printf("first pass: %.2f ms/page\n", First / 1000.0 / Document->NumberOfPages());
+
+    if (Repeat > 1)
+      printf("cached:     %.2f ms/page\n", Total / 1000.0 / Document->NumberOfPages() / (Repeat - 1));
+
+    // the document keeps the last unshrunken page, so drawing a page twice measures the downsampling alone
+
+    if (Settings.Supersample)
+    {
+      Total = 0;
+
+      for (i = 1; i <= Document->NumberOfPages(); i++)
+      {
+        RenderPage(Document, pb, &Settings, i, Threads, Crop);
+
+        Start = system_time();
+        RenderPage(Document, pb, &Settings, i, Threads, Crop);
+        Total += system_time() - Start;
+      }
+
+      printf("downsample: %.2f ms/page\n", Total / 1000.0 / Document->NumberOfPages());
+    }
+
+    delete pb;
+    delete Document;
+
+    FreeKpseSem();
+  }
+  catch(const exception &e)
+  {
+    log_fatal("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+    FreeKpseSem();
+    exit(1);
+  }
+  catch(...)
+  {
+    log_fatal("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+    FreeKpseSem();
+    exit(1);
+  }
+
+  exit(0);
+}
@@ -21,6 +21,8 @@
 #include <syslog.h>
 #include "BeDVI.h"
 #include "DVI.h"
+#include "PageBuffer.h"
+#include "PageLayout.h"
 
 extern "C"
 {
@@ -38,6 +40,7 @@ extern "C"
 #define kDPIExtension     "DVI/dpi"
 #define kShrinkExtension  "DVI/shrink"
 #define kAAExtension      "DVI/antialiasing"
+#define kCropExtension    "DVI/crop"
 
 class HandlerSettings
 {
@@ -48,6 +51,7 @@ class HandlerSettings
     int32  PageNo;
     int16  ShrinkFactor;
     bool   AntiAliasing;
+    bool   Crop;                 // output only the part of the page containing characters
 
     HandlerSettings();
     ~HandlerSettings();
@@ -78,7 +82,8 @@ HandlerSettings::HandlerSettings():
   PixelsPerInch(600),
   ShrinkFactor(6),
   PageNo(1),
-  AntiAliasing(true)
+  AntiAliasing(true),
+  Crop(false)
 {
   PREFHandle PrefHandle = NULL;
   PREFData   PrefData;
@@ -112,6 +117,8 @@ HandlerSettings::HandlerSettings():
           ShrinkFactor  = *(int16 *)p;
         if (PREFGetData(PrefData, "antialiasing", &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
           AntiAliasing  = *(bool *)p;
+        if (PREFGetData(PrefData, "crop",         &p, &Size, &Type) >= B_OK && Type == B_BOOL_TYPE)
+          Crop          = *(bool *)p;
 
         PREFDisposeSet(&PrefData);
       }
@@ -158,6 +165,7 @@ HandlerSettings::~HandlerSettings()
     PREFSetData(PrefData, "page",         &PageNo,        sizeof(int32),    B_INT32_TYPE);
     PREFSetData(PrefData, "shrink",       &ShrinkFactor,  sizeof(int16),    B_INT16_TYPE);
     PREFSetData(PrefData, "antialiasing", &AntiAliasing,  sizeof(bool),     B_BOOL_TYPE);
+    PREFSetData(PrefData, "crop",         &Crop,          sizeof(bool),     B_BOOL_TYPE);
 
     PREFSaveSet(PrefData);
     PREFDisposeSet(&PrefData);
@@ -165,10 +173,62 @@ HandlerSettings::~HandlerSettings()
   PREFShutdown(PrefHandle);
 }
 
-status_t Identify(BPositionIO *inSource, const translation_format * /* inFormat */, BMessage * /* ioExtension */,
+static bool InitKpathsea(const char *Mode, int32 PixelsPerInch)
+{
+  if (!InitKpseSem())
+    return false;
+
+  acquire_sem(kpse_sem);
+  kpse_set_program_name("/boot/home/config/add-ons/Translators/DVIHandler", NULL);
+  kpse_init_prog("BEDVI", PixelsPerInch, Mode, "cmr10");
+  kpse_set_program_enabled(kpse_pk_format,        1, kpse_src_compile);
+  kpse_set_program_enabled(kpse_any_glyph_format, 1, kpse_src_compile);
+  release_sem(kpse_sem);
+
+  return true;
+}
+
+// Reads the number of pages of a document from its postamble without loading it. The postamble stores only the
+// lower 16 bits of the number, which is good enough for the few documents that have more pages. The position of
+// `input' is left alone.
+
+static int32 CountPages(BPositionIO *input)
+{
+  uint8 Buffer[16];
+  uint8 *p;
+  off_t Pos, End, Post;
+
+  Pos = input->Position();
+  End = input->Seek(0, SEEK_END);
+  input->Seek(Pos, SEEK_SET);
+
+  if (End < (off_t)sizeof(Buffer) ||
+      input->ReadAt(End - sizeof(Buffer), Buffer, sizeof(Buffer)) != (ssize_t)sizeof(Buffer))
+    return 0;
+
+  // the file ends with `PostPost', the offset of the postamble, the id byte and at least four `Trailer' bytes
+
+  for (p = &Buffer[sizeof(Buffer) - 1]; p > Buffer && *p == DVI::Trailer; p--)
+    ;
+
+  if (&Buffer[sizeof(Buffer) - 1] - p < 4 || p - Buffer < 5 || *p != 2 || p[-5] != DVI::PostPost)
+    return 0;
+
+  Post = ((uint32)p[-4] << 24) | ((uint32)p[-3] << 16) | ((uint32)p[-2] << 8) | p[-1];
+
+  // `Postamble', the pointer to the last page, five dimensions, the stack depth and the number of pages
+
+  if (Post >= End || input->ReadAt(Post, Buffer, 29) != 29 || Buffer[0] != DVI::Postamble)
+    return 0;
+
+  return (Buffer[27] << 8) | Buffer[28];
+}
+
+status_t Identify(BPositionIO *inSource, const translation_format * /* inFormat */, BMessage *ioExtension,
                   translator_info *outInfo, uint32 outType)
 {
   uint32   GuessedType;
+  int32    NumPages;
   status_t err;
 
   if (outType != 0 && outType != B_TRANSLATOR_BITMAP && outType != 'DVI ')
@@ -253,6 +313,9 @@ status_t Identify(BPositionIO *inSource, const translation_format * /* inFormat
     outInfo->capability = inputFormats[0].capability;
     sprintf(outInfo->name, "%s", inputFormats[0].name);
     strcpy(outInfo->MIME, inputFormats[0].MIME);
+
+    if (ioExtension && (NumPages = CountPages(inSource)) > 0)
+      ioExtension->AddInt32("/documentCount", NumPages);
   }
   return B_OK;
 }
@@ -289,14 +352,58 @@ static status_t CopyLoop(BPositionIO *input, BPositionIO *output)
   return err >= 0 ? B_OK : err;
 }
 
+// Draws a page containing figures with the app_server and converts the colour indices to grey values.
+
+static status_t DrawWithView(DVI *Document, DrawSettings *Settings, uint PageNo, PageBuffer *Page)
+{
+  BRect   Bounds(0, 0, Page->Width - 1, Page->Height - 1);
+  BView   *BufferView;
+  BBitmap *BufferBitMap;
+  uchar   *src;
+  uchar   *dst;
+  int32   x, y;
+
+  if (!(BufferView = new BView(Bounds, NULL, 0, 0)))
+    return B_NO_MEMORY;
+
+  if (!(BufferBitMap = new BBitmap(Bounds, B_COLOR_8_BIT, true)))
+  {
+    delete BufferView;
+    return B_NO_MEMORY;
+  }
+
+  BufferBitMap->AddChild(BufferView);
+
+  if (!BufferView->LockLooper())
+  {
+    delete BufferBitMap;
+    return B_ERROR;
+  }
+
+  Document->Draw(BufferView, Settings, PageNo);
+
+  BufferView->UnlockLooper();
+
+  src = (uchar *)BufferBitMap->Bits();
+  dst = Page->Bits;
+
+  for (y = 0; y < Page->Height; y++, src += BufferBitMap->BytesPerRow(), dst += Page->BytesPerRow)
+    for (x = 0; x < Page->Width; x++)
+      dst[x] = PageBuffer::GreyTable[src[x]];
+
+  delete BufferBitMap;
+
+  return B_OK;
+}
+
 static status_t WriteBitMap(BPositionIO *input, BPositionIO *output, BMessage *ioExtension)
 {
   DVI              *Document     = NULL;
   DrawSettings     Settings;
   TranslatorBitmap BitMap;
-  BView            *BufferView   = NULL;
-  BBitmap          *BufferBitMap = NULL;
-  BRect            DocumentBounds;
+  PageBuffer       *Page         = NULL;
+  PageLayout       *l;
+  BRect            Content;
   status_t         err;
   char             *s_value;
   int32            i_value;
@@ -307,6 +414,7 @@ static status_t WriteBitMap(BPositionIO *input, BPositionIO *output, BMessage *i
   int32 PageNo;
   int16 ShrinkFactor;
   bool  AntiAliasing;
+  bool  Crop;
 
   try
   {
@@ -321,6 +429,7 @@ static status_t WriteBitMap(BPositionIO *input, BPositionIO *output, BMessage *i
     PageNo        = settings.PageNo;
     ShrinkFactor  = settings.ShrinkFactor;
     AntiAliasing  = settings.AntiAliasing;
+    Crop          = settings.Crop;
 
     release_sem(settings.Lock);
   }
@@ -348,25 +457,20 @@ static status_t WriteBitMap(BPositionIO *input, BPositionIO *output, BMessage *i
         ShrinkFactor  = i_value;
       if (ioExtension->FindBool (kAAExtension,     &b_value) == B_OK)
         AntiAliasing  = b_value;
+      if (ioExtension->FindBool (kCropExtension,   &b_value) == B_OK)
+        Crop          = b_value;
     }
 
     // init kpathsea
 
-    if (!InitKpseSem())
+    if (!InitKpathsea(Mode, PixelsPerInch))
       return B_ERROR;
 
-    acquire_sem(kpse_sem);
-    kpse_set_program_name("/boot/home/config/add-ons/Translators/DVIHandler", NULL);
-    kpse_init_prog("BEDVI", PixelsPerInch, Mode, "cmr10");
-    kpse_set_program_enabled(kpse_pk_format,        1, kpse_src_compile);
-    kpse_set_program_enabled(kpse_any_glyph_format, 1, kpse_src_compile);
-    release_sem(kpse_sem);
-
     // draw page in bitmap
 
     Settings.DspInfo.Mode          = Mode;
     Settings.DspInfo.PixelsPerInch = PixelsPerInch;
-    Settings.ShrinkFactor          = ShrinkFactor;
+    Settings.Shrink                = ShrinkFactor * DrawSettings::ShrinkOne;
     Settings.AntiAliasing          = AntiAliasing;
 
     if (!(Document = new DVI(input, &Settings)))
@@ -375,44 +479,44 @@ static status_t WriteBitMap(BPositionIO *input, BPositionIO *output, BMessage *i
       return B_NO_MEMORY;
     }
 
-    DocumentBounds = BRect(0, 0, Document->PageWidth - 1, Document->PageHeight - 1);
+    // pages without figures are drawn without the app_server and only the part containing characters is drawn
 
-    if (!(BufferView = new BView(DocumentBounds, NULL, 0, 0)))
+    l       = Document->Layout(&Settings, PageNo);
+    Content = BRect(0, 0, Document->PageWidth - 1, Document->PageHeight - 1);
+
+    if (Crop && l != NULL && !l->HasSpecials)
     {
-      delete Document;
-      FreeKpseSem();
-      return B_NO_MEMORY;
+      Content = Document->ContentBounds(&Settings, PageNo);
+
+      if (!Content.IsValid())                                   // empty page
+        Content = BRect(0, 0, 0, 0);
     }
 
-    if (!(BufferBitMap = new BBitmap(DocumentBounds, B_COLOR_8_BIT, true)))
+    if (!(Page = new PageBuffer(Content.IntegerWidth() + 1, Content.IntegerHeight() + 1)) || !Page->Ok())
     {
-      delete BufferView;
+      delete Page;
       delete Document;
       FreeKpseSem();
       return B_NO_MEMORY;
     }
 
-    BufferBitMap->AddChild(BufferView);
-
-    if (!BufferView->LockLooper())
+    if (l != NULL && !l->HasSpecials)
+      Document->DrawCropped(Page, &Settings, PageNo, Content);
+    else if ((err = DrawWithView(Document, &Settings, PageNo, Page)) < B_OK)
     {
-      delete BufferBitMap;
+      delete Page;
       delete Document;
       FreeKpseSem();
-      return B_ERROR;
+      return err;
     }
 
-    Document->Draw(BufferView, &Settings, PageNo);
-
-    BufferView->UnlockLooper();
-
     FreeKpseSem();
 
     BitMap.magic    = B_TRANSLATOR_BITMAP;
-    BitMap.bounds   = DocumentBounds;
-    BitMap.rowBytes = BufferBitMap->BytesPerRow();
+    BitMap.bounds   = BRect(0, 0, Page->Width - 1, Page->Height - 1);
+    BitMap.rowBytes = Page->BytesPerRow;
     BitMap.dataSize = BitMap.rowBytes * (BitMap.bounds.IntegerHeight() + 1);
-    BitMap.colors   = B_COLOR_8_BIT;
+    BitMap.colors   = B_GRAYSCALE_8_BIT;
 
     size_t size     = BitMap.dataSize;        // save size, it may be swapped below
 
@@ -424,21 +528,21 @@ static status_t WriteBitMap(BPositionIO *input, BPositionIO *output, BMessage *i
 
     if ((err = output->Write(&BitMap, sizeof(BitMap))) < B_OK)
     {
-      delete BufferBitMap;
+      delete Page;
       delete Document;
       return err;
     }
 
-    err = output->Write(BufferBitMap->Bits(), size);
+    err = output->Write(Page->Bits, size);
 
-    delete BufferBitMap;
+    delete Page;
     delete Document;
 
     return err < B_OK ? err : B_OK;
   }
   catch(...)
   {
-    delete BufferBitMap;
+    delete Page;
     delete Document;
     return B_NO_MEMORY;
   }
@@ -468,12 +572,14 @@ status_t GetConfigMessage(BMessage *ioExtension)
   ioExtension->RemoveName(kDPIExtension);
   ioExtension->RemoveName(kShrinkExtension);
   ioExtension->RemoveName(kAAExtension);
+  ioExtension->RemoveName(kCropExtension);
 
   ioExtension->AddInt32(B_TRANSLATOR_EXT_FRAME, settings.PageNo);
   ioExtension->AddString(kModeExtension,        settings.Mode);
   ioExtension->AddInt32(kDPIExtension,          settings.PixelsPerInch);
   ioExtension->AddInt32(kShrinkExtension,       settings.ShrinkFactor);
   ioExtension->AddBool (kAAExtension,           settings.AntiAliasing);
+  ioExtension->AddBool (kCropExtension,         settings.Crop);
 
   release_sem(settings.Lock);
 
@@ -494,6 +600,7 @@ class ParamView: public BView
     BTextControl *Shrink;
     BTextControl *PageNo;
     BCheckBox    *AntiAliasing;
+    BCheckBox    *Crop;
 
     ParamView();
     virtual ~ParamView();
@@ -507,7 +614,8 @@ ParamView::ParamView():
   Mode(NULL),
   DPI(NULL),
   Shrink(NULL),
-  AntiAliasing(NULL)
+  AntiAliasing(NULL),
+  Crop(NULL)
 {
   BRect r(0, 1, 100, 10);
 
@@ -525,6 +633,9 @@ ParamView::ParamView():
 
   AntiAliasing = new BCheckBox(r,    NULL, "AntiAliasing",  new BMessage(MsgChanged), B_FOLLOW_TOP | B_FOLLOW_LEFT_RIGHT);
   AddChild(AntiAliasing);
+
+  Crop         = new BCheckBox(r,    NULL, "Crop to content", new BMessage(MsgChanged), B_FOLLOW_TOP | B_FOLLOW_LEFT_RIGHT);
+  AddChild(Crop);
 }
 
 ParamView::~ParamView()
@@ -550,6 +661,7 @@ void ParamView::AttachedToWindow()
   Shrink->SetTarget(messenger);
   PageNo->SetTarget(messenger);
   AntiAliasing->SetTarget(messenger);
+  Crop->SetTarget(messenger);
 
   // position controls
 
@@ -562,6 +674,7 @@ void ParamView::AttachedToWindow()
   Shrink->ResizeToPreferred();
   PageNo->ResizeToPreferred();
   AntiAliasing->ResizeToPreferred();
+  Crop->ResizeToPreferred();
 
   Mode->MoveTo(Spacing, Spacing);
 
@@ -579,6 +692,7 @@ void ParamView::AttachedToWindow()
   Shrink->ResizeTo(width - 1, r.Height());
 
   AntiAliasing->MoveTo(Spacing, r.bottom + Spacing);
+  Crop->MoveTo(width + Spacing, r.bottom + Spacing);
 
   r = AntiAliasing->Frame();
 
@@ -617,6 +731,7 @@ void ParamView::AttachedToWindow()
     Shrink->SetText(buffer);
 
     AntiAliasing->SetValue(settings.AntiAliasing);
+    Crop->SetValue(settings.Crop);
 
     release_sem(settings.Lock);
   }
@@ -652,6 +767,7 @@ void ParamView::MessageReceived(BMessage *msg)
     settings.ShrinkFactor  = value;
 
     settings.AntiAliasing = AntiAliasing->Value();
+    settings.Crop         = Crop->Value();
 
     release_sem(settings.Lock);
   }
@@ -693,6 +809,8 @@ status_t MakeConfig(BMessage *ioExtension, BView **outView, BRect *outExtent)
           settings.ShrinkFactor  = x;
         if (ioExtension->FindBool (kAAExtension,           &b) == B_OK)
           settings.AntiAliasing  = b;
+        if (ioExtension->FindBool (kCropExtension,         &b) == B_OK)
+          settings.Crop          = b;
 
         release_sem(settings.Lock);
       }
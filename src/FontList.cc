@@ -23,6 +23,27 @@
 /* FontList *******************************************************************************************************/
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool SameMode(const char *m1, const char *m2)                                                           //
+//                                                                                                                //
+// Compares two METAFONT modes.                                                                                   //
+//                                                                                                                //
+// const char *m1                       first mode                                                                //
+// const char *m2                       second mode                                                               //
+//                                                                                                                //
+// Result:                              `true' if both modes are equal                                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool SameMode(const char *m1, const char *m2)
+{
+  if (m1 == m2)
+    return true;
+
+  return m1 && m2 && strcmp(m1, m2) == 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // FontList::FontList()                                                                                           //
@@ -46,11 +67,16 @@ FontList::FontList()
 
 FontList::~FontList()
 {
+  FontList_t::iterator i;
+
   if (ListLock >= B_OK)
   {
     acquire_sem(ListLock);
     delete_sem(ListLock);
   }
+
+  for (i = Fonts.begin(); i != Fonts.end(); i++)
+    delete *i;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -58,7 +84,8 @@ FontList::~FontList()
 // Font *FontList::LoadFont(const DVI *doc, const DrawSettings *Settings, const char *Name, float Size,           //
 //                          long ChkSum, int MagStep, double DimConvert)                                          //
 //                                                                                                                //
-// Loads a font and adds it to the list.                                                                          //
+// Loads a font and adds it to the list. If the font has already been loaded for the same resolution and mode     //
+// the old one is used again unless it has been a placeholder for a font generated in the background.             //
 //                                                                                                                //
 // const DVI          *doc              document the font appears in                                              //
 // const DrawSettings *Settings         settings                                                                  //
@@ -87,7 +114,8 @@ Font *FontList::LoadFont(const DVI *doc, const DrawSettings *Settings, const cha
     FontList_t::iterator i = Fonts.begin();
 
     for (i = Fonts.begin(); i != Fonts.end(); i++)
-      if (strcmp((*i)->Name, Name) == 0 && (int)(Size + 0.5) == (int)((*i)->Size + 0.5))
+      if (!(*i)->Placeholder && strcmp((*i)->Name, Name) == 0 && (int)(Size + 0.5) == (int)((*i)->Size + 0.5) &&
+          (*i)->PixelsPerInch == Settings->DspInfo.PixelsPerInch && SameMode((*i)->Mode, Settings->DspInfo.Mode))
         break;
 
     if (i == Fonts.end())
@@ -96,9 +124,13 @@ Font *FontList::LoadFont(const DVI *doc, const DrawSettings *Settings, const cha
 
       if (!f->Loaded)
         throw(runtime_error("can't load font"));
-
-      Fonts.push_back(f);
     }
+    else
+    {
+      f = *i;
+      Fonts.erase(i);
+    }
+    Fonts.push_front(f);
 
     atomic_add(&f->UseCount, 1);
   }
@@ -119,7 +151,7 @@ Font *FontList::LoadFont(const DVI *doc, const DrawSettings *Settings, const cha
 //                                                                                                                //
 // void FontList::FreeFont(Font *f)                                                                               //
 //                                                                                                                //
-// frees a font.                                                                                                  //
+// frees a font. The font stays in the list until it is removed by `FreeUnusedFonts()'.                           //
 //                                                                                                                //
 // Font *f                              font to be freed                                                          //
 //                                                                                                                //
@@ -127,17 +159,7 @@ Font *FontList::LoadFont(const DVI *doc, const DrawSettings *Settings, const cha
 
 void FontList::FreeFont(Font *f)
 {
-  if (atomic_add(&f->UseCount, -1) == 1)
-  {
-    if (acquire_sem(ListLock) < B_OK)
-      return;
-
-    Fonts.remove(f);
-
-    release_sem(ListLock);
-
-    delete f;
-  }
+  atomic_add(&f->UseCount, -1);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -162,24 +184,27 @@ void FontList::FreeAll()
 //                                                                                                                //
 // void FontList::FreeUnusedFonts()                                                                               //
 //                                                                                                                //
-// Frees all unused fonts in the list.                                                                            //
+// Frees the unused fonts in the list except for the `MaxUnusedFonts' ones loaded last.                           //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void FontList::FreeUnusedFonts()
 {
   FontList_t::iterator i;
+  uint                 NumUnused = 0;
 
   if (acquire_sem(ListLock) < B_OK)
     return;
 
-  for (i = Fonts.begin(); i != Fonts.end(); i++)
-    if ((*i)->UseCount < 1)
+  for (i = Fonts.begin(); i != Fonts.end(); )
+    if ((*i)->UseCount < 1 && ++NumUnused > MaxUnusedFonts)
     {
       delete *i;
 
-      Fonts.erase(i);
+      i = Fonts.erase(i);
     }
+    else
+      i++;
 
   release_sem(ListLock);
 }
@@ -423,6 +448,27 @@ void FontTable::FreeFonts()
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool FontTable::GlyphsPending() const                                                                          //
+//                                                                                                                //
+// Checks whether some fonts of the table are still generated in the background.                                  //
+//                                                                                                                //
+// Result:                              `true' if the document should be reloaded when fonts have been generated  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FontTable::GlyphsPending() const
+{
+  ulong i;
+
+  for (i = 0; i < TableLen; i++)
+    if (Table[i] && Table[i]->GlyphsPending())
+      return true;
+
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // void FontTable::FreeUnusedFonts()                                                                              //
@@ -25,13 +25,22 @@ class DrawSettings;
 class DVI;
 class Font;
 
+// Fonts of a document. Fonts which are no longer used are kept for a while, so that switching back to a
+// resolution or mode used before doesn't have to load them again.
+
 class FontList
 {
+  public:
+    enum
+    {
+      MaxUnusedFonts = 64      // number of unused fonts kept by `FreeUnusedFonts()'
+    };
+
   private:
     typedef list<Font *, allocator<Font *> > FontList_t;
 
     sem_id     ListLock;
-    FontList_t Fonts;
+    FontList_t Fonts;          // most recently loaded fonts first
 
   public:
     FontList();
@@ -65,6 +74,7 @@ class FontTable
     Font *LoadFont(const DVI *doc, const DrawSettings *Settings, BPositionIO *File, Font *VirtualParent, uchar Command);
     bool Resize(ulong len);
     void FreeFonts();
+    bool GlyphsPending() const;
 
     void FreeUnusedFonts();
     void FlushShrinkedGlyphes();
@@ -0,0 +1,402 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "FontMaker.h"
+#include "log.h"
+
+static const size_t MaxArgument = 64;    // keeps the command line of `mktexpk' below 256 characters
+
+sem_id              FontMaker::Lock       = B_ERROR;
+FontMaker::JobList  FontMaker::Jobs;
+int32               FontMaker::NumWorkers = 0;
+int32               FontMaker::MaxWorkers = 1;
+bigtime_t           FontMaker::LastNotify = 0;
+bool                FontMaker::Async      = false;
+void                (*FontMaker::FontsReady)() = NULL;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool SafeArgument(const char *s)                                                                        //
+//                                                                                                                //
+// Checks whether a string may be passed to the shell unquoted. Font names are read from the DVI file, so they    //
+// mustn't contain anything the shell would interpret, and they must fit into the command line of `mktexpk'.      //
+//                                                                                                                //
+// const char *s                        string                                                                    //
+//                                                                                                                //
+// Result:                              `true' if the string consists of at most `MaxArgument' letters, digits    //
+//                                      and `+-._' only                                                           //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool SafeArgument(const char *s)
+{
+  if (*s == '\0' || *s == '-' || strlen(s) > MaxArgument)
+    return false;
+
+  for (; *s; s++)
+    if (!isalnum((uchar)*s) && strchr("+-._", *s) == NULL)
+      return false;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool FontMaker::Init()                                                                                         //
+//                                                                                                                //
+// Initializes the queue. One worker is started per CPU.                                                          //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FontMaker::Init()
+{
+  system_info info;
+
+  get_system_info(&info);
+
+  MaxWorkers = info.cpu_count > 1 ? info.cpu_count : 1;
+
+  return (Lock = create_sem(1, "font maker")) >= B_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void FontMaker::Shutdown()                                                                                     //
+//                                                                                                                //
+// Drops all fonts which haven't been started yet. Running workers notice the deleted semaphore and quit when     //
+// their font is finished.                                                                                        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FontMaker::Shutdown()
+{
+  if (Lock < B_OK || acquire_sem(Lock) < B_OK)
+    return;
+
+  Async      = false;
+  FontsReady = NULL;
+
+  Jobs.clear();
+
+  delete_sem(Lock);
+  Lock = B_ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool FontMaker::Queue(const char *Name, uint dpi, uint BaseDPI, const char *Mode)                              //
+//                                                                                                                //
+// Adds a font to the queue unless it has been queued before. A worker is started if all are busy.                //
+//                                                                                                                //
+// const char *Name                     name of the font                                                          //
+// uint       dpi                       size of the font                                                          //
+// uint       BaseDPI                   resolution of `Mode'                                                      //
+// const char *Mode                     METAFONT mode or `NULL' for the default of `mktexpk'                      //
+//                                                                                                                //
+// Result:                              `true' if the font will be generated, `false' if it can't                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FontMaker::Queue(const char *Name, uint dpi, uint BaseDPI, const char *Mode)
+{
+  Job       j;
+  Job       *old;
+  thread_id tid;
+  bool      Ok = true;
+
+  if (!SafeArgument(Name) || (Mode && !SafeArgument(Mode)) || dpi == 0 || BaseDPI == 0)
+  {
+    log_warn("can't generate font '%s'!", Name);
+    return false;
+  }
+
+  if (acquire_sem(Lock) < B_OK)
+    return false;
+
+  try
+  {
+    if (old = FindJob(Name, dpi))
+      Ok = old->State != Failed;
+    else
+    {
+      j.Name          = Name;
+      j.Mode          = Mode ? Mode : "";
+      j.PixelsPerInch = dpi;
+      j.BaseDPI       = BaseDPI;
+      j.State         = Queued;
+
+      Jobs.push_back(j);
+
+      log_info("queued font %s at %u dpi", Name, dpi);
+
+      if (NumWorkers < MaxWorkers)
+      {
+        if ((tid = spawn_thread(WorkerThread, "font maker", B_LOW_PRIORITY, NULL)) >= B_OK)
+        {
+          NumWorkers++;
+          resume_thread(tid);
+        }
+        else if (NumWorkers == 0)
+        {
+          Jobs.pop_back();
+          Ok = false;
+        }
+      }
+    }
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+    Ok = false;
+  }
+  release_sem(Lock);
+
+  return Ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool FontMaker::Pending(const char *Name, uint dpi)                                                            //
+//                                                                                                                //
+// Checks whether a font is waiting to be generated or being generated.                                           //
+//                                                                                                                //
+// const char *Name                     name of the font                                                          //
+// uint       dpi                       size of the font                                                          //
+//                                                                                                                //
+// Result:                              `true' if the font will be available later                                //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FontMaker::Pending(const char *Name, uint dpi)
+{
+  Job  *j;
+  bool Result = false;
+
+  if (acquire_sem(Lock) < B_OK)
+    return false;
+
+  if (j = FindJob(Name, dpi))
+    Result = j->State == Queued || j->State == Running;
+
+  release_sem(Lock);
+
+  return Result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool FontMaker::Generated(const char *Name, uint dpi, string &Path)                                            //
+//                                                                                                                //
+// Looks for a font generated by a worker. kpathsea may not know these files yet.                                 //
+//                                                                                                                //
+// const char *Name                     name of the font                                                          //
+// uint       dpi                       size of the font                                                          //
+// string     &Path                     returns the file of the font                                              //
+//                                                                                                                //
+// Result:                              `true' if the font has been generated, otherwise `false'                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FontMaker::Generated(const char *Name, uint dpi, string &Path)
+{
+  Job  *j;
+  bool Result = false;
+
+  if (acquire_sem(Lock) < B_OK)
+    return false;
+
+  if ((j = FindJob(Name, dpi)) && j->State == Done)
+  {
+    Path   = j->Path;
+    Result = true;
+  }
+  release_sem(Lock);
+
+  return Result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// FontMaker::Job *FontMaker::FindJob(const char *Name, uint dpi)                                                 //
+//                                                                                                                //
+// Looks for the entry of a font. This procedure should be called with `Lock' locked.                             //
+//                                                                                                                //
+// const char *Name                     name of the font                                                          //
+// uint       dpi                       size of the font                                                          //
+//                                                                                                                //
+// Result:                              the entry or `NULL' if the font hasn't been queued                        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FontMaker::Job *FontMaker::FindJob(const char *Name, uint dpi)
+{
+  JobList::iterator i;
+
+  for (i = Jobs.begin(); i != Jobs.end(); i++)
+    if (i->PixelsPerInch == dpi && i->Name == Name)
+      return &*i;
+
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool FontMaker::Generate(const Job &j, string &Path)                                                           //
+//                                                                                                                //
+// Runs `mktexpk' with the arguments kpathsea would use. `mktexpk' prints the name of the file it has created.    //
+//                                                                                                                //
+// const Job &j                         font to be generated                                                      //
+// string    &Path                      returns the file created                                                  //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FontMaker::Generate(const Job &j, string &Path)
+{
+  char Command[256];
+  char Line[B_PATH_NAME_LENGTH];
+  FILE *Pipe;
+  int  len;
+
+  if (j.Mode.empty())
+    sprintf(Command, "mktexpk --bdpi %u --mag %u+%u/%u --dpi %u %s", j.BaseDPI,
+            j.PixelsPerInch / j.BaseDPI, j.PixelsPerInch % j.BaseDPI, j.BaseDPI, j.PixelsPerInch, j.Name.c_str());
+  else
+    sprintf(Command, "mktexpk --mfmode %s --bdpi %u --mag %u+%u/%u --dpi %u %s", j.Mode.c_str(), j.BaseDPI,
+            j.PixelsPerInch / j.BaseDPI, j.PixelsPerInch % j.BaseDPI, j.BaseDPI, j.PixelsPerInch, j.Name.c_str());
+
+  log_info("%s", Command);
+
+  if (!(Pipe = popen(Command, "r")))
+    return false;
+
+  // the file name is the last line of the output
+
+  Path = "";
+
+  while (fgets(Line, sizeof(Line), Pipe))
+  {
+    len = strlen(Line);
+
+    while (len > 0 && isspace((uchar)Line[len - 1]))
+      Line[--len] = '\0';
+
+    if (len > 0)
+      Path = Line;
+  }
+
+  if (pclose(Pipe) != 0 || Path.empty() || access(Path.c_str(), R_OK) != 0)
+  {
+    log_warn("can't generate font '%s' at %u dpi!", j.Name.c_str(), j.PixelsPerInch);
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// int32 FontMaker::WorkerThread(void *)                                                                          //
+//                                                                                                                //
+// Generates queued fonts until the queue is empty. `FontsReady' is called when the last font has been finished   //
+// and, while fonts are still being generated, at most every `NotifyInterval' microseconds, so that the documents //
+// aren't reloaded once per font.                                                                                 //
+//                                                                                                                //
+// Result:                              0                                                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32 FontMaker::WorkerThread(void *)
+{
+  JobList::iterator i;
+  Job               j;
+  Job               *p;
+  string            Path;
+  bool              Ok;
+  bool              Notify;
+  void              (*Ready)();
+
+  try
+  {
+    for (;;)
+    {
+      if (acquire_sem(Lock) < B_OK)
+        return 0;
+
+      for (i = Jobs.begin(); i != Jobs.end() && i->State != Queued; i++)
+        ;
+
+      if (i == Jobs.end())
+      {
+        NumWorkers--;
+        release_sem(Lock);
+        return 0;
+      }
+
+      i->State = Running;
+      j        = *i;
+
+      release_sem(Lock);
+
+      Ok = Generate(j, Path);
+
+      if (acquire_sem(Lock) < B_OK)          // `Shutdown()' has been called
+        return 0;
+
+      if (p = FindJob(j.Name.c_str(), j.PixelsPerInch))
+      {
+        p->State = Ok ? Done : Failed;
+        p->Path  = Path;
+      }
+
+      // notify when the queue is empty or enough time has passed
+
+      Notify = true;
+
+      for (i = Jobs.begin(); i != Jobs.end(); i++)
+        if (i->State == Queued || i->State == Running)
+          Notify = false;
+
+      if (!Notify && system_time() - LastNotify >= NotifyInterval)
+        Notify = true;
+
+      if (Notify)
+        LastNotify = system_time();
+
+      Ready = FontsReady;
+
+      release_sem(Lock);
+
+      if (Notify && Ready)
+        (*Ready)();
+    }
+  }
+  catch(const exception &e)
+  {
+    log_error("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  catch(...)
+  {
+    log_error("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FONTMAKER_H
+#define FONTMAKER_H
+
+#include <KernelKit.h>
+#include <list.h>
+#if defined (__MWERKS__)
+#include <string>
+#endif
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+// Generates missing PK fonts with `mktexpk' in background threads. While a font is generated the document is
+// drawn with boxes taken from the metrics of the font (see `Font::LoadMetrics()').
+
+class FontMaker
+{
+  public:
+    enum
+    {
+      NotifyInterval = 5000000    // minimal time between two calls of `FontsReady' while fonts are generated
+    };
+
+  private:
+    enum JobState
+    {
+      Queued,
+      Running,
+      Done,
+      Failed
+    };
+
+    struct Job
+    {
+      string   Name;
+      string   Mode;
+      uint     PixelsPerInch;
+      uint     BaseDPI;
+      JobState State;
+      string   Path;                 // file generated
+    };
+
+    typedef list<Job, allocator<Job> > JobList;
+
+    static sem_id    Lock;
+    static JobList   Jobs;
+    static int32     NumWorkers;
+    static int32     MaxWorkers;
+    static bigtime_t LastNotify;
+
+  public:
+    static bool Async;               // if `false' missing fonts are generated by kpathsea while they are loaded
+    static void (*FontsReady)();     // called from a worker thread when fonts have been generated
+
+    static bool Init();
+    static void Shutdown();
+
+    static bool Queue(const char *Name, uint dpi, uint BaseDPI, const char *Mode);
+    static bool Pending(const char *Name, uint dpi);
+    static bool Generated(const char *Name, uint dpi, string &Path);
+
+  private:
+    static Job   *FindJob(const char *Name, uint dpi);
+    static bool  Generate(const Job &j, string &Path);
+    static int32 WorkerThread(void *);
+};
+
+#endif
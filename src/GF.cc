@@ -143,6 +143,8 @@ static void ReadChar(Font *f, wchar c)
       }
       break;
     }
+    g->HasMetrics = true;
+
     PaintSwitch = 0;
 
     if (!(g->UBitMap = new BBitmap(
@@ -81,7 +81,7 @@ class GSInterface: public PSInterface
     uint  PageWidth;      // size of the current page
     uint  PageHeight;
     int   Magnification;  // magnification currently in use
-    int   Shrink;         // shrink factor currently in use
+    int32 Shrink;         // shrink factor currently in use (see `DrawSettings::Shrink')
 
     uchar *Device;        // GhostScript device
     BView *vw;
@@ -186,7 +186,7 @@ bool GSInterface::Init(DrawPage *dp)
   GSargv[1] = Buffer;
   GSargv[2] = Buffer + 50;
 
-  vw = dp->vw;
+  vw = dp->rt->View();
 
   log_info("running: %s %s %s %s %s %s %s %s",
     GSargv[0], GSargv[1], GSargv[2], GSargv[3], GSargv[4], GSargv[5], GSargv[6], GSargv[7]);
@@ -245,8 +245,16 @@ void GSInterface::DrawBegin(const DrawPage *dp, int xul, int yul, const char *cm
 
   log_debug("GSDrawBegin(%s)", cmd);
 
+  if (dp->rt->View() == NULL)          // GhostScript can only draw into views
+  {
+    DrawBBox(dp);
+    return;
+  }
+
   if (!Initialized)
     Init(dp);
+  else if (!Active)
+    vw = dp->rt->View();
 
   gsdll_execute_begin();
 
@@ -275,11 +283,11 @@ void GSInterface::DrawBegin(const DrawPage *dp, int xul, int yul, const char *cm
       sprintf(Buffer, "H TeXDict begin /DVImag %d 1000 div def end stop\n%%%%xdvimark\n", Magnification);
       Send(Buffer, strlen(Buffer));
     }
-    if (dp->Settings.ShrinkFactor != Shrink)
+    if (dp->Settings.Shrink != Shrink)
     {
-      Shrink = dp->Settings.ShrinkFactor;
-      sprintf(Buffer, "H TeXDict begin %d %d div dup /Resolution X /VResolution X end stop\n%%%%xdvimark\n",
-              dp->Settings.DspInfo.PixelsPerInch, Shrink);
+      Shrink = dp->Settings.Shrink;
+      sprintf(Buffer, "H TeXDict begin %d %g div dup /Resolution X /VResolution X end stop\n%%%%xdvimark\n",
+              dp->Settings.DspInfo.PixelsPerInch, dp->Settings.ShrinkFactor());
       Send(Buffer, strlen(Buffer));
     }
     Send(str3, sizeof(str3) - 1);
@@ -0,0 +1,558 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <list.h>
+#if defined (__MWERKS__)
+#include <string>
+#endif
+
+extern "C"
+{
+  #define string _string
+  #include "kpathsea/c-auto.h"
+  #include "kpathsea/tex-file.h"
+  #undef string
+}
+
+#include "BeDVI.h"
+#include "TeXFont.h"
+#include "OutlineFont.h"
+#include "log.h"
+
+#ifndef NO_FREETYPE
+
+// a line of `psfonts.map'
+
+struct MapEntry
+{
+  string Name;                       // name used by TeX
+  string FontFile;
+  string Encoding;                   // file containing the encoding, empty for the one built into the font
+  double Slant;
+  double Extend;
+};
+
+typedef list<MapEntry, allocator<MapEntry> > MapList;
+
+static MapList FontMap;              // protected by `kpse_sem'
+static bool    MapLoaded = false;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool NextWord(const char *&s, string &Word, bool &Quoted)                                               //
+//                                                                                                                //
+// Splits the next word off a line of the font map. A word is either delimited by white space or enclosed in      //
+// double quotes.                                                                                                 //
+//                                                                                                                //
+// const char *&s                       line; set behind the word                                                 //
+// string     &Word                     used to return the word without quotes                                    //
+// bool       &Quoted                   used to return whether the word was enclosed in quotes                    //
+//                                                                                                                //
+// Result:                              `false' at the end of the line                                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool NextWord(const char *&s, string &Word, bool &Quoted)
+{
+  const char *Start;
+
+  while (isspace((uchar)*s))
+    s++;
+
+  if (*s == '\0')
+    return false;
+
+  Quoted = (*s == '"');
+
+  if (Quoted)
+  {
+    Start = ++s;
+
+    while (*s && *s != '"')
+      s++;
+
+    Word.assign(Start, s - Start);
+
+    if (*s)
+      s++;
+  }
+  else
+  {
+    Start = s;
+
+    while (*s && !isspace((uchar)*s))
+      s++;
+
+    Word.assign(Start, s - Start);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool ParseMapLine(const char *Line, MapEntry &e)                                                        //
+//                                                                                                                //
+// Parses a line of `psfonts.map'. It contains the name of the font, its PostScript name, the instructions in     //
+// quotes and the files to download, which are prefixed by `<'.                                                   //
+//                                                                                                                //
+// const char *Line                     line                                                                      //
+// MapEntry   &e                        used to return the entry                                                  //
+//                                                                                                                //
+// Result:                              `true' if the line describes a font which can be rasterized               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool ParseMapLine(const char *Line, MapEntry &e)
+{
+  string     Word;
+  const char *s;
+  const char *Arg;
+  double     Number = 0.0;
+  bool       Quoted;
+  uint       i;
+
+  if (strchr("%#*;\n", Line[0]))
+    return false;
+
+  e.Name     = "";
+  e.FontFile = "";
+  e.Encoding = "";
+  e.Slant    = 0.0;
+  e.Extend   = 1.0;
+
+  if (!NextWord(Line, e.Name, Quoted))
+    return false;
+
+  while (NextWord(Line, Word, Quoted))
+  {
+    if (!Quoted && Word[0] == '<')
+    {
+      for (i = 0; i < Word.length() && (Word[i] == '<' || Word[i] == '['); i++)
+        ;
+
+      Word.erase(0, i);
+
+      if (Word.length() > 4 && Word.compare(Word.length() - 4, 4, ".enc") == 0)
+        e.Encoding = Word;
+      else
+        e.FontFile = Word;
+    }
+    else if (Quoted)
+    {
+      // the PostScript instructions; only the transformations are supported
+
+      for (s = Word.c_str(); *s; )
+      {
+        while (isspace((uchar)*s))
+          s++;
+
+        Arg = s;
+
+        while (*s && !isspace((uchar)*s))
+          s++;
+
+        if (strncmp(Arg, "SlantFont", s - Arg) == 0 && s - Arg == 9)
+          e.Slant = Number;
+        else if (strncmp(Arg, "ExtendFont", s - Arg) == 0 && s - Arg == 10)
+          e.Extend = Number;
+        else
+          Number = atof(Arg);
+      }
+    }
+  }
+
+  // resident fonts don't have a file
+
+  return e.FontFile.length() > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void ReadMap()                                                                                          //
+//                                                                                                                //
+// Reads `psfonts.map'. `kpse_sem' must be held.                                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void ReadMap()
+{
+  MapEntry e;
+  FILE     *File;
+  char     *name;
+  char     Line[1024];
+
+  MapLoaded = true;
+
+  if (!(name = kpse_find_file("psfonts.map", kpse_dvips_config_format, true)))
+  {
+    log_warn("psfonts.map not found!");
+    return;
+  }
+
+  if (!(File = fopen(name, "r")))
+  {
+    log_warn("can't open file!");
+    free(name);
+    return;
+  }
+
+  while (fgets(Line, sizeof(Line), File))
+    if (ParseMapLine(Line, e))
+      FontMap.push_back(e);
+
+  fclose(File);
+  free(name);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool ReadEncoding(const char *FileName, FT_Face Face, FT_UInt *GlyphIndex)                              //
+//                                                                                                                //
+// Reads an encoding vector and looks up the glyphs it names.                                                     //
+//                                                                                                                //
+// const char *FileName                 encoding file                                                             //
+// FT_Face    Face                      font                                                                      //
+// FT_UInt    *GlyphIndex               table of 256 entries used to return the glyph of each character code      //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool ReadEncoding(const char *FileName, FT_Face Face, FT_UInt *GlyphIndex)
+{
+  FILE *File;
+  char Name[128];
+  int  ch;
+  int  c = -1;                       // code of the next glyph name, -1 before the vector starts
+  uint i;
+
+  if (!(File = fopen(FileName, "r")))
+  {
+    log_warn("can't open file!");
+    return false;
+  }
+
+  while (c < 256 && (ch = getc(File)) != EOF)
+  {
+    if (ch == '%')
+    {
+      while ((ch = getc(File)) != EOF && ch != '\n')
+        ;
+    }
+    else if (c < 0)
+    {
+      if (ch == '[')
+        c = 0;
+    }
+    else if (ch == ']')
+      break;
+    else if (ch == '/')
+    {
+      for (i = 0; (ch = getc(File)) != EOF && !isspace(ch) && !strchr("/[]%", ch); )
+        if (i < sizeof(Name) - 1)
+          Name[i++] = ch;
+
+      Name[i] = '\0';
+
+      if (ch != EOF)
+        ungetc(ch, File);
+
+      GlyphIndex[c++] = FT_Get_Name_Index(Face, Name);
+    }
+  }
+  fclose(File);
+
+  if (c < 0)
+  {
+    log_warn("invalid encoding file!");
+    return false;
+  }
+  return true;
+}
+
+#endif  // !NO_FREETYPE
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// OutlineFont::OutlineFont()                                                                                     //
+//                                                                                                                //
+// Initializes an OutlineFont. It is created by `Open()'.                                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+OutlineFont::OutlineFont()
+#ifndef NO_FREETYPE
+  :
+  Library(NULL),
+  Face(NULL)
+#endif
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// OutlineFont::~OutlineFont()                                                                                    //
+//                                                                                                                //
+// Frees the font.                                                                                                //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+OutlineFont::~OutlineFont()
+{
+#ifndef NO_FREETYPE
+  if (Face)
+    FT_Done_Face(Face);
+  if (Library)
+    FT_Done_FreeType(Library);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// OutlineFont *OutlineFont::Open(const char *Name)                                                               //
+//                                                                                                                //
+// Looks a font up in `psfonts.map' and opens its file.                                                           //
+//                                                                                                                //
+// const char *Name                     name of the font                                                          //
+//                                                                                                                //
+// Result:                              the font or `NULL' if it isn't an outline font or can't be opened         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+OutlineFont *OutlineFont::Open(const char *Name)
+{
+#ifndef NO_FREETYPE
+  MapList::iterator i;
+  OutlineFont       *f        = NULL;
+  char              *FontFile = NULL;
+  char              *EncFile  = NULL;
+  bool              Found     = false;
+  bool              Encoded   = false;
+  FT_Matrix         Matrix;
+  FT_CharMap        CharMap;
+  int               c;
+
+  acquire_sem(kpse_sem);
+
+  try
+  {
+    if (!MapLoaded)
+      ReadMap();
+
+    for (i = FontMap.begin(); i != FontMap.end(); i++)
+      if (i->Name == Name)
+        break;
+
+    if (i != FontMap.end())
+    {
+      Found   = true;
+      Encoded = i->Encoding.length() > 0;
+
+      FontFile = kpse_find_file(i->FontFile.c_str(), kpse_type1_format, false);
+
+      if (Encoded)
+        EncFile = kpse_find_file(i->Encoding.c_str(), kpse_tex_ps_header_format, false);
+
+      Matrix.xx = (FT_Fixed)(i->Extend * 0x10000);
+      Matrix.xy = (FT_Fixed)(i->Slant  * 0x10000);
+      Matrix.yx = 0;
+      Matrix.yy = 0x10000;
+    }
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  release_sem(kpse_sem);
+
+  if (!Found)
+    return NULL;
+
+  if (!FontFile || (Encoded && !EncFile))
+  {
+    log_warn("outline font '%s' not found!", Name);
+    goto error;
+  }
+
+  try
+  {
+    f = new OutlineFont;
+  }
+  catch(...)
+  {
+    goto error;
+  }
+
+  if (FT_Init_FreeType(&f->Library) != 0)
+  {
+    f->Library = NULL;
+    log_warn("can't initialize FreeType!");
+    goto error;
+  }
+
+  if (FT_New_Face(f->Library, FontFile, 0, &f->Face) != 0)
+  {
+    f->Face = NULL;
+    log_warn("can't open outline font '%s'!", Name);
+    goto error;
+  }
+
+  memset(f->GlyphIndex, 0, sizeof(f->GlyphIndex));
+
+  if (Encoded)
+  {
+    if (!ReadEncoding(EncFile, f->Face, f->GlyphIndex))
+      goto error;
+  }
+  else
+  {
+    // the encoding built into a Type 1 font is offered as one of the Adobe charmaps
+
+    for (c = 0; c < f->Face->num_charmaps; c++)
+    {
+      CharMap = f->Face->charmaps[c];
+
+      if (CharMap->encoding == FT_ENCODING_ADOBE_CUSTOM   ||
+          CharMap->encoding == FT_ENCODING_ADOBE_STANDARD ||
+          CharMap->encoding == FT_ENCODING_ADOBE_EXPERT   ||
+          CharMap->encoding == FT_ENCODING_ADOBE_LATIN_1)
+      {
+        FT_Set_Charmap(f->Face, CharMap);
+        break;
+      }
+    }
+
+    for (c = 0; c < 256; c++)
+      f->GlyphIndex[c] = FT_Get_Char_Index(f->Face, c);
+  }
+
+  if (Matrix.xx != 0x10000 || Matrix.xy != 0)
+    FT_Set_Transform(f->Face, &Matrix, NULL);
+
+  free(FontFile);
+  free(EncFile);
+
+  return f;
+
+error:
+  delete f;
+  free(FontFile);
+  free(EncFile);
+
+  return NULL;
+#else
+  return NULL;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool OutlineFont::SetSize(double PixelsPerEm)                                                                  //
+//                                                                                                                //
+// Sets the size the glyphs are rasterized at.                                                                    //
+//                                                                                                                //
+// double PixelsPerEm                   size of the em square in pixels                                           //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OutlineFont::SetSize(double PixelsPerEm)
+{
+#ifndef NO_FREETYPE
+  // at 72 dpi a point is a pixel
+
+  if (FT_Set_Char_Size(Face, 0, (FT_F26Dot6)(PixelsPerEm * 64.0 + 0.5), 72, 72) != 0)
+  {
+    log_warn("invalid font size!");
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool OutlineFont::Rasterize(Glyph *g, wchar c)                                                                 //
+//                                                                                                                //
+// Rasterizes a character into the unshrunken bitmap of its glyph, in the same format a PK font is unpacked to.   //
+//                                                                                                                //
+// Glyph *g                             glyph                                                                     //
+// wchar c                              character                                                                 //
+//                                                                                                                //
+// Result:                              `true' if the glyph has a bitmap, `false' if it is empty or an error      //
+//                                      occurred                                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OutlineFont::Rasterize(Glyph *g, wchar c)
+{
+#ifndef NO_FREETYPE
+  FT_GlyphSlot Slot;
+  FT_Bitmap    *b;
+  uchar        *Row;
+  int          i;
+
+  if (g->UBitMap)
+    return true;
+
+  if (c > 255 || GlyphIndex[c] == 0)
+    return false;
+
+  if (FT_Load_Glyph(Face, GlyphIndex[c], FT_LOAD_DEFAULT | FT_LOAD_TARGET_MONO) != 0 ||
+      FT_Render_Glyph(Face->glyph, FT_RENDER_MODE_MONO)                          != 0)
+  {
+    log_warn("can't rasterize character %d!", (int)c);
+    return false;
+  }
+
+  Slot = Face->glyph;
+  b    = &Slot->bitmap;
+
+  if (b->width == 0 || b->rows == 0 || b->pitch < 0)
+    return false;
+
+  g->UBitMap = new BBitmap(
+                     BRect(0.0, 0.0,
+                           (float)((b->width + BITS_PER_UNIT - 1) & ~(BITS_PER_UNIT - 1)) - 1.0,
+                           (float)b->rows - 1.0),
+                     B_MONOCHROME_1_BIT);
+
+  if (!g->UBitMap)
+    return false;
+
+  // FreeType stores the leftmost pixel in the most significant bit of a byte, like `MSB_FIRST'
+
+  Row = (uchar *)g->UBitMap->Bits();
+
+  memset(Row, 0, g->UBitMap->BitsLength());
+
+  for (i = 0; i < b->rows; i++, Row += g->UBitMap->BytesPerRow())
+    memcpy(Row, b->buffer + i * b->pitch, (b->width + 7) / 8);
+
+  g->Ux      = -Slot->bitmap_left;
+  g->Uy      = Slot->bitmap_top;
+  g->UWidth  = b->width;
+  g->UHeight = b->rows;
+
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OUTLINEFONT_H
+#define OUTLINEFONT_H
+
+#ifndef NO_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+class Glyph;
+
+// A Type 1 font listed in `psfonts.map' whose glyphs are rasterized with FreeType at the size they are needed,
+// so no PK file has to be generated. Each instance has its own FreeType library, so fonts used by different
+// documents can be rasterized at the same time.
+
+class OutlineFont
+{
+  private:
+#ifndef NO_FREETYPE
+    FT_Library Library;
+    FT_Face    Face;
+    FT_UInt    GlyphIndex[256];      // glyph of each character code, 0 if it doesn't exist
+#endif
+
+    OutlineFont();
+
+  public:
+    ~OutlineFont();
+
+    static OutlineFont *Open(const char *Name);
+
+    bool SetSize(double PixelsPerEm);
+    bool Rasterize(Glyph *g, wchar c);
+};
+
+#endif
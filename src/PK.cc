@@ -69,6 +69,7 @@ class PKInfo
     void ReadChar(Font *f, wchar c);
 
   private:
+    void ReadPreamble(Glyph *g);
     int  GetNybble();
     int  GetPackedNum();
     bool SkipSpecials();
@@ -76,7 +77,7 @@ class PKInfo
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// void PKInfo::ReadChar(Font *f, wchar c)                                                                       //
+// void PKInfo::ReadChar(Font *f, wchar c)                                                                        //
 //                                                                                                                //
 // Reads a character from a font-file.                                                                            //
 //                                                                                                                //
@@ -88,13 +89,11 @@ class PKInfo
 void PKInfo::ReadChar(Font *f, wchar c)
 {
   int        i, j;
-  int        n;
   int        RowBitPos;
   bool       PaintSwitch;
   BitmapUnit *RowStart;
   BitmapUnit *cp;
   Glyph      *g;
-  int32      FPWidth;
   BitmapUnit Word;
   int        WordWeight;
   int        UnitsWide;
@@ -114,24 +113,7 @@ void PKInfo::ReadChar(Font *f, wchar c)
 
   f->File->Seek(g->Addr, SEEK_SET);
 
-  if (FlagByte == 7)
-    n = 4;
-  else if (FlagByte > 3)
-    n = 2;
-  else
-    n = 1;
-
-  if (n != 4)
-    FPWidth = ReadInt(f->File, 3);
-  else
-  {
-    FPWidth = (long)ReadSInt(f->File, 4);
-    ReadInt(f->File, 4);
-  }
-  ReadInt(f->File, n);
-
-  g->UWidth  = ReadInt(f->File, n);
-  g->UHeight = ReadInt(f->File, n);
+  ReadPreamble(g);
 
   g->UBitMap = new BBitmap(
                      BRect(0.0, 0.0,
@@ -139,11 +121,6 @@ void PKInfo::ReadChar(Font *f, wchar c)
                            (float)g->UHeight - 1.0),
                      B_MONOCHROME_1_BIT);
 
-  g->Ux = ReadSInt(f->File, n);
-  g->Uy = ReadSInt(f->File, n);
-
-  g->Advance = f->DimConvert * FPWidth;
-
   if (!g->UBitMap)
     return;
 
@@ -267,6 +244,46 @@ void PKInfo::ReadChar(Font *f, wchar c)
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PKInfo::ReadPreamble(Glyph *g)                                                                            //
+//                                                                                                                //
+// Reads the metrics of a character. The file must be positioned after the character code.                        //
+//                                                                                                                //
+// Glyph *g                             glyph the metrics are stored in                                           //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PKInfo::ReadPreamble(Glyph *g)
+{
+  int32 FPWidth;
+  int   n;
+
+  if ((g->FlagByte & 0x7) == 7)
+    n = 4;
+  else if ((g->FlagByte & 0x7) > 3)
+    n = 2;
+  else
+    n = 1;
+
+  if (n != 4)
+    FPWidth = ReadInt(f->File, 3);
+  else
+  {
+    FPWidth = (long)ReadSInt(f->File, 4);
+    ReadInt(f->File, 4);
+  }
+  ReadInt(f->File, n);
+
+  g->UWidth  = ReadInt(f->File, n);
+  g->UHeight = ReadInt(f->File, n);
+  g->Ux      = ReadSInt(f->File, n);
+  g->Uy      = ReadSInt(f->File, n);
+
+  g->Advance    = f->DimConvert * FPWidth;
+  g->HasMetrics = true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // int PKInfo::GetNybble()                                                                                        //
@@ -474,10 +491,17 @@ bool PKInfo::ReadIndex()
       BytesLeft = (FlagLowBits << 8) + ReadInt(f->File, 1);
       c         = ReadInt(f->File, 1);
     }
+    if (c > 255)
+      return false;
+
     f->Glyphs[c].Addr     = f->File->Seek(0, SEEK_CUR);
     f->Glyphs[c].FlagByte = FlagByte;
 
-    f->File->Seek(BytesLeft, SEEK_CUR);
+    // reading the metrics here allows to position characters without unpacking them
+
+    ReadPreamble(&f->Glyphs[c]);
+
+    f->File->Seek(f->Glyphs[c].Addr + BytesLeft, SEEK_SET);
   }
 }
 
@@ -0,0 +1,631 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <InterfaceKit.h>
+#include <string.h>
+#include <vector.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+#include "PageBuffer.h"
+#include "log.h"
+
+bool  PageBuffer::Headless = false;
+uchar PageBuffer::GreyTable[256];
+uchar PageBuffer::IndexTable[256];
+
+
+/* blending *******************************************************************************************************/
+
+
+// The row functions combine `n' grey values from `src' with the destination. If SSE2 is available 16 pixels are
+// processed at once, the remaining ones are handled by the plain C loops.
+
+static inline void SetPixel32(uchar *dst, uchar Grey)
+{
+  dst[0] = Grey;                // B_RGB32 is stored as blue, green, red, alpha
+  dst[1] = Grey;
+  dst[2] = Grey;
+  dst[3] = 255;
+}
+
+static void MinRow8(uchar *dst, const uchar *src, int32 n)
+{
+#if defined (__SSE2__)
+  for (; n >= 16; n -= 16, dst += 16, src += 16)
+    _mm_storeu_si128((__m128i *)dst, _mm_min_epu8(_mm_loadu_si128((const __m128i *)dst),
+                                                  _mm_loadu_si128((const __m128i *)src)));
+#endif
+
+  for (; n > 0; n--, dst++, src++)
+    if (*src < *dst)
+      *dst = *src;
+}
+
+static void OverRow8(uchar *dst, const uchar *src, int32 n)
+{
+#if defined (__SSE2__)
+  const __m128i White = _mm_set1_epi8((char)255);
+
+  for (; n >= 16; n -= 16, dst += 16, src += 16)
+  {
+    __m128i s    = _mm_loadu_si128((const __m128i *)src);
+    __m128i Mask = _mm_cmpeq_epi8(s, White);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_and_si128(Mask, _mm_loadu_si128((const __m128i *)dst)),
+                                                  _mm_andnot_si128(Mask, s)));
+  }
+#endif
+
+  for (; n > 0; n--, dst++, src++)
+    if (*src != 255)
+      *dst = *src;
+}
+
+static void MinRow32(uchar *dst, const uchar *src, int32 n)
+{
+#if defined (__SSE2__)
+  const __m128i Alpha = _mm_set1_epi32(0xff000000);
+
+  for (; n >= 16; n -= 16, dst += 64, src += 16)
+  {
+    __m128i s  = _mm_loadu_si128((const __m128i *)src);
+    __m128i lo = _mm_unpacklo_epi8(s, s);
+    __m128i hi = _mm_unpackhi_epi8(s, s);
+
+    _mm_storeu_si128((__m128i *)dst,        _mm_min_epu8(_mm_loadu_si128((const __m128i *)dst),
+                                                         _mm_or_si128(_mm_unpacklo_epi16(lo, lo), Alpha)));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_min_epu8(_mm_loadu_si128((const __m128i *)(dst + 16)),
+                                                         _mm_or_si128(_mm_unpackhi_epi16(lo, lo), Alpha)));
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_min_epu8(_mm_loadu_si128((const __m128i *)(dst + 32)),
+                                                         _mm_or_si128(_mm_unpacklo_epi16(hi, hi), Alpha)));
+    _mm_storeu_si128((__m128i *)(dst + 48), _mm_min_epu8(_mm_loadu_si128((const __m128i *)(dst + 48)),
+                                                         _mm_or_si128(_mm_unpackhi_epi16(hi, hi), Alpha)));
+  }
+#endif
+
+  for (; n > 0; n--, dst += 4, src++)
+  {
+    if (*src < dst[0]) dst[0] = *src;
+    if (*src < dst[1]) dst[1] = *src;
+    if (*src < dst[2]) dst[2] = *src;
+  }
+}
+
+static void OverRow32(uchar *dst, const uchar *src, int32 n)
+{
+  for (; n > 0; n--, dst += 4, src++)
+    if (*src != 255)
+      SetPixel32(dst, *src);
+}
+
+
+/* downsampling ***************************************************************************************************/
+
+
+// Adds `Weight' times the darkness (255 minus the grey value) of `n' pixels to `sum'. The products fit into 16
+// bits, so with SSE2 16 pixels are weighted at once.
+
+static void AccumulateRow(uint32 *sum, const uchar *src, int32 n, uint32 Weight)
+{
+#if defined (__SSE2__)
+  const __m128i Zero  = _mm_setzero_si128();
+  const __m128i White = _mm_set1_epi8((char)255);
+  const __m128i w     = _mm_set1_epi16((short)Weight);
+
+  for (; n >= 16; n -= 16, sum += 16, src += 16)
+  {
+    __m128i d  = _mm_xor_si128(_mm_loadu_si128((const __m128i *)src), White);
+    __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, Zero), w);
+    __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, Zero), w);
+
+    _mm_storeu_si128((__m128i *)sum,        _mm_add_epi32(_mm_loadu_si128((const __m128i *)sum),
+                                                          _mm_unpacklo_epi16(lo, Zero)));
+    _mm_storeu_si128((__m128i *)(sum + 4),  _mm_add_epi32(_mm_loadu_si128((const __m128i *)(sum + 4)),
+                                                          _mm_unpackhi_epi16(lo, Zero)));
+    _mm_storeu_si128((__m128i *)(sum + 8),  _mm_add_epi32(_mm_loadu_si128((const __m128i *)(sum + 8)),
+                                                          _mm_unpacklo_epi16(hi, Zero)));
+    _mm_storeu_si128((__m128i *)(sum + 12), _mm_add_epi32(_mm_loadu_si128((const __m128i *)(sum + 12)),
+                                                          _mm_unpackhi_epi16(hi, Zero)));
+  }
+#endif
+
+  for (; n > 0; n--, sum++, src++)
+    *sum += Weight * (255 - *src);
+}
+
+
+/* PageBuffer *****************************************************************************************************/
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageBuffer::PageBuffer(int32 width, int32 height, Format fmt = Grey8)                                          //
+//                                                                                                                //
+// Allocates a page buffer.                                                                                       //
+//                                                                                                                //
+// int32  width, height                 size of the buffer in pixels                                              //
+// Format fmt                           pixel format                                                              //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageBuffer::PageBuffer(int32 width, int32 height, Format fmt):
+  Bits(NULL),
+  Width(width),
+  Height(height),
+  BytesPerRow(fmt == RGB32 ? 4 * width : (width + 3) & ~3),
+  ColourSpace(fmt),
+  OwnBits(true)
+{
+  InitTables();
+
+  try
+  {
+    Bits = new uchar[BytesPerRow * Height];
+  }
+  catch(...)
+  {
+    log_error("not enough memory!");
+
+    Bits = NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageBuffer::PageBuffer(void *bits, int32 width, int32 height, int32 bpr, Format fmt)                           //
+//                                                                                                                //
+// Creates a page buffer using memory of someone else, e.g., the bits of a BBitmap.                               //
+//                                                                                                                //
+// void   *bits                         pixel data, isn't freed by the buffer                                     //
+// int32  width, height                 size of the buffer in pixels                                              //
+// int32  bpr                           bytes per row                                                             //
+// Format fmt                           pixel format                                                              //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageBuffer::PageBuffer(void *bits, int32 width, int32 height, int32 bpr, Format fmt):
+  Bits((uchar *)bits),
+  Width(width),
+  Height(height),
+  BytesPerRow(bpr),
+  ColourSpace(fmt),
+  OwnBits(false)
+{
+  InitTables();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageBuffer::~PageBuffer()                                                                                      //
+//                                                                                                                //
+// Deletes a page buffer.                                                                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageBuffer::~PageBuffer()
+{
+  if (OwnBits)
+    delete [] Bits;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::InitTables()                                                                                  //
+//                                                                                                                //
+// Initializes the tables converting between grey values and the colour indices of B_COLOR_8_BIT bitmaps. In      //
+// headless mode there is no colour map and both tables are the identity.                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::InitTables()
+{
+  static int32 TableInitialized = 0;
+
+  if (atomic_add(&TableInitialized, 1) < 1)
+  {
+    if (Headless)
+    {
+      for (int i = 0; i < 256; i++)
+      {
+        GreyTable[i]  = i;
+        IndexTable[i] = i;
+      }
+    }
+    else
+    {
+      const color_map *cm = system_colors();
+
+      for (int i = 0; i < 256; i++)
+      {
+        GreyTable[i]  = (77 * cm->color_list[i].red + 151 * cm->color_list[i].green + 28 * cm->color_list[i].blue) >> 8;
+        IndexTable[i] = cm->index_map[((i >> 3) << 10) | ((i >> 3) << 5) | (i >> 3)];
+      }
+    }
+  }
+  else
+    atomic_add(&TableInitialized, -1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::Clear(uchar Grey = 255)                                                                       //
+//                                                                                                                //
+// Fills the whole buffer.                                                                                        //
+//                                                                                                                //
+// uchar Grey                           grey value to fill with                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::Clear(uchar Grey)
+{
+  FillRect(0, 0, Width - 1, Height - 1, Grey);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::FillRect(int32 left, int32 top, int32 right, int32 bottom, uchar Grey = 0)                    //
+//                                                                                                                //
+// Fills a rectangle. Each row is filled as one span.                                                             //
+//                                                                                                                //
+// int32 left, top, right, bottom       rectangle (inclusive)                                                     //
+// uchar Grey                           grey value to fill with                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::FillRect(int32 left, int32 top, int32 right, int32 bottom, uchar Grey)
+{
+  uchar *p;
+  int32 i;
+
+  if (left   < 0)       left   = 0;
+  if (top    < 0)       top    = 0;
+  if (right  >= Width)  right  = Width  - 1;
+  if (bottom >= Height) bottom = Height - 1;
+
+  if (left > right || top > bottom)
+    return;
+
+  p = Bits + top * BytesPerRow;
+
+  if (ColourSpace == Grey8)
+  {
+    for (; top <= bottom; top++, p += BytesPerRow)
+      memset(p + left, Grey, right - left + 1);
+  }
+  else
+  {
+    // fill first row and copy it to the others
+
+    for (i = left; i <= right; i++)
+      SetPixel32(p + 4 * i, Grey);
+
+    for (i = top + 1, p += BytesPerRow; i <= bottom; i++, p += BytesPerRow)
+      memcpy(p + 4 * left, p - (i - top) * BytesPerRow + 4 * left, 4 * (right - left + 1));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::StrokeDashed(int32 x0, int32 y0, int32 x1, int32 y1)                                          //
+//                                                                                                                //
+// Draws a dashed horizontal or vertical line with the same pattern DVI::Draw uses for the border lines.          //
+//                                                                                                                //
+// int32 x0, y0                         start point                                                               //
+// int32 x1, y1                         end point                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::StrokeDashed(int32 x0, int32 y0, int32 x1, int32 y1)
+{
+  int32 x, y;
+
+  for (y = y0; y <= y1; y++)
+    for (x = x0; x <= x1; x++)
+      if ((((x >> 2) ^ (y >> 2)) & 1) == 0)
+        FillRect(x, y, x, y, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::DrawBitmap(const BBitmap *bm, int32 x, int32 y, BlendMode Mode)                               //
+//                                                                                                                //
+// Composites a glyph into the buffer. Monochrome bitmaps are always drawn in black.                              //
+//                                                                                                                //
+// const BBitmap *bm                    B_MONOCHROME_1_BIT or B_GRAYSCALE_8_BIT bitmap                            //
+// int32         x, y                   position of the upper left corner                                         //
+// BlendMode     Mode                   how 8 bit bitmaps are combined with the buffer                            //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::DrawBitmap(const BBitmap *bm, int32 x, int32 y, BlendMode Mode)
+{
+  if (bm->ColorSpace() == B_MONOCHROME_1_BIT)
+    DrawMonochrome(bm, x, y);
+  else
+    DrawGrey(bm, x, y, Mode);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::DrawMonochrome(const BBitmap *bm, int32 x, int32 y)                                           //
+//                                                                                                                //
+// Sets all pixels of the buffer to black where the bitmap has bits set.                                          //
+//                                                                                                                //
+// const BBitmap *bm                    B_MONOCHROME_1_BIT bitmap                                                 //
+// int32         x, y                   position of the upper left corner                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::DrawMonochrome(const BBitmap *bm, int32 x, int32 y)
+{
+  const uchar *src;
+  uchar       *dst;
+  int32       sx, sy, w, h;
+  int32       i, j, bit;
+  int32       SrcBPR = bm->BytesPerRow();
+
+  sx = 0;
+  sy = 0;
+  w  = bm->Bounds().IntegerWidth()  + 1;
+  h  = bm->Bounds().IntegerHeight() + 1;
+
+  if (x < 0)              { sx = -x; w += x; x = 0; }
+  if (y < 0)              { sy = -y; h += y; y = 0; }
+  if (x + w > Width)      w = Width  - x;
+  if (y + h > Height)     h = Height - y;
+
+  if (w <= 0 || h <= 0)
+    return;
+
+  src = (const uchar *)bm->Bits() + sy * SrcBPR;
+  dst = Bits + y * BytesPerRow;
+
+  for (j = 0; j < h; j++, src += SrcBPR, dst += BytesPerRow)
+  {
+    for (i = 0; i < w; )
+    {
+      bit = sx + i;
+
+      if ((bit & 7) == 0 && i + 8 <= w && src[bit >> 3] == 0)   // skip empty bytes
+      {
+        i += 8;
+        continue;
+      }
+      if (src[bit >> 3] & (0x80 >> (bit & 7)))
+      {
+        if (ColourSpace == Grey8)
+          dst[x + i] = 0;
+        else
+          SetPixel32(dst + 4 * (x + i), 0);
+      }
+      i++;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::DrawGrey(const BBitmap *bm, int32 x, int32 y, BlendMode Mode)                                 //
+//                                                                                                                //
+// Composites an 8 bit bitmap into the buffer. The glyphs store grey values, so they are blended as they are.     //
+//                                                                                                                //
+// const BBitmap *bm                    B_GRAYSCALE_8_BIT bitmap                                                  //
+// int32         x, y                   position of the upper left corner                                         //
+// BlendMode     Mode                   blending mode                                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::DrawGrey(const BBitmap *bm, int32 x, int32 y, BlendMode Mode)
+{
+  const uchar *src;
+  uchar       *dst;
+  int32       sx, sy, w, h;
+  int32       j;
+  int32       SrcBPR = bm->BytesPerRow();
+
+  sx = 0;
+  sy = 0;
+  w  = bm->Bounds().IntegerWidth()  + 1;
+  h  = bm->Bounds().IntegerHeight() + 1;
+
+  if (x < 0)              { sx = -x; w += x; x = 0; }
+  if (y < 0)              { sy = -y; h += y; y = 0; }
+  if (x + w > Width)      w = Width  - x;
+  if (y + h > Height)     h = Height - y;
+
+  if (w <= 0 || h <= 0)
+    return;
+
+  src = (const uchar *)bm->Bits() + sy * SrcBPR + sx;
+  dst = Bits + y * BytesPerRow;
+
+  for (j = 0; j < h; j++, src += SrcBPR, dst += BytesPerRow)
+  {
+    if (ColourSpace == Grey8)
+      if (Mode == BlendMin)
+        MinRow8(dst + x, src, w);
+      else
+        OverRow8(dst + x, src, w);
+    else
+      if (Mode == BlendMin)
+        MinRow32(dst + 4 * x, src, w);
+      else
+        OverRow32(dst + 4 * x, src, w);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool PageBuffer::Downsample(const PageBuffer *Source, int32 Shrink, bool AntiAliasing)                         //
+//                                                                                                                //
+// Shrinks a whole page into the buffer with a box filter: each pixel gets the average of the part of the source  //
+// it covers (area averaging), so rules and overlapping glyphs are smoothed like everything else. Like            //
+// `Glyph::Resample()' the weights are given in 1/256 of a pixel and the factor needn't be an integer. The rows   //
+// of the source belonging to a row of the buffer are summed up first, which is done with SSE2 if available.      //
+//                                                                                                                //
+// const PageBuffer *Source             unshrunken page, must be `Grey8'                                          //
+// int32            Shrink              shrink factor as 16.16 fixed point number (see `DrawSettings::Shrink')    //
+// bool             AntiAliasing        whether grey pixels are used; otherwise a pixel is set if at least 40%    //
+//                                      of it are covered                                                         //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool PageBuffer::Downsample(const PageBuffer *Source, int32 Shrink, bool AntiAliasing)
+{
+  typedef vector<int32,  allocator<int32> >  IndexList;
+  typedef vector<uint16, allocator<uint16> > WeightList;
+  typedef vector<uint32, allocator<uint32> > SumList;
+
+  IndexList  ColIndex;               // column of the buffer a column of the source starts in
+  WeightList ColWeight;              // part of the source column inside that column
+  SumList    ColSum;                 // darkness of the source columns within one row of the buffer
+  SumList    Acc;                    // darkness of the pixels of one row of the buffer
+  uchar      *dst;
+  uint32     Area;
+  uint32     Dark;
+  uint32     w;
+  int32      Edge;
+  int32      Top, Bottom;            // part of the source covered by a row of the buffer (16.16)
+  int32      SrcWidth;
+  int32      x, y, Y, d;
+
+  if (Source->ColourSpace != Grey8 || Shrink < 0x10000)
+    return false;
+
+  try
+  {
+    for (x = 0, d = 0, Edge = Shrink; x < Source->Width; x++)
+    {
+      while (Edge <= (x << 16))
+      {
+        d++;
+        Edge += Shrink;
+      }
+      if (d >= Width)
+        break;
+
+      ColIndex.push_back(d);
+      ColWeight.push_back(Edge >= ((x + 1) << 16) ? 256 : (Edge - (x << 16)) >> 8);
+    }
+
+    SrcWidth = ColIndex.size();
+
+    ColSum.resize(SrcWidth);
+    Acc.resize(Width + 1);
+
+    // a pixel consists of (Shrink / 256)^2 weights; with `Glyph::MaxShrinkFactor' 255 times that fits in 32 bits
+
+    Area = (uint32)(Shrink >> 8) * (uint32)(Shrink >> 8);
+
+    for (Y = 0, dst = Bits; Y < Height; Y++, dst += BytesPerRow)
+    {
+      Top    = Y * Shrink;
+      Bottom = Top + Shrink;
+
+      for (x = 0; x < SrcWidth; x++)
+        ColSum[x] = 0;
+
+      for (y = Top >> 16; y < Source->Height && (y << 16) < Bottom; y++)
+      {
+        w = (min_c((y + 1) << 16, Bottom) - max_c(y << 16, Top)) >> 8;
+
+        if (w > 0 && SrcWidth > 0)
+          AccumulateRow(&ColSum[0], Source->Bits + y * Source->BytesPerRow, SrcWidth, w);
+      }
+
+      for (x = 0; x <= Width; x++)
+        Acc[x] = 0;
+
+      for (x = 0; x < SrcWidth; x++)
+        if (ColSum[x])
+        {
+          Acc[ColIndex[x]]     += ColWeight[x] * ColSum[x];
+          Acc[ColIndex[x] + 1] += (256 - ColWeight[x]) * ColSum[x];
+        }
+
+      for (x = 0; x < Width; x++)
+      {
+        Dark = min_c((Acc[x] + Area / 2) / Area, 255);
+
+        if (!AntiAliasing)
+          Dark = (Dark >= 102 ? 255 : 0);
+
+        if (ColourSpace == Grey8)
+          dst[x] = 255 - Dark;
+        else
+          SetPixel32(dst + 4 * x, 255 - Dark);
+      }
+    }
+  }
+  catch(...)
+  {
+    log_error("not enough memory!");
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageBuffer::CopyTo(BBitmap *bm) const                                                                     //
+//                                                                                                                //
+// Copies a `Grey8' buffer into a bitmap of the same size. This is the only place where the grey values are       //
+// converted to the colour space of the bitmap.                                                                   //
+//                                                                                                                //
+// BBitmap *bm                          B_GRAYSCALE_8_BIT, B_COLOR_8_BIT or B_RGB_32_BIT bitmap                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageBuffer::CopyTo(BBitmap *bm) const
+{
+  const uchar *src;
+  uchar       *dst;
+  int32       DstBPR = bm->BytesPerRow();
+  int32       w, h;
+  int32       x, y;
+
+  if (ColourSpace != Grey8)
+    return;
+
+  w = min_c(Width,  bm->Bounds().IntegerWidth()  + 1);
+  h = min_c(Height, bm->Bounds().IntegerHeight() + 1);
+
+  src = Bits;
+  dst = (uchar *)bm->Bits();
+
+  for (y = 0; y < h; y++, src += BytesPerRow, dst += DstBPR)
+    switch (bm->ColorSpace())
+    {
+      case B_GRAYSCALE_8_BIT:
+        memcpy(dst, src, w);
+        break;
+
+      case B_COLOR_8_BIT:
+        for (x = 0; x < w; x++)
+          dst[x] = IndexTable[src[x]];
+        break;
+
+      case B_RGB_32_BIT:
+        for (x = 0; x < w; x++)
+          SetPixel32(dst + 4 * x, src[x]);
+        break;
+
+      default:
+        return;
+    }
+}
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PAGEBUFFER_H
+#define PAGEBUFFER_H
+
+#ifndef _BITMAP_H
+#include <interface/Bitmap.h>
+#endif
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+// software compositor drawing into a block of memory
+
+class PageBuffer
+{
+  public:
+    enum Format
+    {
+      Grey8,                 // one byte per pixel, 0 is black, 255 is white
+      RGB32                  // B_RGB32
+    };
+
+    enum BlendMode
+    {
+      BlendOver,             // copy all pixels which aren't white
+      BlendMin               // keep the darker one of source and destination
+    };
+
+    static bool  Headless;        // don't use the app_server
+    static uchar GreyTable[256];  // converts colour indices to grey values
+    static uchar IndexTable[256]; // converts grey values to colour indices
+
+    uchar  *Bits;
+    int32  Width;
+    int32  Height;
+    int32  BytesPerRow;
+    Format ColourSpace;
+
+  private:
+    bool   OwnBits;
+
+  public:
+    PageBuffer(int32 width, int32 height, Format fmt = Grey8);
+    PageBuffer(void *bits, int32 width, int32 height, int32 bpr, Format fmt);
+    ~PageBuffer();
+
+    static void InitTables();
+
+    void Clear(uchar Grey = 255);
+    void FillRect(int32 left, int32 top, int32 right, int32 bottom, uchar Grey = 0);
+    void StrokeDashed(int32 x0, int32 y0, int32 x1, int32 y1);
+    void DrawBitmap(const BBitmap *bm, int32 x, int32 y, BlendMode Mode);
+    bool Downsample(const PageBuffer *Source, int32 Shrink, bool AntiAliasing);
+    void CopyTo(BBitmap *bm) const;
+
+    bool Ok() const
+    {
+      return Bits != NULL;
+    }
+
+  private:
+    void DrawMonochrome(const BBitmap *bm, int32 x, int32 y);
+    void DrawGrey(const BBitmap *bm, int32 x, int32 y, BlendMode Mode);
+};
+
+#endif
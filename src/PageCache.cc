@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "PageCache.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageCache::PageCache(size_t max)                                                                               //
+//                                                                                                                //
+// Initializes an empty page cache.                                                                               //
+//                                                                                                                //
+// size_t max                           maximal size of all bitmaps in bytes                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageCache::PageCache(size_t max):
+  Pages(),
+  MaxMemory(max),
+  Memory(0)
+{}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// PageCache::~PageCache()                                                                                        //
+//                                                                                                                //
+// Deletes a page cache.                                                                                          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PageCache::~PageCache()
+{
+  Flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// BBitmap *PageCache::Find(const PageKey &k)                                                                     //
+//                                                                                                                //
+// Looks up a page and marks it as recently used.                                                                 //
+//                                                                                                                //
+// const PageKey &k                     page and settings it was drawn with                                       //
+//                                                                                                                //
+// Result:                              bitmap of the page or `NULL' if it isn't in the cache                     //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BBitmap *PageCache::Find(const PageKey &k)
+{
+  PageList::iterator i;
+  Page               p;
+
+  for (i = Pages.begin(); i != Pages.end(); i++)
+    if (i->Key == k)
+    {
+      p = *i;
+
+      if (i != Pages.begin())
+      {
+        Pages.erase(i);
+        Pages.push_front(p);
+      }
+      return p.Bitmap;
+    }
+
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool PageCache::Insert(const PageKey &k, BBitmap *bm)                                                          //
+//                                                                                                                //
+// Adds a page to the cache. The least recently used pages are deleted until the bitmaps fit into the memory      //
+// limit. The cache takes ownership of the bitmap. The page must not be in the cache already.                     //
+//                                                                                                                //
+// const PageKey &k                     page and settings it was drawn with                                       //
+// BBitmap       *bm                    bitmap of the page                                                        //
+//                                                                                                                //
+// Result:                              `true' if the page was added, `false' if it is too large                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool PageCache::Insert(const PageKey &k, BBitmap *bm)
+{
+  Page   p;
+  size_t Size = bm->BitsLength();
+
+  if (Size > MaxMemory)
+  {
+    delete bm;
+    return false;
+  }
+
+  while (!Pages.empty() && Memory + Size > MaxMemory)
+  {
+    Memory -= Pages.back().Bitmap->BitsLength();
+
+    delete Pages.back().Bitmap;
+    Pages.pop_back();
+  }
+
+  p.Key    = k;
+  p.Bitmap = bm;
+
+  Pages.push_front(p);
+
+  Memory += Size;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageCache::Flush()                                                                                        //
+//                                                                                                                //
+// Deletes all pages.                                                                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageCache::Flush()
+{
+  while (!Pages.empty())
+  {
+    delete Pages.front().Bitmap;
+    Pages.pop_front();
+  }
+  Memory = 0;
+}
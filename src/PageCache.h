@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <InterfaceKit.h>
+#include <list.h>
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+// identifies a rendered page
+
+struct PageKey
+{
+  uint   PageNo;
+  int32  Shrink;
+  bool   AntiAliasing;
+  bool   BorderLine;
+
+  bool operator == (const PageKey &k) const
+  {
+    return PageNo       == k.PageNo       &&
+           Shrink       == k.Shrink       &&
+           AntiAliasing == k.AntiAliasing &&
+           BorderLine   == k.BorderLine;
+  }
+};
+
+// cache of completely rendered pages
+
+class PageCache
+{
+  private:
+    struct Page
+    {
+      PageKey Key;
+      BBitmap *Bitmap;
+    };
+
+    typedef list<Page, allocator<Page> > PageList;
+
+    PageList Pages;            // most recently used first
+    size_t   MaxMemory;
+    size_t   Memory;           // size of all bitmaps
+
+  public:
+    PageCache(size_t max);
+    ~PageCache();
+
+    BBitmap *Find(const PageKey &k);
+    bool    Insert(const PageKey &k, BBitmap *bm);
+    void    Flush();
+};
+
+#endif
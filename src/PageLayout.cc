@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PageLayout.h"
+#include "TeXFont.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageLayout::AddChar(Font *f, wchar c, const Glyph *g, long horiz, long vert)                              //
+//                                                                                                                //
+// Appends a character to the layout. The metrics of the glyph must be known.                                     //
+//                                                                                                                //
+// Font        *f                       font                                                                      //
+// wchar       c                        character                                                                 //
+// const Glyph *g                       glyph of the character                                                    //
+// long        horiz, vert              position of the reference point                                           //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageLayout::AddChar(Font *f, wchar c, const Glyph *g, long horiz, long vert)
+{
+  LayoutItem item;
+  BRect      r;
+
+  item.Fnt     = f;
+  item.Char    = c;
+  item.DrawDir = 1;
+  item.Horiz   = horiz;
+  item.Vert    = vert;
+  item.Width   = 0;
+  item.Height  = 0;
+
+  r.left   = (horiz >> 16) - g->Ux;
+  r.top    = (vert  >> 16) - g->Uy;
+  r.right  = r.left + g->UWidth;
+  r.bottom = r.top  + g->UHeight;
+
+  Add(item, r);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageLayout::AddRule(long horiz, long vert, long w, long h, int dir)                                       //
+//                                                                                                                //
+// Appends a rule to the layout.                                                                                  //
+//                                                                                                                //
+// long horiz, vert                     position of the lower left corner                                         //
+// long w, h                            size of the rule                                                          //
+// int  dir                             drawing direction                                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageLayout::AddRule(long horiz, long vert, long w, long h, int dir)
+{
+  LayoutItem item;
+  BRect      r;
+
+  item.Fnt     = NULL;
+  item.Char    = 0;
+  item.DrawDir = dir;
+  item.Horiz   = horiz;
+  item.Vert    = vert;
+  item.Width   = w;
+  item.Height  = h;
+
+  r.left   = (horiz >> 16) - (dir < 0 ? (w >> 16) + 1 : 0);
+  r.right  = (horiz >> 16) + (dir < 0 ? 0 : (w >> 16) + 1);
+  r.top    = (vert  >> 16) - (h >> 16) - 1;
+  r.bottom = (vert  >> 16) + 1;
+
+  Add(item, r);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void PageLayout::Add(const LayoutItem &item, const BRect &r)                                                   //
+//                                                                                                                //
+// Appends an item and updates the bounding boxes. A new run is started at every change of the baseline.          //
+//                                                                                                                //
+// const LayoutItem &item               item to be added                                                          //
+// const BRect      &r                  its bounding box in unshrunk pixels                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PageLayout::Add(const LayoutItem &item, const BRect &r)
+{
+  if (Runs.empty() ||
+      Runs.back().Count >= MaxRunLength ||
+      Items[Runs.back().First].Vert != item.Vert)
+  {
+    LayoutRun run;
+
+    run.Bounds = r;
+    run.First  = Items.size();
+    run.Count  = 0;
+
+    Runs.push_back(run);
+  }
+  else
+    Runs.back().Bounds = Runs.back().Bounds | r;
+
+  Runs.back().Count++;
+
+  if (Items.empty())
+    Bounds = r;
+  else
+    Bounds = Bounds | r;
+
+  Items.push_back(item);
+}
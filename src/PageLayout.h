@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PAGELAYOUT_H
+#define PAGELAYOUT_H
+
+#include <InterfaceKit.h>
+#include <vector.h>
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+class Font;
+class Glyph;
+
+// a character or rule placed on a page; positions are in unshrunk pixels << 16
+
+struct LayoutItem
+{
+  Font  *Fnt;         // font of the character or `NULL' for a rule
+  wchar Char;
+  short DrawDir;      // direction of a rule
+  long  Horiz;
+  long  Vert;
+  long  Width;        // size of a rule
+  long  Height;
+};
+
+// consecutive items on the same baseline
+
+struct LayoutRun
+{
+  BRect Bounds;       // in unshrunk pixels
+  uint  First;
+  uint  Count;
+};
+
+// everything on a page which doesn't depend on the shrink factor
+
+class PageLayout
+{
+  public:
+    enum
+    {
+      MaxRunLength = 64
+    };
+
+    typedef vector<LayoutItem, allocator<LayoutItem> > ItemList;
+    typedef vector<LayoutRun,  allocator<LayoutRun> >  RunList;
+
+    ItemList Items;
+    RunList  Runs;
+    BRect    Bounds;          // bounding box of all items in unshrunk pixels
+    bool     HasSpecials;     // page contains \special commands
+
+    PageLayout():
+      HasSpecials(false)
+    {}
+
+    void AddChar(Font *f, wchar c, const Glyph *g, long horiz, long vert);
+    void AddRule(long horiz, long vert, long w, long h, int dir);
+
+    size_t MemoryUsage() const
+    {
+      return sizeof(*this) + Items.capacity() * sizeof(LayoutItem) + Runs.capacity() * sizeof(LayoutRun);
+    }
+
+  private:
+    void Add(const LayoutItem &item, const BRect &r);
+};
+
+#endif
@@ -0,0 +1,533 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <InterfaceKit.h>
+#include <math.h>
+#include <stdlib.h>
+#include "defines.h"
+#include "RenderTarget.h"
+
+static const uchar PlaceholderGrey = 192;     // grey level of characters which haven't been unpacked yet
+
+
+/* ViewTarget *****************************************************************************************************/
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// ViewTarget::~ViewTarget()                                                                                      //
+//                                                                                                                //
+// Frees the converted glyphs.                                                                                    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ViewTarget::~ViewTarget()
+{
+  BitmapMap::iterator i;
+
+  for (i = Converted.begin(); i != Converted.end(); i++)
+    delete i->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// BRect ViewTarget::Bounds()                                                                                     //
+//                                                                                                                //
+// Returns the area which can be drawn into.                                                                      //
+//                                                                                                                //
+// Result:                              bounds of the view                                                        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BRect ViewTarget::Bounds()
+{
+  return vw->Bounds();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// BView *ViewTarget::View()                                                                                      //
+//                                                                                                                //
+// Returns the view used for drawing. GhostScript needs this to output its pictures.                              //
+//                                                                                                                //
+// Result:                              the view                                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BView *ViewTarget::View()
+{
+  return vw;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::Begin(bool MinBlend)                                                                          //
+//                                                                                                                //
+// Clears the view and prepares it for drawing a page.                                                            //
+//                                                                                                                //
+// bool MinBlend                        `true' if glyphs should be combined with B_OP_MIN instead of B_OP_OVER    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::Begin(bool MinBlend)
+{
+  Min = MinBlend;
+
+  vw->PushState();
+
+  vw->SetHighColor( 0,   0,   0, 255);
+  vw->SetLowColor(255, 255, 255, 255);
+
+  vw->SetDrawingMode(B_OP_COPY);
+  vw->FillRect(vw->Bounds(), B_SOLID_LOW);
+
+  vw->SetDrawingMode(Min ? B_OP_MIN : B_OP_OVER);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::End()                                                                                         //
+//                                                                                                                //
+// Finishes drawing a page.                                                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::End()
+{
+  vw->Sync();
+  vw->PopState();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::DrawGlyph(const BBitmap *bm, int32 x, int32 y)                                                //
+//                                                                                                                //
+// Draws a glyph. The app_server can't draw B_GRAYSCALE_8_BIT bitmaps, so grey glyphs are converted to the colour //
+// map the first time they are drawn. The copies are kept until the target is destroyed since the bitmaps are     //
+// drawn asynchronously.                                                                                          //
+//                                                                                                                //
+// const BBitmap *bm                    bitmap of the glyph                                                       //
+// int32         x, y                   position of the upper left corner                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::DrawGlyph(const BBitmap *bm, int32 x, int32 y)
+{
+  BitmapMap::iterator i;
+  BBitmap             *Colour;
+
+  if (bm->ColorSpace() == B_GRAYSCALE_8_BIT)
+  {
+    if ((i = Converted.find(bm)) != Converted.end())
+      bm = i->second;
+    else
+    {
+      PageBuffer Grey(bm->Bits(), bm->Bounds().IntegerWidth() + 1, bm->Bounds().IntegerHeight() + 1,
+                      bm->BytesPerRow(), PageBuffer::Grey8);
+
+      if ((Colour = new BBitmap(bm->Bounds(), B_COLOR_8_BIT)) == NULL)
+        return;
+
+      if (!Colour->IsValid())
+      {
+        delete Colour;
+        return;
+      }
+
+      Grey.CopyTo(Colour);
+
+      Converted[bm] = Colour;
+      bm            = Colour;
+    }
+  }
+
+  vw->DrawBitmapAsync(bm, BPoint(x, y));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::FillRule(const BRect &r)                                                                      //
+//                                                                                                                //
+// Draws a rule.                                                                                                  //
+//                                                                                                                //
+// const BRect &r                       the rule                                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::FillRule(const BRect &r)
+{
+  vw->SetHighColor(0, 0, 0, 255);
+  vw->FillRect(r, B_SOLID_HIGH);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::FillPlaceholder(const BRect &r)                                                               //
+//                                                                                                                //
+// Draws a grey box in place of a character which hasn't been unpacked yet.                                       //
+//                                                                                                                //
+// const BRect &r                       bounding box of the character                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::FillPlaceholder(const BRect &r)
+{
+  vw->SetHighColor(PlaceholderGrey, PlaceholderGrey, PlaceholderGrey, 255);
+  vw->FillRect(r, B_SOLID_HIGH);
+  vw->SetHighColor(0, 0, 0, 255);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::BeginLineArray(int32 count)                                                                   //
+// void ViewTarget::AddLine(BPoint from, BPoint to)                                                               //
+// void ViewTarget::EndLineArray()                                                                                //
+//                                                                                                                //
+// Draw a set of black lines.                                                                                     //
+//                                                                                                                //
+// int32  count                         maximal number of lines                                                   //
+// BPoint from, to                      end points of a line                                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::BeginLineArray(int32 count)
+{
+  vw->BeginLineArray(count);
+}
+
+void ViewTarget::AddLine(BPoint from, BPoint to)
+{
+  const rgb_color black = {0, 0, 0, 255};
+
+  vw->AddLine(from, to, black);
+}
+
+void ViewTarget::EndLineArray()
+{
+  vw->EndLineArray();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::StrokeArc(BPoint center, float rx, float ry, float start, float arc)                          //
+//                                                                                                                //
+// Draws an elliptic arc.                                                                                         //
+//                                                                                                                //
+// BPoint center                        center of the ellipse                                                     //
+// float  rx, ry                        radii                                                                     //
+// float  start                         start angle in degrees                                                    //
+// float  arc                           length of the arc in degrees                                              //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::StrokeArc(BPoint center, float rx, float ry, float start, float arc)
+{
+  vw->StrokeArc(center, rx, ry, start, arc);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::StrokeRect(const BRect &r)                                                                    //
+//                                                                                                                //
+// Draws the outline of a rectangle.                                                                              //
+//                                                                                                                //
+// const BRect &r                       the rectangle                                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::StrokeRect(const BRect &r)
+{
+  vw->StrokeRect(r);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::StrokeDashed(BPoint from, BPoint to)                                                          //
+//                                                                                                                //
+// Draws a dashed line as used for the border lines.                                                              //
+//                                                                                                                //
+// BPoint from, to                      end points of the line                                                    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::StrokeDashed(BPoint from, BPoint to)
+{
+  pattern Dash = {0xf0, 0xf0, 0xf0, 0xf0, 0x0f, 0x0f, 0x0f, 0x0f};
+
+  vw->SetDrawingMode(B_OP_COPY);
+  vw->StrokeLine(from, to, Dash);
+  vw->SetDrawingMode(Min ? B_OP_MIN : B_OP_OVER);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void ViewTarget::Highlight(const BRect &r)                                                                     //
+//                                                                                                                //
+// Highlights found text.                                                                                         //
+//                                                                                                                //
+// const BRect &r                       position of a character                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ViewTarget::Highlight(const BRect &r)
+{
+  if (Min)
+  {
+    vw->SetHighColor(200, 200, 0, 255);
+    vw->FillRect(r, B_SOLID_HIGH);
+  }
+  else
+  {
+    vw->SetHighColor(200, 0, 0, 255);
+    vw->StrokeLine(r.LeftBottom(), r.RightBottom(), B_SOLID_HIGH);
+  }
+  vw->SetHighColor(0, 0, 0, 255);
+}
+
+
+/* MemoryTarget ***************************************************************************************************/
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// BRect MemoryTarget::Bounds()                                                                                   //
+//                                                                                                                //
+// Returns the area which can be drawn into.                                                                      //
+//                                                                                                                //
+// Result:                              bounds of the buffer                                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BRect MemoryTarget::Bounds()
+{
+  return BRect(OriginX, OriginY, OriginX + pb->Width - 1, OriginY + pb->Height - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::Begin(bool MinBlend)                                                                        //
+//                                                                                                                //
+// Clears the buffer.                                                                                             //
+//                                                                                                                //
+// bool MinBlend                        `true' if grey glyphs should be combined with a min blend                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::Begin(bool MinBlend)
+{
+  Mode = MinBlend ? PageBuffer::BlendMin : PageBuffer::BlendOver;
+
+  pb->Clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::End()                                                                                       //
+//                                                                                                                //
+// Finishes drawing a page.                                                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::End()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::DrawGlyph(const BBitmap *bm, int32 x, int32 y)                                              //
+//                                                                                                                //
+// Draws a glyph.                                                                                                 //
+//                                                                                                                //
+// const BBitmap *bm                    bitmap of the glyph                                                       //
+// int32         x, y                   position of the upper left corner                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::DrawGlyph(const BBitmap *bm, int32 x, int32 y)
+{
+  pb->DrawBitmap(bm, x - OriginX, y - OriginY, Mode);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::FillRule(const BRect &r)                                                                    //
+//                                                                                                                //
+// Draws a rule.                                                                                                  //
+//                                                                                                                //
+// const BRect &r                       the rule                                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::FillRule(const BRect &r)
+{
+  pb->FillRect((int32)r.left - OriginX, (int32)r.top - OriginY, (int32)r.right - OriginX, (int32)r.bottom - OriginY);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::FillPlaceholder(const BRect &r)                                                             //
+//                                                                                                                //
+// Draws a grey box in place of a character which hasn't been unpacked yet.                                       //
+//                                                                                                                //
+// const BRect &r                       bounding box of the character                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::FillPlaceholder(const BRect &r)
+{
+  pb->FillRect((int32)r.left - OriginX, (int32)r.top - OriginY, (int32)r.right - OriginX, (int32)r.bottom - OriginY,
+               PlaceholderGrey);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::BeginLineArray(int32 count)                                                                 //
+// void MemoryTarget::AddLine(BPoint from, BPoint to)                                                             //
+// void MemoryTarget::EndLineArray()                                                                              //
+//                                                                                                                //
+// Draw a set of black lines. The lines are drawn immediately with Bresenham's algorithm.                         //
+//                                                                                                                //
+// int32  count                         maximal number of lines                                                   //
+// BPoint from, to                      end points of a line                                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::BeginLineArray(int32 /* count */)
+{
+}
+
+void MemoryTarget::AddLine(BPoint from, BPoint to)
+{
+  int32 x0 = (int32)floor(from.x + 0.5) - OriginX;
+  int32 y0 = (int32)floor(from.y + 0.5) - OriginY;
+  int32 x1 = (int32)floor(to.x   + 0.5) - OriginX;
+  int32 y1 = (int32)floor(to.y   + 0.5) - OriginY;
+  int32 dx = abs(x1 - x0);
+  int32 dy = abs(y1 - y0);
+  int32 sx = x0 < x1 ? 1 : -1;
+  int32 sy = y0 < y1 ? 1 : -1;
+  int32 err;
+
+  if (dx == 0 || dy == 0)                                        // horizontal or vertical line: one span
+  {
+    pb->FillRect(min_c(x0, x1), min_c(y0, y1), max_c(x0, x1), max_c(y0, y1));
+    return;
+  }
+
+  err = dx - dy;
+
+  for (;;)
+  {
+    pb->FillRect(x0, y0, x0, y0);
+
+    if (x0 == x1 && y0 == y1)
+      break;
+
+    if (2 * err > -dy)
+    {
+      err -= dy;
+      x0  += sx;
+    }
+    if (2 * err < dx)
+    {
+      err += dx;
+      y0  += sy;
+    }
+  }
+}
+
+void MemoryTarget::EndLineArray()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::StrokeArc(BPoint center, float rx, float ry, float start, float arc)                        //
+//                                                                                                                //
+// Draws an elliptic arc by approximating it with lines. Angles are measured counter-clockwise like in BView.     //
+//                                                                                                                //
+// BPoint center                        center of the ellipse                                                     //
+// float  rx, ry                        radii                                                                     //
+// float  start                         start angle in degrees                                                    //
+// float  arc                           length of the arc in degrees                                              //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::StrokeArc(BPoint center, float rx, float ry, float start, float arc)
+{
+  int    Steps;
+  int    i;
+  double a;
+  BPoint Last;
+  BPoint p;
+
+  Steps = (int)((fabs(rx) + fabs(ry)) * fabs(arc) / 90.0) + 4;
+
+  for (i = 0; i <= Steps; i++)
+  {
+    a = (start + arc * i / Steps) * PI / 180.0;
+    p = BPoint(center.x + rx * cos(a), center.y - ry * sin(a));
+
+    if (i > 0)
+      AddLine(Last, p);
+
+    Last = p;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::StrokeRect(const BRect &r)                                                                  //
+//                                                                                                                //
+// Draws the outline of a rectangle.                                                                              //
+//                                                                                                                //
+// const BRect &r                       the rectangle                                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::StrokeRect(const BRect &r)
+{
+  AddLine(r.LeftTop(),     r.RightTop());
+  AddLine(r.LeftBottom(),  r.RightBottom());
+  AddLine(r.LeftTop(),     r.LeftBottom());
+  AddLine(r.RightTop(),    r.RightBottom());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::StrokeDashed(BPoint from, BPoint to)                                                        //
+//                                                                                                                //
+// Draws a dashed horizontal or vertical line as used for the border lines.                                       //
+//                                                                                                                //
+// BPoint from, to                      end points of the line                                                    //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::StrokeDashed(BPoint from, BPoint to)
+{
+  pb->StrokeDashed((int32)from.x - OriginX, (int32)from.y - OriginY, (int32)to.x - OriginX, (int32)to.y - OriginY);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void MemoryTarget::Highlight(const BRect &r)                                                                   //
+//                                                                                                                //
+// Highlights found text. Without colours we just underline it.                                                   //
+//                                                                                                                //
+// const BRect &r                       position of a character                                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryTarget::Highlight(const BRect &r)
+{
+  pb->FillRect((int32)r.left - OriginX, (int32)r.bottom - OriginY, (int32)r.right - OriginX, (int32)r.bottom - OriginY);
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDERTARGET_H
+#define RENDERTARGET_H
+
+#include <InterfaceKit.h>
+#include <map>
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+#ifndef PAGEBUFFER_H
+#include "PageBuffer.h"
+#endif
+
+// output device of the DVI interpreter
+
+class RenderTarget
+{
+  public:
+    virtual ~RenderTarget() {}
+
+    virtual BRect Bounds()                                                       = 0;
+    virtual BView *View()                                                        { return NULL; }
+
+    virtual void  Begin(bool MinBlend)                                           = 0;
+    virtual void  End()                                                          = 0;
+
+    virtual void  DrawGlyph(const BBitmap *bm, int32 x, int32 y)                 = 0;
+    virtual void  FillRule(const BRect &r)                                       = 0;
+    virtual void  FillPlaceholder(const BRect &r)                                = 0;
+    virtual void  BeginLineArray(int32 count)                                    = 0;
+    virtual void  AddLine(BPoint from, BPoint to)                                = 0;
+    virtual void  EndLineArray()                                                 = 0;
+    virtual void  StrokeArc(BPoint center, float rx, float ry, float start, float arc) = 0;
+    virtual void  StrokeRect(const BRect &r)                                     = 0;
+    virtual void  StrokeDashed(BPoint from, BPoint to)                           = 0;
+    virtual void  Highlight(const BRect &r)                                      = 0;
+};
+
+// draws into a BView; the caller must lock the view's looper
+
+class ViewTarget: public RenderTarget
+{
+  private:
+    typedef map<const BBitmap *, BBitmap *, less<const BBitmap *> > BitmapMap;
+
+    BView     *vw;
+    bool      Min;        // drawing mode is B_OP_MIN
+    BitmapMap Converted;  // B_COLOR_8_BIT copies of the grey glyphs drawn so far
+
+  public:
+    ViewTarget(BView *view):
+      vw(view),
+      Min(false),
+      Converted()
+    {
+      PageBuffer::InitTables();
+    }
+
+    virtual ~ViewTarget();
+
+    virtual BRect Bounds();
+    virtual BView *View();
+
+    virtual void  Begin(bool MinBlend);
+    virtual void  End();
+
+    virtual void  DrawGlyph(const BBitmap *bm, int32 x, int32 y);
+    virtual void  FillRule(const BRect &r);
+    virtual void  FillPlaceholder(const BRect &r);
+    virtual void  BeginLineArray(int32 count);
+    virtual void  AddLine(BPoint from, BPoint to);
+    virtual void  EndLineArray();
+    virtual void  StrokeArc(BPoint center, float rx, float ry, float start, float arc);
+    virtual void  StrokeRect(const BRect &r);
+    virtual void  StrokeDashed(BPoint from, BPoint to);
+    virtual void  Highlight(const BRect &r);
+};
+
+// draws into a PageBuffer without using the app_server; the buffer may cover only a part of the page whose upper
+// left corner is given by `OriginX' and `OriginY'
+
+class MemoryTarget: public RenderTarget
+{
+  private:
+    PageBuffer            *pb;
+    PageBuffer::BlendMode Mode;
+    int32                 OriginX;
+    int32                 OriginY;
+
+  public:
+    MemoryTarget(PageBuffer *buffer, int32 x = 0, int32 y = 0):
+      pb(buffer),
+      Mode(PageBuffer::BlendOver),
+      OriginX(x),
+      OriginY(y)
+    {}
+
+    virtual BRect Bounds();
+
+    virtual void  Begin(bool MinBlend);
+    virtual void  End();
+
+    virtual void  DrawGlyph(const BBitmap *bm, int32 x, int32 y);
+    virtual void  FillRule(const BRect &r);
+    virtual void  FillPlaceholder(const BRect &r);
+    virtual void  BeginLineArray(int32 count);
+    virtual void  AddLine(BPoint from, BPoint to);
+    virtual void  EndLineArray();
+    virtual void  StrokeArc(BPoint center, float rx, float ry, float start, float arc);
+    virtual void  StrokeRect(const BRect &r);
+    virtual void  StrokeDashed(BPoint from, BPoint to);
+    virtual void  Highlight(const BRect &r);
+};
+
+#endif
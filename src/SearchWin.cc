@@ -11,7 +11,11 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include <InterfaceKit.h>
+#include <stdio.h>
 #include <string.h>
+#if defined (__MWERKS__)
+#include <string>
+#endif
 #include "BeDVI.h"
 #include "log.h"
 
@@ -22,12 +26,16 @@ class SearchWindow: public BWindow
 
     BWindow      *Target;
     BTextControl *SearchText;
+    BListView    *Results;        // hits of the last `Find All'
 
   public:
             SearchWindow(BWindow *target, BRect frame);
     virtual ~SearchWindow();
 
     virtual void MessageReceived(BMessage *msg);
+
+  private:
+    void ClearResults();
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -42,14 +50,17 @@ class SearchWindow: public BWindow
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 SearchWindow::SearchWindow(BWindow *target, BRect frame):
-  BWindow(frame, "Search", B_TITLED_WINDOW_LOOK, B_NORMAL_WINDOW_FEEL, B_NOT_V_RESIZABLE | B_ASYNCHRONOUS_CONTROLS),
+  BWindow(frame, "Search", B_TITLED_WINDOW_LOOK, B_NORMAL_WINDOW_FEEL, B_ASYNCHRONOUS_CONTROLS),
   Target(target),
-  SearchText(NULL)
+  SearchText(NULL),
+  Results(NULL)
 {
   BButton      *but;
   BView        *back;
+  BScrollView  *scroll;
   BRect        bounds;
   float        width;
+  float        height;
 
   bounds = Bounds();
 
@@ -62,11 +73,22 @@ SearchWindow::SearchWindow(BWindow *target, BRect frame):
   back->AddChild(but);
   but->ResizeToPreferred();
 
-  frame = but->Frame();
-  width = frame.Width();
+  frame  = but->Frame();
+  width  = frame.Width();
+  height = frame.Height();
 
   but->MoveTo(BPoint(1, bounds.bottom - frame.Height() - 2));
 
+  but = new BButton(bounds, "Find All", "Find All", new BMessage(MsgFindAll), B_FOLLOW_H_CENTER | B_FOLLOW_BOTTOM);
+
+  back->AddChild(but);
+  but->ResizeToPreferred();
+
+  frame = but->Frame();
+  width += frame.Width();
+
+  but->MoveTo(BPoint((bounds.Width() - frame.Width()) / 2, bounds.bottom - frame.Height() - 2));
+
   but = new BButton(bounds, "Backwards", "Backwards", new BMessage(MsgSearchBackwards), B_FOLLOW_RIGHT | B_FOLLOW_BOTTOM);
 
   back->AddChild(but);
@@ -77,15 +99,13 @@ SearchWindow::SearchWindow(BWindow *target, BRect frame):
 
   but->MoveTo(BPoint(bounds.right - frame.Width() - 2, bounds.bottom - frame.Height() - 2));
 
-  if (bounds.Width() < width + 5)
+  if (bounds.Width() < width + 10)
   {
-    ResizeTo(width + 5, bounds.Height());
+    ResizeTo(width + 10, bounds.Height());
 
-    bounds.right = bounds.left + width + 5;
+    bounds.right = bounds.left + width + 10;
   }
 
-  SetSizeLimits(width + 5, 1024, bounds.Height(), bounds.Height());
-
   bounds.top += 2;
 
   SearchText = new BTextControl(bounds, "Search Text", "Search:", NULL, new BMessage(MsgSearchForwards),
@@ -94,6 +114,21 @@ SearchWindow::SearchWindow(BWindow *target, BRect frame):
   SearchText->ResizeToPreferred();
   SearchText->ResizeTo(bounds.Width() - 3, SearchText->Frame().Height());
   SearchText->MakeFocus();
+
+  // the list of results fills the space between the search text and the buttons
+
+  bounds.top     = SearchText->Frame().bottom + 4;
+  bounds.bottom -= height + 6;
+  bounds.left   += 2;
+  bounds.right  -= B_V_SCROLL_BAR_WIDTH + 3;
+
+  Results = new BListView(bounds, "Results", B_SINGLE_SELECTION_LIST, B_FOLLOW_ALL_SIDES);
+  Results->SetSelectionMessage(new BMessage(MsgShowHit));
+
+  scroll = new BScrollView("Results Scroll", Results, B_FOLLOW_ALL_SIDES, 0, false, true);
+  back->AddChild(scroll);
+
+  SetSizeLimits(width + 10, 1024, bounds.top + 3 * height + 8, 2048);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -106,28 +141,108 @@ SearchWindow::SearchWindow(BWindow *target, BRect frame):
 
 SearchWindow::~SearchWindow()
 {
+  ClearResults();
+
   ((ViewApplication *)be_app)->SearchWinBounds = Frame();
   ((ViewApplication *)be_app)->SearchWin       = NULL;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void SearchWindow::ClearResults()                                                                              //
+//                                                                                                                //
+// removes all hits from the list of results.                                                                     //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SearchWindow::ClearResults()
+{
+  BListItem *item;
+
+  while ((item = Results->RemoveItem((int32)0)) != NULL)
+    delete item;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // void SearchWindow::MessageReceived(BMessage *msg)                                                              //
 //                                                                                                                //
-// processes messages to the Search window.                                                                       //
+// processes messages to the Search window. `Find All' results arrive as `MsgSearchHit' messages, one for each    //
+// page, followed by `MsgSearchDone'; selecting a hit in the list shows it in the target window.                  //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void SearchWindow::MessageReceived(BMessage *msg)
 {
-  if (msg->what == MsgSearchForwards || msg->what == MsgSearchBackwards)
+  switch (msg->what)
   {
-    msg->AddString("Search Text", SearchText->Text());
-
-    Target->PostMessage(msg);
+    case MsgSearchForwards:
+    case MsgSearchBackwards:
+      msg->AddString("Search Text", SearchText->Text());
+
+      Target->PostMessage(msg);
+      break;
+
+    case MsgFindAll:
+      ClearResults();
+      SetTitle("Search");
+
+      msg->AddString(   "Search Text", SearchText->Text());
+      msg->AddMessenger("Reply",       BMessenger(this));
+
+      Target->PostMessage(msg);
+      break;
+
+    case MsgSearchHit:
+    {
+      const char *Context;
+      string     Text;
+      char       Buffer[32];
+      int32      Page;
+      int32      i;
+
+      if (msg->FindInt32("Page", &Page) != B_OK)
+      {
+        log_warn("invalid message received!");
+        break;
+      }
+
+      sprintf(Buffer, "%ld: ", Page);
+
+      for (i = 0; msg->FindString("Context", i, &Context) == B_OK; i++)
+      {
+        Text = Buffer;
+        Text += Context;
+
+        Results->AddItem(new BStringItem(Text.c_str()));
+      }
+      break;
+    }
+    case MsgSearchDone:
+    {
+      char Buffer[64];
+
+      sprintf(Buffer, "Search: %ld hits", Results->CountItems());
+
+      SetTitle(Buffer);
+      break;
+    }
+    case MsgShowHit:
+    {
+      int32 index;
+
+      if ((index = Results->CurrentSelection()) >= 0)
+      {
+        msg->AddInt32("Index", index);
+
+        Target->PostMessage(msg);
+      }
+      break;
+    }
+    default:
+      inherited::MessageReceived(msg);
+      break;
   }
-  else
-    inherited::MessageReceived(msg);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -151,7 +266,10 @@ BWindow *OpenSearchWindow(BRect Bounds, BWindow *Target)
 
     be_plain_font->GetHeight(&plain_height);
 
-    Bounds.bottom = Bounds.top  + 4 * (plain_height.ascent + plain_height.descent) + 5 * plain_height.leading;
+    // make room for the list of results
+
+    if (Bounds.Height() < 14 * (plain_height.ascent + plain_height.descent + plain_height.leading))
+      Bounds.bottom = Bounds.top + 14 * (plain_height.ascent + plain_height.descent + plain_height.leading);
 
     swin = new SearchWindow(Target, Bounds);
     swin->Show();
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector.h>
+#include "BeDVI.h"
+#include "TeXFont.h"
+#include "log.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void ReadChar(Font *f, wchar c)                                                                         //
+//                                                                                                                //
+// A font read from a TFM file has no bitmaps, so nothing is unpacked.                                            //
+//                                                                                                                //
+// Font  *f                             font                                                                      //
+// wchar c                              character                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void ReadChar(Font *, wchar)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool ReadTFMIndex(Font *f)                                                                                     //
+//                                                                                                                //
+// Reads the metrics of a font from its TFM file. The glyphs get the size of the boxes TeX uses, their bitmaps    //
+// stay empty.                                                                                                    //
+//                                                                                                                //
+// Font *f                              font                                                                      //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ReadTFMIndex(Font *f)
+{
+  typedef vector<int32, allocator<int32> > DimenList;
+
+  DimenList Widths, Heights, Depths;
+  uint      lh, bc, ec, nw, nh, nd;
+  uint      i, c;
+  double    Scale;
+  uchar     Info[4];
+  Glyph     *g;
+
+  f->File->Seek(2, SEEK_SET);
+
+  lh = ReadInt(f->File, 2);
+  bc = ReadInt(f->File, 2);
+  ec = ReadInt(f->File, 2);
+  nw = ReadInt(f->File, 2);
+  nh = ReadInt(f->File, 2);
+  nd = ReadInt(f->File, 2);
+
+  if (lh < 2 || ec > 255 || bc > ec + 1 || nw == 0 || nh == 0 || nd == 0)
+  {
+    log_warn("invalid TFM file!");
+    return false;
+  }
+
+  // a fix_word of the tables multiplied by `Scale' gives pixels; the design size is stored in points
+
+  f->File->Seek(24 + 4, SEEK_SET);
+
+  Scale = ReadSInt(f->File, 4) / 1048576.0 / 72.27 * f->Size / 1048576.0;
+
+  f->File->Seek(24 + 4 * (lh + ec - bc + 1), SEEK_SET);
+
+  for (i = 0; i < nw; i++)
+    Widths.push_back(ReadSInt(f->File, 4));
+  for (i = 0; i < nh; i++)
+    Heights.push_back(ReadSInt(f->File, 4));
+  for (i = 0; i < nd; i++)
+    Depths.push_back(ReadSInt(f->File, 4));
+
+  if (!(f->Glyphs = new Glyph[256]))
+    return false;
+
+  f->File->Seek(24 + 4 * lh, SEEK_SET);
+
+  for (c = bc; c <= ec; c++)
+  {
+    if (f->File->Read(Info, 4) != 4)
+      return false;
+
+    if (Info[0] == 0 || Info[0] >= nw || (Info[1] >> 4) >= nh || (Info[1] & 0xf) >= nd)
+      continue;                                      // character doesn't exist
+
+    g = &f->Glyphs[c];
+
+    g->Addr       = 24 + 4 * (lh + c - bc);          // only marks the character as present
+    g->Advance    = f->DimConvert * Widths[Info[0]];
+    g->Ux         = 0;
+    g->Uy         = (short)(Heights[Info[1] >> 4] * Scale + 0.5);
+    g->UWidth     = (short)(Widths[Info[0]] * Scale + 0.5);
+    g->UHeight    = (short)((Heights[Info[1] >> 4] + Depths[Info[1] & 0xf]) * Scale + 0.5);
+    g->HasMetrics = true;
+  }
+
+  f->ReadChar = ::ReadChar;
+
+  return true;
+}
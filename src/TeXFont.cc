@@ -39,12 +39,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <syslog.h>
+#include <vector.h>
 #include <Debug.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
 extern "C"
 {
   #define string _string
   #include "kpathsea/c-auto.h"
+  #include "kpathsea/tex-file.h"
   #include "kpathsea/tex-glyph.h"
   #undef string
 }
@@ -52,6 +58,8 @@ extern "C"
 #include "BeDVI.h"
 #include "DVI-View.h"
 #include "DVI-DrawPage.h"
+#include "FontMaker.h"
+#include "OutlineFont.h"
 #include "TeXFont.h"
 #include "log.h"
 
@@ -81,8 +89,15 @@ Font::Font(const DVI *doc, const DrawSettings *Settings, const char *name, float
   ChkSum(chksum),
   MagStep(magstep),
   DimConvert(dimconvert),
+  PixelsPerInch(Settings->DspInfo.PixelsPerInch),
+  Mode(Settings->DspInfo.Mode),
+  Outline(NULL),
+  Native(NULL),
+  NativeShrink(0),
+  NativeSample(0),
   UseCount(0),
   Loaded(false),
+  Placeholder(false),
   Virtual(false),
   VFTable()
 {
@@ -104,6 +119,8 @@ Font::Font(const DVI *doc, const DrawSettings *Settings, const char *name, float
 
 Font::~Font()
 {
+  delete Native;
+  delete Outline;
   delete File;
   delete [] Buffer;
   delete [] Name;
@@ -113,7 +130,8 @@ Font::~Font()
 //                                                                                                                //
 // bool Font::Open(char *&FontFound, int &SizeFound)                                                              //
 //                                                                                                                //
-// Opens the file of a font.                                                                                      //
+// Opens the file of a font. If fonts are generated in the background (see `FontMaker'), a missing font is queued //
+// instead of letting kpathsea run METAFONT.                                                                      //
 //                                                                                                                //
 // char *&FontFound                     used to return the name of the font found                                 //
 // int  &SizeFound                      used to return the size of the font found                                 //
@@ -124,9 +142,19 @@ Font::~Font()
 
 bool Font::Open(char *&FontFound, int &SizeFound)
 {
-  BFile FontFile;
-  char  *name;
-  off_t FileSize;
+  string Generated;
+  char   *name;
+  uint   dpi = (uint)(Size + 0.5);
+
+  // kpathsea may not know a font generated in the background yet
+
+  if (FontMaker::Async && FontMaker::Generated(Name, dpi, Generated))
+  {
+    SizeFound = dpi;
+    FontFound = NULL;
+
+    return ReadFile(Generated.c_str());
+  }
 
   acquire_sem(kpse_sem);
 
@@ -143,8 +171,19 @@ bool Font::Open(char *&FontFound, int &SizeFound)
   else
   {
     kpse_glyph_file_type FileResult;
+    boolean              PKEnabled    = kpse_format_info[kpse_pk_format].program_enabled_p;
+    boolean              GlyphEnabled = kpse_format_info[kpse_any_glyph_format].program_enabled_p;
+
+    if (FontMaker::Async)
+    {
+      kpse_format_info[kpse_pk_format].program_enabled_p        = false;
+      kpse_format_info[kpse_any_glyph_format].program_enabled_p = false;
+    }
 
-    name = kpse_find_glyph(Name, (uint)(Size + 0.5), kpse_any_glyph_format, &FileResult);
+    name = kpse_find_glyph(Name, dpi, kpse_any_glyph_format, &FileResult);
+
+    kpse_format_info[kpse_pk_format].program_enabled_p        = PKEnabled;
+    kpse_format_info[kpse_any_glyph_format].program_enabled_p = GlyphEnabled;
 
     if (name)
     {
@@ -158,13 +197,41 @@ bool Font::Open(char *&FontFound, int &SizeFound)
   }
   release_sem(kpse_sem);
 
+  // a fallback font is only used if the right one can't be generated
+
+  if (FontMaker::Async && (!name || FontFound) && FontMaker::Queue(Name, dpi, PixelsPerInch, Mode))
+  {
+    log_info("font '%s' is generated in the background", Name);
+    return false;
+  }
+
   if (!name)
   {
     log_warn("font '%s' not found!", Name);
     return false;
   }
 
-  if (FontFile.SetTo(name, O_RDONLY) != B_OK ||
+  return ReadFile(name);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool Font::ReadFile(const char *FileName)                                                                      //
+//                                                                                                                //
+// Reads a font file into memory.                                                                                 //
+//                                                                                                                //
+// const char *FileName                 file                                                                      //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Font::ReadFile(const char *FileName)
+{
+  BFile FontFile;
+  off_t FileSize;
+
+  if (FontFile.SetTo(FileName, O_RDONLY) != B_OK ||
       FontFile.InitCheck()           != B_OK)
   {
     log_warn("can't open file!");
@@ -246,7 +313,8 @@ void Font::ReallocFont(wchar num) throw(bad_alloc)
 //                                                                                                                //
 // bool Font::Load(const DVI *doc, const DrawSettings *Settings)                                                  //
 //                                                                                                                //
-// Loads a font.                                                                                                  //
+// Loads a font. With `Settings->MetricsOnly' only its TFM file is read. With `Settings->OutlineFonts' a font     //
+// listed in `psfonts.map' is rasterized from its Type 1 file instead of looking for a PK file.                   //
 //                                                                                                                //
 // const DVI          *doc              document the font appears in                                              //
 // const DrawSettings *Settings         settings                                                                  //
@@ -257,14 +325,23 @@ void Font::ReallocFont(wchar num) throw(bad_alloc)
 
 bool Font::Load(const DVI *doc, const DrawSettings *Settings)
 {
-  char *FontFound;
-  int  SizeFound;
-  uint Type;
+  OutlineFont *o;
+  char        *FontFound;
+  int         SizeFound;
+  uint        Type;
 
   try
   {
+    if (Settings->MetricsOnly)
+      return LoadMetrics();
+
+    if (Settings->OutlineFonts && (o = OutlineFont::Open(Name)))
+      return LoadOutline(o);
+
+    // a font which is generated in the background is replaced by its metrics for the time being
+
     if (!Open(FontFound, SizeFound))
-      return false;
+      return FontMaker::Pending(Name, (uint)(Size + 0.5)) && LoadMetrics();
 
     if (FontFound)
     {
@@ -338,6 +415,120 @@ bool Font::Load(const DVI *doc, const DrawSettings *Settings)
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool Font::LoadMetrics()                                                                                       //
+//                                                                                                                //
+// Loads the TFM file of a font instead of its bitmaps. The characters get their advance and the size of their    //
+// boxes, but they are drawn as boxes. This is used while the font is generated in the background and for         //
+// documents which are only scanned.                                                                              //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Font::LoadMetrics()
+{
+  char *name;
+
+  // the metrics must exist already, they aren't generated
+
+  acquire_sem(kpse_sem);
+
+  name = kpse_find_file(Name, kpse_tfm_format, false);
+
+  release_sem(kpse_sem);
+
+  if (!name)
+  {
+    log_warn("metrics of font '%s' not found!", Name);
+    return false;
+  }
+
+  if (!ReadFile(name) || !ReadTFMIndex(this))
+    return false;
+
+  MaxChar     = 255;
+  SetChar     = DrawPage::SetNormalChar;
+  Placeholder = true;
+  Loaded      = true;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void ReadOutlineChar(Font *f, wchar c)                                                                  //
+//                                                                                                                //
+// Rasterizes a character of an outline font.                                                                     //
+//                                                                                                                //
+// Font  *f                             font                                                                      //
+// wchar c                              character                                                                 //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void ReadOutlineChar(Font *f, wchar c)
+{
+  f->Outline->Rasterize(&f->Glyphs[c], c);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool Font::LoadOutline(OutlineFont *o)                                                                         //
+//                                                                                                                //
+// Loads a font whose glyphs are rasterized from an outline font. The advance and the boxes of the characters are //
+// read from the TFM file, the bitmaps are rasterized at `Size' when they are needed. So any size can be used     //
+// without generating a PK file.                                                                                  //
+//                                                                                                                //
+// OutlineFont *o                       outline font; it is deleted with this font                                //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Font::LoadOutline(OutlineFont *o)
+{
+  double DesignSize;
+
+  delete Outline;
+  Outline = o;
+
+  if (!LoadMetrics())
+    return false;
+
+  // the design size is stored in points as a fix_word
+
+  File->Seek(24 + 4, SEEK_SET);
+
+  DesignSize = ReadSInt(File, 4) / 1048576.0;
+
+  if (!Outline->SetSize(DesignSize / 72.27 * Size))
+    return false;
+
+  ReadChar    = ReadOutlineChar;
+  Placeholder = false;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool Font::GlyphsPending() const                                                                               //
+//                                                                                                                //
+// Checks whether the font or one it uses is still generated in the background.                                   //
+//                                                                                                                //
+// Result:                              `true' if some characters are drawn as boxes                              //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Font::GlyphsPending() const
+{
+  if (Placeholder || (Native && Native->Placeholder))
+    return true;
+
+  return Virtual && VFTable.GlyphsPending();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // void Font::FlushShrinkedGlyphes()                                                                              //
@@ -356,6 +547,63 @@ void Font::FlushShrinkedGlyphes()
       delete Glyphs[i].SBitMap;
       Glyphs[i].SBitMap = NULL;
     }
+
+  // the native font depends on the shrink factor, too
+
+  delete Native;
+  Native       = NULL;
+  NativeShrink = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// Font *Font::NativeFont(const DVI *doc, const DrawSettings *Settings, bool Load)                                //
+//                                                                                                                //
+// Returns the font whose glyphs should be drawn instead of this font's ones if `Settings->NativeFonts' is set.   //
+// This is the same font loaded at the displayed resolution times `Settings->NativeSample()' (generated by        //
+// kpathsea if neccessary), so only small glyphs have to be unpacked and shrunk. The font is loaded once for each //
+// shrink factor; if it isn't available this font is used.                                                        //
+//                                                                                                                //
+// const DVI          *doc              document the font appears in                                              //
+// const DrawSettings *Settings         settings                                                                  //
+// bool               Load              whether the font may be loaded; `false' if the fonts mustn't be modified  //
+//                                                                                                                //
+// Result:                              the font loaded near the displayed resolution or `NULL' if the glyphs     //
+//                                      of this font have to be used                                              //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Font *Font::NativeFont(const DVI *doc, const DrawSettings *Settings, bool Load)
+{
+  int32 sf = Settings->Shrink;
+  int   ss = Settings->NativeSample();
+
+  if (!Settings->NativeFonts || Virtual || sf <= ss * DrawSettings::ShrinkOne)
+    return NULL;
+
+  // a copy which is still generated is replaced when the document is reloaded
+
+  if (NativeShrink == sf && NativeSample == ss)
+    return Native && !Native->Placeholder ? Native : NULL;
+
+  if (!Load)
+    return NULL;
+
+  delete Native;
+  Native       = NULL;
+  NativeShrink = sf;
+  NativeSample = ss;
+
+  try
+  {
+    Native = new Font(doc, Settings, Name, Size * ss * DrawSettings::ShrinkOne / sf, ChkSum, MagStep, DimConvert);
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+  }
+  return Native && !Native->Placeholder ? Native : NULL;
 }
 
 
@@ -378,18 +626,16 @@ Glyph::Glyph():
   Ux(0), Uy(0), UWidth(0), UHeight(0),
   UBitMap(NULL),
   Sx(0), Sy(0), SWidth(0), SHeight(0),
-  SBitMap(NULL)
+  SBitMap(NULL),
+  HasMetrics(false)
 {
   static int32 TableInitialized = 0;           // record, if `ColourTable' is already initialized
 
   if (atomic_add(&TableInitialized, 1) < 1)
   {
-    // initialize table
-
-    BScreen scr;
-    int     Colour;
+    // the shrunken glyphs store grey values, which are mapped to the screen only when a page is displayed
 
-    for (int Factor = 2; Factor < MaxShrinkFactor; Factor++)
+    for (int Factor = 2; Factor <= MaxShrinkFactor; Factor++)
     {
       try
       {
@@ -405,10 +651,7 @@ Glyph::Glyph():
       }
 
       for (int i = 0; i <= Factor * Factor; i++)
-      {
-        Colour = 255 - (510 * i + Factor * Factor) / (2 * Factor * Factor);
-        ColourTable[Factor][i] = scr.IndexForColor(Colour, Colour, Colour);
-      }
+        ColourTable[Factor][i] = 255 - (510 * i + Factor * Factor) / (2 * Factor * Factor);
     }
   }
   else
@@ -431,18 +674,24 @@ Glyph::~Glyph()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
-// bool Glyph::Shrink(int Factor)                                                                                 //
+// bool Glyph::Shrink(int32 Shrink, bool AntiAliasing)                                                            //
 //                                                                                                                //
-// shrinks a glyph.                                                                                               //
+// shrinks a glyph. Integral factors use the box filters, other ones `Resample()'.                                //
 //                                                                                                                //
-// int Factor                           factor the glyph should be shrinked                                       //
+// int32 Shrink                         factor the glyph should be shrinked (see `DrawSettings::Shrink')          //
+// bool  AntiAliasing                   whether grey pixels are used                                              //
 //                                                                                                                //
 // Result:                              `true' if successful, otherwise `false'                                   //
 //                                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool Glyph::Shrink(int Factor, bool AntiAliasing)
+bool Glyph::Shrink(int32 Shrink, bool AntiAliasing)
 {
+  int Factor = Shrink / DrawSettings::ShrinkOne;
+
+  if (Shrink % DrawSettings::ShrinkOne != 0)
+    return Resample(Shrink, AntiAliasing);
+
   if (AntiAliasing)
     return ShrinkGrey(Factor);
   else
@@ -653,7 +902,7 @@ bool Glyph::ShrinkGrey(int Factor)
     r.right  = SWidth  - 1;
     r.bottom = SHeight - 1;
 
-    if (!(SBitMap = new BBitmap(r, B_COLOR_8_BIT)))      // should be replaced by B_GRAYSCALE_8_BIT
+    if (!(SBitMap = new BBitmap(r, B_GRAYSCALE_8_BIT)))
       return false;
 
     OldPtr = (BitmapUnit *)UBitMap->Bits();
@@ -716,6 +965,249 @@ bool Glyph::ShrinkGrey(int Factor)
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static inline int32 CeilDiv(int32 a, int32 b)                                                                  //
+//                                                                                                                //
+// Divides and rounds towards plus infinity.                                                                      //
+//                                                                                                                //
+// int32 a                              dividend                                                                  //
+// int32 b                              divisor, must be positive                                                 //
+//                                                                                                                //
+// Result:                              quotient                                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int32 CeilDiv(int32 a, int32 b)
+{
+  return a >= 0 ? (a + b - 1) / b : -(-a / b);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void AccumulateRow(uint32 *Acc, const uint32 *Sum, int32 n, uint32 Weight)                              //
+//                                                                                                                //
+// Adds `Weight' times the coverage of one unshrunken row to a row of shrunken pixels. The coverage doesn't fit   //
+// into 16 bits, so with SSE2 the products of four pixels are formed by two 32 bit multiplications of the even    //
+// and the odd ones.                                                                                              //
+//                                                                                                                //
+// uint32       *Acc                    coverage of the shrunken pixels                                           //
+// const uint32 *Sum                    coverage of the shrunken columns by the unshrunken row                    //
+// int32        n                       number of pixels                                                          //
+// uint32       Weight                  part of the unshrunken row inside the shrunken one in 1/256               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void AccumulateRow(uint32 *Acc, const uint32 *Sum, int32 n, uint32 Weight)
+{
+#if defined (__SSE2__)
+  const __m128i w = _mm_set1_epi32((int)Weight);
+
+  for (; n >= 4; n -= 4, Acc += 4, Sum += 4)
+  {
+    __m128i s    = _mm_loadu_si128((const __m128i *)Sum);
+    __m128i Even = _mm_mul_epu32(s, w);
+    __m128i Odd  = _mm_mul_epu32(_mm_srli_epi64(s, 32), w);
+    __m128i p    = _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                      _mm_shuffle_epi32(Odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+
+    _mm_storeu_si128((__m128i *)Acc, _mm_add_epi32(_mm_loadu_si128((const __m128i *)Acc), p));
+  }
+#endif
+
+  for (; n > 0; n--, Acc++, Sum++)
+    *Acc += Weight * *Sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool Glyph::Resample(int32 Shrink, bool AntiAliasing)                                                          //
+//                                                                                                                //
+// shrinks a glyph by a factor which isn't an integer. Each shrunken pixel gets the part of its area which is     //
+// covered by black pixels (area averaging). All positions are 16.16 fixed point numbers and the weights are      //
+// given in 1/256 of a pixel, so an unshrunken pixel contributes to at most two columns and two rows. Each row    //
+// is added to the shrunken rows by `AccumulateRow()', which uses SSE2 if it is available.                        //
+//                                                                                                                //
+// int32 Shrink                         factor the glyph should be shrinked (see `DrawSettings::Shrink')          //
+// bool  AntiAliasing                   whether grey pixels are used; otherwise a pixel is set if at least 40%    //
+//                                      of it are covered, like `ShrinkMonochrome()' does                         //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Glyph::Resample(int32 Shrink, bool AntiAliasing)
+{
+  typedef vector<int32,  allocator<int32> >  IndexList;
+  typedef vector<uint16, allocator<uint16> > WeightList;
+  typedef vector<uint32, allocator<uint32> > SumList;
+
+  IndexList  ColIndex(UWidth);       // shrunken column an unshrunken one starts in
+  WeightList ColWeight(UWidth);      // part of the unshrunken column inside that shrunken one
+  IndexList  RowIndex(UHeight);
+  WeightList RowWeight(UHeight);
+  SumList    RowSum;                 // coverage of the shrunken columns by one unshrunken row
+  SumList    Coverage;               // coverage of the shrunken pixels
+  BRect      r;
+  uchar      *Bits;
+  uchar      *NewPtr;
+  uint32     *Acc;
+  uint32     Area;
+  uint32     w;
+  int32      Edge;
+  int32      d;
+  int        x, y;
+  int        Byte;
+  bool       Empty;
+
+  if (SBitMap)         // already shrunken?
+    return true;
+
+  try
+  {
+    // the unshrunken pixel at the reference point starts the shrunken one
+
+    Sx      = CeilDiv(Ux << 16, Shrink);
+    Sy      = CeilDiv(Uy << 16, Shrink);
+    SWidth  = Sx + CeilDiv((UWidth  - Ux) << 16, Shrink);
+    SHeight = Sy + CeilDiv((UHeight - Uy) << 16, Shrink);
+
+    if (SWidth < 1)
+      SWidth = 1;
+    if (SHeight < 1)
+      SHeight = 1;
+
+    for (x = 0, d = 0, Edge = (Ux << 16) + (1 - Sx) * Shrink; x < UWidth; x++)
+    {
+      while (Edge <= (x << 16))
+      {
+        d++;
+        Edge += Shrink;
+      }
+      ColIndex[x]  = d;
+      ColWeight[x] = Edge >= ((x + 1) << 16) ? 256 : (Edge - (x << 16)) >> 8;
+    }
+
+    for (y = 0, d = 0, Edge = (Uy << 16) + (1 - Sy) * Shrink; y < UHeight; y++)
+    {
+      while (Edge <= (y << 16))
+      {
+        d++;
+        Edge += Shrink;
+      }
+      RowIndex[y]  = d;
+      RowWeight[y] = Edge >= ((y + 1) << 16) ? 256 : (Edge - (y << 16)) >> 8;
+    }
+
+    RowSum.resize(SWidth + 1, 0);
+    Coverage.resize((SHeight + 1) * SWidth, 0);
+
+    for (y = 0; y < UHeight; y++)
+    {
+      Bits  = (uchar *)UBitMap->Bits() + y * UBitMap->BytesPerRow();
+      Empty = true;
+
+      // the bitmaps store the leftmost pixel in the most significant bit of each byte
+
+      for (x = 0; x < UWidth; x++)
+      {
+        if ((x & 7) == 0 && (Byte = Bits[x >> 3]) == 0)
+        {
+          x += 7;
+          continue;
+        }
+        if (Byte & (0x80 >> (x & 7)))
+        {
+          RowSum[ColIndex[x]]     += ColWeight[x];
+          RowSum[ColIndex[x] + 1] += 256 - ColWeight[x];
+          Empty = false;
+        }
+      }
+
+      if (Empty)
+        continue;
+
+      w   = RowWeight[y];
+      Acc = &Coverage[RowIndex[y] * SWidth];
+
+      AccumulateRow(Acc, &RowSum[0], SWidth, w);
+
+      if (w < 256)
+        AccumulateRow(Acc + SWidth, &RowSum[0], SWidth, 256 - w);
+
+      for (x = 0; x <= SWidth; x++)
+        RowSum[x] = 0;
+    }
+
+    // a shrunken pixel consists of (Shrink / 256)^2 weights; with `MaxShrinkFactor' 255 times that fits in 32 bits
+
+    Area = (uint32)(Shrink >> 8) * (uint32)(Shrink >> 8);
+
+    r.left   = 0;
+    r.top    = 0;
+    r.bottom = SHeight - 1;
+
+    if (AntiAliasing)
+    {
+      r.right = SWidth - 1;
+
+      if (!(SBitMap = new BBitmap(r, B_GRAYSCALE_8_BIT)))
+        return false;
+
+      NewPtr = (uchar *)SBitMap->Bits();
+
+      for (y = 0; y < SHeight; y++, NewPtr += SBitMap->BytesPerRow())
+      {
+        Acc = &Coverage[y * SWidth];
+
+        for (x = 0; x < SWidth; x++)
+          NewPtr[x] = 255 - min_c(Acc[x] * 255 / Area, 255);
+      }
+    }
+    else
+    {
+      r.right = ((SWidth + BITS_PER_UNIT - 1) & ~(BITS_PER_UNIT - 1)) - 1;
+
+      if (!(SBitMap = new BBitmap(r, B_MONOCHROME_1_BIT)))
+        return false;
+
+      NewPtr = (uchar *)SBitMap->Bits();
+
+      memset(NewPtr, 0, SBitMap->BitsLength());
+
+      for (y = 0; y < SHeight; y++, NewPtr += SBitMap->BytesPerRow())
+      {
+        Acc = &Coverage[y * SWidth];
+
+        for (x = 0; x < SWidth; x++)
+          if (5 * Acc[x] >= 2 * Area)
+            NewPtr[x >> 3] |= 0x80 >> (x & 7);
+      }
+    }
+    return true;
+  }
+  catch(const exception &e)
+  {
+    log_warn("%s!", e.what());
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    delete SBitMap;
+    SBitMap = NULL;
+
+    return false;
+  }
+  catch(...)
+  {
+    log_warn("unknown exception!");
+    log_debug("at %s:%d", __FILE__, __LINE__);
+
+    delete SBitMap;
+    SBitMap = NULL;
+
+    return false;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                                                //
 // int Glyph::Sample(BitmapUnit *Bits, int BytesPerRow, int BitSkip, int Width, int Height)                       //
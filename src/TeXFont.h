@@ -30,6 +30,7 @@
 #endif
 
 class Font;
+class OutlineFont;
 
 static const uint32 BitMasks[33] =
 {
@@ -61,19 +62,21 @@ class Glyph
     short   Sx, Sy, SWidth, SHeight;         // shrunken
     BBitmap *SBitMap;
     int     FlagByte;
+    bool    HasMetrics;                      // `Advance' and the unshrunken size are known without `UBitMap'
 
   private:
-    static uchar *ColourTable[MaxShrinkFactor + 1];
+    static uchar *ColourTable[MaxShrinkFactor + 1];   // grey value of each number of black pixels
 
   public:
     Glyph();
     ~Glyph();
 
-    bool Shrink(int Factor, bool AntiAliasing);
+    bool Shrink(int32 Shrink, bool AntiAliasing);
 
   private:
     bool ShrinkMonochrome(int Factor);
     bool ShrinkGrey(int Factor);
+    bool Resample(int32 Shrink, bool AntiAliasing);
     int  Sample(BitmapUnit *Bits, int BytesPerRow, int BitSkip, int Widht, int Height);
 };
 
@@ -109,15 +112,19 @@ class Font
     long         ChkSum;     // checksum
     int          MagStep;    // 2*magstepnumber or `NoMagStep'
     double       DimConvert; // size conversion faktor
+    uint         PixelsPerInch;
+    const char   *Mode;      // the font was loaded for this METAFONT mode and `PixelsPerInch'
     wchar        MaxChar;    // largest character code
     uchar        Loaded:1;
     uchar        Virtual:1;
+    uchar        Placeholder:1; // only the metrics have been loaded (see `LoadMetrics()')
     SetCharProc  SetChar;    // procedure to set a character
 
     // Raster Fonts
 
     ReadCharProc ReadChar;
     Glyph        *Glyphs;
+    OutlineFont  *Outline;   // Type 1 font the glyphs are rasterized from (see `LoadOutline()')
 
     // Virtual Fonts
 
@@ -127,6 +134,12 @@ class Font
 
   private:
     char         *Buffer;    // buffer the font file is stored in
+    Font         *Native;    // this font loaded near the displayed resolution (see `NativeFont()')
+
+    // shrink factor and supersampling `Native' has been loaded for; 0 if it hasn't been tried yet
+
+    int32        NativeShrink;
+    uchar        NativeSample;
 
   public:
             Font(const DVI *doc, const DrawSettings *Settings, const char *name = NULL, float size = 0.0, long chksum = 0,
@@ -135,14 +148,20 @@ class Font
 
     bool Load(const DVI *doc, const DrawSettings *Settings);
     void FlushShrinkedGlyphes();
+    Font *NativeFont(const DVI *doc, const DrawSettings *Settings, bool Load);
+    bool GlyphsPending() const;
 
   private:
     bool Open(char *&FontFound, int &SizeFound);
+    bool ReadFile(const char *FileName);
+    bool LoadMetrics();
+    bool LoadOutline(OutlineFont *o);
     void ReallocFont(wchar num) throw(bad_alloc);
 };
 
 bool ReadPKIndex(Font *f);
 bool ReadGFIndex(Font *f);
+bool ReadTFMIndex(Font *f);
 bool ReadVFIndex(const DVI *doc, const DrawSettings *Settings, Font *f);
 
 #endif
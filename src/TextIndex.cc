@@ -0,0 +1,528 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <StorageKit.h>
+#include "TextIndex.h"
+#include "PageLayout.h"
+#include "TeXFont.h"
+#include "log.h"
+
+// header of an index file; the data is stored in the byte order of the machine, so an index written on another
+// platform is rejected because of its magic number
+
+struct IndexHeader
+{
+  uint32 Magic;
+  uint32 Version;
+  int64  FileSize;
+  int64  FileTime;
+  int32  PixelsPerInch;
+  uint32 NumPages;
+  uint32 NumFonts;
+  uint32 TextLength;
+};
+
+static const uint32 IndexMagic   = 'BDTI';
+static const uint32 IndexVersion = 1;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static void InitOffsets(const string &Pattern, ssize_t *Offset)                                                //
+//                                                                                                                //
+// Initializes the offset array for a Knuth-Morris-Pratt search.                                                  //
+//                                                                                                                //
+// const string &Pattern                string to look for                                                        //
+// ssize_t      *Offset                 array of `Pattern.size() + 1' entries                                     //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void InitOffsets(const string &Pattern, ssize_t *Offset)
+{
+  ssize_t i, j;
+
+  Offset[0] = -1;
+
+  for (i = 0, j = -1; i < (ssize_t)Pattern.size(); )
+  {
+    while (j >= 0 && Pattern[i] != Pattern[j])
+      j = Offset[j];
+
+    Offset[++i] = ++j;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static string SearchPattern(const char *str)                                                                   //
+//                                                                                                                //
+// Converts a search string into the form used by the index: each sequence of white space becomes a single blank  //
+// and leading and trailing white space is removed.                                                               //
+//                                                                                                                //
+// const char *str                      search string                                                             //
+//                                                                                                                //
+// Result:                              pattern to look for                                                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static string SearchPattern(const char *str)
+{
+  string Pattern;
+
+  for (; *str; str++)
+    if (!isspace(*str))
+      Pattern += *str;
+    else if (!Pattern.empty() && Pattern[Pattern.size() - 1] != ' ' && str[1] != '\0' && !isspace(str[1]))
+      Pattern += ' ';
+
+  return Pattern;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// static bool NextMatch(const string &Text, const string &Pattern, const ssize_t *Offset, uint32 &Pos,           //
+//                       uint32 End)                                                                              //
+//                                                                                                                //
+// Searches part of the text for the next occurrence of a pattern. Line breaks match blanks.                      //
+//                                                                                                                //
+// const string  &Text                  text to search                                                            //
+// const string  &Pattern               string to look for                                                        //
+// const ssize_t *Offset                offsets computed by `InitOffsets()'                                       //
+// uint32        &Pos                   first character to look at; returns the position after the match          //
+// uint32        End                    end of the part to search                                                 //
+//                                                                                                                //
+// Result:                              `true' if the pattern was found                                           //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool NextMatch(const string &Text, const string &Pattern, const ssize_t *Offset, uint32 &Pos, uint32 End)
+{
+  ssize_t j = 0;
+  char    c;
+
+  for (; Pos < End; Pos++)
+  {
+    c = (Text[Pos] == '\n' ? ' ' : Text[Pos]);
+
+    while (j >= 0 && c != Pattern[j])
+      j = Offset[j];
+
+    if (++j == (ssize_t)Pattern.size())
+    {
+      Pos++;
+      return true;
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// TextIndex::TextIndex(uint pages, int32 dpi, off_t size, time_t mtime)                                          //
+//                                                                                                                //
+// Initializes an empty index.                                                                                    //
+//                                                                                                                //
+// uint   pages                         number of pages of the document                                           //
+// int32  dpi                           resolution the positions refer to                                         //
+// off_t  size                          size of the DVI file                                                      //
+// time_t mtime                         modification time of the DVI file                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextIndex::TextIndex(uint pages, int32 dpi, off_t size, time_t mtime):
+  Text(),
+  Boxes(),
+  PageStart(),
+  FontNames(),
+  Fonts(),
+  NumPages(pages),
+  PixelsPerInch(dpi),
+  FileSize(size),
+  FileTime(mtime)
+{
+  PageStart.push_back(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void TextIndex::AddPage(const PageLayout *l)                                                                   //
+//                                                                                                                //
+// Appends the characters of the next page. Word and line breaks aren't part of the DVI file, so they are         //
+// inferred from the positions: a new line starts if the baseline moves by more than the height of a character or //
+// the position moves backwards, and a word ends if the gap to the next character is larger than a quarter of     //
+// their widths.                                                                                                  //
+//                                                                                                                //
+// const PageLayout *l                  layout of the page or `NULL' if it couldn't be read                       //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextIndex::AddPage(const PageLayout *l)
+{
+  const Glyph *g;
+  TextBox     b;
+  long        PrevHoriz   = 0;
+  long        PrevVert    = 0;
+  long        PrevEnd     = 0;
+  long        PrevAdvance = 0;
+  int         PrevHeight  = 0;
+  bool        First       = true;
+  long        x, y;
+  uint        i;
+
+  for (i = 0; l != NULL && i < l->Items.size(); i++)
+  {
+    const LayoutItem &item = l->Items[i];
+
+    if (item.Fnt == NULL)                         // rules aren't text
+      continue;
+
+    g = &item.Fnt->Glyphs[item.Char];
+
+    if (!First)
+    {
+      if (item.Vert != PrevVert &&
+          (labs(item.Vert - PrevVert) >> 16 > max_c(PrevHeight, g->UHeight) || item.Horiz < PrevHoriz))
+        AddBreak('\n');
+
+      else if (item.Horiz - PrevEnd > max_c(PrevAdvance, g->Advance) / 4)
+        AddBreak(' ');
+    }
+
+    x = (item.Horiz >> 16) - g->Ux;
+    y = (item.Vert  >> 16) - g->Uy;
+
+    b.Left   = (uint16)(x < 0 ? 0 : (x > 0xffff ? 0xffff : x));
+    b.Top    = (uint16)(y < 0 ? 0 : (y > 0xffff ? 0xffff : y));
+    b.Width  = (uint8)min_c(g->UWidth,  0xff);
+    b.Height = (uint8)min_c(g->UHeight, 0xff);
+    b.Font   = FontIndex(item.Fnt);
+
+    Text += (char)item.Char;
+    Boxes.push_back(b);
+
+    PrevHoriz   = item.Horiz;
+    PrevVert    = item.Vert;
+    PrevEnd     = item.Horiz + g->Advance;
+    PrevAdvance = g->Advance;
+    PrevHeight  = g->UHeight;
+    First       = false;
+  }
+
+  PageStart.push_back(Text.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void TextIndex::AddBreak(char c)                                                                               //
+//                                                                                                                //
+// Appends an inferred word or line break.                                                                        //
+//                                                                                                                //
+// char c                               ' ' or '\n'                                                               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextIndex::AddBreak(char c)
+{
+  TextBox b;
+
+  b.Left   = 0;
+  b.Top    = 0;
+  b.Width  = 0;
+  b.Height = 0;
+  b.Font   = NoFont;
+
+  Text += c;
+  Boxes.push_back(b);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// uint16 TextIndex::FontIndex(const Font *f)                                                                     //
+//                                                                                                                //
+// Returns the number of a font in `FontNames' and adds it if necessary.                                          //
+//                                                                                                                //
+// const Font *f                        font                                                                      //
+//                                                                                                                //
+// Result:                              index of the font                                                         //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16 TextIndex::FontIndex(const Font *f)
+{
+  uint i;
+
+  for (i = 0; i < Fonts.size(); i++)
+    if (Fonts[i] == f)
+      return i;
+
+  if (Fonts.size() >= NoFont)
+    return NoFont;
+
+  Fonts.push_back(f);
+  FontNames.push_back(string(f->Name ? f->Name : ""));
+
+  return Fonts.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// uint TextIndex::Find(const char *str, uint First, uint Last) const                                             //
+//                                                                                                                //
+// Searches the pages from `First' to `Last' for a string. If `Last' is lower than `First' the index is searched  //
+// backwards. Each sequence of white space in `str' matches an inferred word or line break, so phrases are found  //
+// even if they are broken across lines. Matches don't extend over page boundaries.                               //
+//                                                                                                                //
+// const char *str                      string to look for                                                        //
+// uint       First, Last               range of pages                                                            //
+//                                                                                                                //
+// Result:                              first page in search order containing the string or 0 if none does        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint TextIndex::Find(const char *str, uint First, uint Last) const
+{
+  string  Pattern   = SearchPattern(str);
+  ssize_t *Offset;
+  uint32  Pos;
+  uint    p;
+  int     increment = (Last >= First ? 1 : -1);
+
+  if (Pattern.empty() || First < 1 || Last < 1 || First > PagesDone() || Last > PagesDone())
+    return 0;
+
+  Offset = new ssize_t[Pattern.size() + 1];
+
+  InitOffsets(Pattern, Offset);
+
+  for (p = First; ; p += increment)
+  {
+    Pos = PageStart[p - 1];
+
+    if (NextMatch(Text, Pattern, Offset, Pos, PageStart[p]))
+    {
+      delete [] Offset;
+      return p;
+    }
+    if (p == Last)
+      break;
+  }
+
+  delete [] Offset;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void TextIndex::FindAll(const char *str, uint PageNo, HitList &Hits) const                                     //
+//                                                                                                                //
+// Appends all occurrences of a string on a page to a list. White space is treated as in `Find()'.                //
+//                                                                                                                //
+// const char *str                      string to look for                                                        //
+// uint       PageNo                    page number                                                               //
+// HitList    &Hits                     list the occurrences are appended to                                      //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextIndex::FindAll(const char *str, uint PageNo, HitList &Hits) const
+{
+  string  Pattern = SearchPattern(str);
+  ssize_t *Offset;
+  TextHit h;
+  uint32  Pos, Start, End, i;
+
+  if (Pattern.empty() || PageNo < 1 || PageNo > PagesDone())
+    return;
+
+  Offset = new ssize_t[Pattern.size() + 1];
+
+  InitOffsets(Pattern, Offset);
+
+  try
+  {
+    for (Pos = PageStart[PageNo - 1]; NextMatch(Text, Pattern, Offset, Pos, PageStart[PageNo]); )
+    {
+      // bounding box of the characters, the inferred breaks have no position
+
+      h.Rect = BRect();
+
+      for (i = Pos - Pattern.size(); i < Pos; i++)
+        if (Boxes[i].Font != NoFont)
+        {
+          BRect r(Boxes[i].Left, Boxes[i].Top, Boxes[i].Left + Boxes[i].Width - 1, Boxes[i].Top + Boxes[i].Height - 1);
+
+          h.Rect = (h.Rect.IsValid() ? h.Rect | r : r);
+        }
+
+      // the match and a few characters of the surrounding text on the same page
+
+      Start = Pos - Pattern.size();
+      Start = (Start >= PageStart[PageNo - 1] + ContextLength ? Start - ContextLength : PageStart[PageNo - 1]);
+      End   = min_c(Pos + ContextLength, PageStart[PageNo]);
+
+      h.Context.assign(Text, Start, End - Start);
+
+      for (i = 0; i < h.Context.size(); i++)
+        if (h.Context[i] == '\n')
+          h.Context[i] = ' ';
+
+      Hits.push_back(h);
+    }
+  }
+  catch(...)
+  {
+    delete [] Offset;
+    throw;
+  }
+
+  delete [] Offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool TextIndex::Save(const char *FileName) const                                                               //
+//                                                                                                                //
+// Writes a complete index to a file.                                                                             //
+//                                                                                                                //
+// const char *FileName                 name of the file                                                          //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextIndex::Save(const char *FileName) const
+{
+  IndexHeader h;
+  BFile       f;
+  uint        i;
+
+  if (!Complete())
+    return false;
+
+  if (f.SetTo(FileName, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE) != B_OK)
+    return false;
+
+  h.Magic         = IndexMagic;
+  h.Version       = IndexVersion;
+  h.FileSize      = FileSize;
+  h.FileTime      = FileTime;
+  h.PixelsPerInch = PixelsPerInch;
+  h.NumPages      = NumPages;
+  h.NumFonts      = FontNames.size();
+  h.TextLength    = Text.size();
+
+  if (f.Write(&h, sizeof(h)) != sizeof(h))
+    return false;
+
+  for (i = 0; i < FontNames.size(); i++)
+    if (f.Write(FontNames[i].c_str(), FontNames[i].size() + 1) != (ssize_t)FontNames[i].size() + 1)
+      return false;
+
+  if (f.Write(&PageStart[0], PageStart.size() * sizeof(uint32)) != (ssize_t)(PageStart.size() * sizeof(uint32)))
+    return false;
+
+  if (!Text.empty() &&
+      (f.Write(Text.data(), Text.size()) != (ssize_t)Text.size() ||
+       f.Write(&Boxes[0], Boxes.size() * sizeof(TextBox)) != (ssize_t)(Boxes.size() * sizeof(TextBox))))
+    return false;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool TextIndex::Load(const char *FileName)                                                                     //
+//                                                                                                                //
+// Reads an index written by `Save'. The file is only accepted if it was created for the same version of the DVI  //
+// file at the same resolution.                                                                                   //
+//                                                                                                                //
+// const char *FileName                 name of the file                                                          //
+//                                                                                                                //
+// Result:                              `true' if successful, otherwise `false'                                   //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextIndex::Load(const char *FileName)
+{
+  IndexHeader h;
+  BFile       f;
+  char        *Buffer = NULL;
+  char        c;
+  uint        i;
+
+  if (f.SetTo(FileName, B_READ_ONLY) != B_OK)
+    return false;
+
+  if (f.Read(&h, sizeof(h)) != sizeof(h) ||
+      h.Magic         != IndexMagic      ||
+      h.Version       != IndexVersion    ||
+      h.FileSize      != FileSize        ||
+      h.FileTime      != FileTime        ||
+      h.PixelsPerInch != PixelsPerInch   ||
+      h.NumPages      != NumPages)
+    return false;
+
+  try
+  {
+    NameList   Names;
+    OffsetList Starts(NumPages + 1);
+    BoxList    NewBoxes(h.TextLength);
+    string     Name;
+
+    for (i = 0; i < h.NumFonts; i++)
+    {
+      for (Name.erase(); f.Read(&c, 1) == 1 && c != '\0'; )
+        Name += c;
+
+      if (c != '\0')
+        return false;
+
+      Names.push_back(Name);
+    }
+
+    if (f.Read(&Starts[0], Starts.size() * sizeof(uint32)) != (ssize_t)(Starts.size() * sizeof(uint32)))
+      return false;
+
+    for (i = 0; i < NumPages; i++)
+      if (Starts[i] > Starts[i + 1])
+        return false;
+
+    if (Starts[0] != 0 || Starts[NumPages] != h.TextLength)
+      return false;
+
+    Buffer = new char[h.TextLength + 1];
+
+    if (h.TextLength > 0 &&
+        (f.Read(Buffer, h.TextLength) != (ssize_t)h.TextLength ||
+         f.Read(&NewBoxes[0], h.TextLength * sizeof(TextBox)) != (ssize_t)(h.TextLength * sizeof(TextBox))))
+    {
+      delete [] Buffer;
+      return false;
+    }
+
+    Text.assign(Buffer, h.TextLength);
+    Boxes.swap(NewBoxes);
+    PageStart.swap(Starts);
+    FontNames.swap(Names);
+    Fonts.clear();
+  }
+  catch(...)
+  {
+    log_warn("not enough memory!");
+
+    delete [] Buffer;
+    return false;
+  }
+
+  delete [] Buffer;
+  return true;
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <InterfaceKit.h>
+#include <vector.h>
+#if defined (__MWERKS__)
+#include <string>
+#endif
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+class Font;
+class PageLayout;
+
+// position of a character in unshrunk pixels
+
+struct TextBox
+{
+  uint16 Left;
+  uint16 Top;
+  uint8  Width;
+  uint8  Height;
+  uint16 Font;           // index into the font names or `TextIndex::NoFont' for inferred breaks
+};
+
+// occurrence of a search string
+
+struct TextHit
+{
+  BRect  Rect;           // bounding box in unshrunk pixels
+  string Context;        // the occurrence and the surrounding text
+};
+
+// text of a document in reading order; used to search without interpreting the pages
+
+class TextIndex
+{
+  public:
+    enum
+    {
+      NoFont        = 0xffff,
+      ContextLength = 24        // characters of context stored with a search hit on each side
+    };
+
+    typedef vector<TextBox, allocator<TextBox> >           BoxList;
+    typedef vector<uint32, allocator<uint32> >             OffsetList;
+    typedef vector<string, allocator<string> >             NameList;
+    typedef vector<const Font *, allocator<const Font *> > FontList;
+    typedef vector<TextHit, allocator<TextHit> >           HitList;
+
+  private:
+    string     Text;             // characters; inferred word breaks are ' ', line breaks '\n'
+    BoxList    Boxes;            // position of each character of `Text'
+    OffsetList PageStart;        // index of the first character of each page and the end of the text
+    NameList   FontNames;
+    FontList   Fonts;            // fonts belonging to `FontNames' while the index is built
+    uint       NumPages;         // number of pages of the document
+    int32      PixelsPerInch;    // resolution the positions refer to
+    off_t      FileSize;         // the index belongs to this version of the DVI file
+    time_t     FileTime;
+
+  public:
+    TextIndex(uint pages, int32 dpi, off_t size, time_t mtime);
+
+    void AddPage(const PageLayout *l);
+    uint Find(const char *str, uint First, uint Last) const;
+    void FindAll(const char *str, uint PageNo, HitList &Hits) const;
+    bool Load(const char *FileName);
+    bool Save(const char *FileName) const;
+
+    uint PagesDone() const
+    {
+      return PageStart.size() - 1;
+    }
+
+    bool Complete() const
+    {
+      return PagesDone() == NumPages;
+    }
+
+    void SetNumPages(uint pages)    // the document may have counted its pages while they were indexed
+    {
+      NumPages = pages;
+    }
+
+  private:
+    uint16 FontIndex(const Font *f);
+    void   AddBreak(char c);
+};
+
+#endif
@@ -0,0 +1,234 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileCache.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// TileCache::TileCache()                                                                                         //
+//                                                                                                                //
+// Initializes an empty tile cache.                                                                               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileCache::TileCache():
+  Tiles(),
+  MaxTiles(MinTiles),
+  Generation(0)
+{}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// TileCache::~TileCache()                                                                                        //
+//                                                                                                                //
+// Deletes a tile cache.                                                                                          //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileCache::~TileCache()
+{
+  Free();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// BBitmap *TileCache::Lookup(int32 Column, int32 Row)                                                            //
+//                                                                                                                //
+// Returns the bitmap of a tile and marks it as recently used.                                                    //
+//                                                                                                                //
+// int32 Column, Row                    position of the tile                                                      //
+//                                                                                                                //
+// Result:                              bitmap of the tile or `NULL' if it hasn't been drawn yet                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BBitmap *TileCache::Lookup(int32 Column, int32 Row)
+{
+  TileList::iterator i;
+  Tile               t;
+
+  for (i = Tiles.begin(); i != Tiles.end(); i++)
+    if (i->Column == Column && i->Row == Row)
+    {
+      if (!i->Valid)
+        return NULL;
+
+      t = *i;
+
+      Tiles.erase(i);
+      Tiles.push_front(t);
+
+      return t.Bitmap;
+    }
+
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool TileCache::IsValid(int32 Column, int32 Row) const                                                         //
+//                                                                                                                //
+// Checks whether a tile has been drawn.                                                                          //
+//                                                                                                                //
+// int32 Column, Row                    position of the tile                                                      //
+//                                                                                                                //
+// Result:                              `true' if the cache contains the current contents of the tile             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileCache::IsValid(int32 Column, int32 Row) const
+{
+  TileList::const_iterator i;
+
+  for (i = Tiles.begin(); i != Tiles.end(); i++)
+    if (i->Column == Column && i->Row == Row)
+      return i->Valid;
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool TileCache::IsFinal(int32 Column, int32 Row) const                                                         //
+//                                                                                                                //
+// Checks whether a tile has been drawn completely, i.e., not just as a preview.                                  //
+//                                                                                                                //
+// int32 Column, Row                    position of the tile                                                      //
+//                                                                                                                //
+// Result:                              `true' if the tile doesn't have to be redrawn                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileCache::IsFinal(int32 Column, int32 Row) const
+{
+  TileList::const_iterator i;
+
+  for (i = Tiles.begin(); i != Tiles.end(); i++)
+    if (i->Column == Column && i->Row == Row)
+      return i->Valid && !i->Preview;
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// bool TileCache::Store(int32 Column, int32 Row, BBitmap *&bm, uint32 gen, bool Preview = false)                 //
+//                                                                                                                //
+// Publishes a newly drawn tile by exchanging bitmaps, so the caller can draw the next tile into the bitmap which //
+// was replaced. If the cache is full, the least recently used tile is recycled. Tiles drawn before the last call //
+// of `Invalidate()' are rejected.                                                                                //
+//                                                                                                                //
+// int32   Column, Row                  position of the tile                                                      //
+// BBitmap *&bm                         bitmap of the tile; returns the replaced bitmap or `NULL'                 //
+// uint32  gen                          generation of the cache when the drawing started                          //
+// bool    Preview                      the tile contains placeholders and will be drawn again                    //
+//                                                                                                                //
+// Result:                              `true' if the tile was stored, `false' if it is out of date               //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileCache::Store(int32 Column, int32 Row, BBitmap *&bm, uint32 gen, bool Preview)
+{
+  TileList::iterator i;
+  Tile               t;
+  BBitmap            *old;
+  bool               Found = false;
+
+  if (gen != Generation)
+    return false;
+
+  for (i = Tiles.begin(); i != Tiles.end(); i++)
+    if (i->Column == Column && i->Row == Row)
+    {
+      t     = *i;
+      Found = true;
+
+      Tiles.erase(i);
+      break;
+    }
+
+  if (!Found)
+  {
+    if (Tiles.size() >= MaxTiles)
+    {
+      t = Tiles.back();
+      Tiles.pop_back();
+    }
+    else
+      t.Bitmap = NULL;
+
+    t.Column = Column;
+    t.Row    = Row;
+  }
+
+  old       = t.Bitmap;
+  t.Bitmap  = bm;
+  t.Valid   = true;
+  t.Preview = Preview;
+  bm        = old;
+
+  Tiles.push_front(t);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void TileCache::Invalidate()                                                                                   //
+//                                                                                                                //
+// Marks all tiles as invalid. Their bitmaps are kept for reuse.                                                  //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCache::Invalidate()
+{
+  TileList::iterator i;
+
+  for (i = Tiles.begin(); i != Tiles.end(); i++)
+    i->Valid = false;
+
+  Generation++;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void TileCache::Reserve(uint num)                                                                              //
+//                                                                                                                //
+// Makes sure that the cache can hold at least `num' tiles. Tiles are recycled while they are still displayed if  //
+// the limit is lower than the number of visible tiles.                                                           //
+//                                                                                                                //
+// uint num                             number of tiles                                                           //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCache::Reserve(uint num)
+{
+  if (MaxTiles < num)
+    MaxTiles = num;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// void TileCache::Free()                                                                                         //
+//                                                                                                                //
+// Deletes all tiles.                                                                                             //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCache::Free()
+{
+  while (!Tiles.empty())
+  {
+    delete Tiles.front().Bitmap;
+    Tiles.pop_front();
+  }
+}
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                                //
+// $Id$
+//                                                                                                                //
+// BeDVI                                                                                                          //
+// by Achim Blumensath                                                                                            //
+// blume@corona.oche.de                                                                                           //
+//                                                                                                                //
+// This program is free software! It may be distributed according to the GNU Public License (see COPYING).        //
+//                                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <InterfaceKit.h>
+#include <list.h>
+
+#ifndef DEFINES_H
+#include "defines.h"
+#endif
+
+// cache of rendered parts of a page
+
+class TileCache
+{
+  public:
+    enum
+    {
+      TileSize = 256,          // width and height of a tile in pixels
+      MinTiles = 16            // tiles kept even if the view is small
+    };
+
+  private:
+    struct Tile
+    {
+      int32   Column;
+      int32   Row;
+      BBitmap *Bitmap;
+      bool    Valid;           // `Bitmap' contains the current contents
+      bool    Preview;         // `Bitmap' contains placeholders and has to be redrawn
+    };
+
+    typedef list<Tile, allocator<Tile> > TileList;
+
+    TileList Tiles;            // most recently used first
+    uint     MaxTiles;
+    uint32   Generation;       // incremented whenever all tiles are invalidated
+
+  public:
+    TileCache();
+    ~TileCache();
+
+    BBitmap *Lookup(int32 Column, int32 Row);
+    bool    IsValid(int32 Column, int32 Row) const;
+    bool    IsFinal(int32 Column, int32 Row) const;
+    bool    Store(int32 Column, int32 Row, BBitmap *&bm, uint32 gen, bool Preview = false);
+    void    Invalidate();
+    void    Reserve(uint num);
+    void    Free();
+
+    uint32 CurrentGeneration() const
+    {
+      return Generation;
+    }
+
+    static BRect Bounds(int32 Column, int32 Row)
+    {
+      return BRect(Column * TileSize, Row * TileSize, (Column + 1) * TileSize - 1, (Row + 1) * TileSize - 1);
+    }
+};
+
+#endif